@@ -0,0 +1,463 @@
+/*******************************************************************************
+ * Nuclear Weapons Effects Calculator - kernel benchmarks
+ *
+ * Measures time per operation and throughput of the physics kernels over the
+ * yields of the built-in presets, with surface and air bursts. Each benchmark
+ * doubles its iteration count until a run takes at least --min-time seconds,
+ * then reports the median of --repetitions such runs.
+ *
+ * Build (from the repository root):
+ *   g++ -std=c++17 -O2 -march=native -pthread bench/nuccalc_bench.cpp -o nuccalc_bench
+ *
+ * Usage:
+ *   nuccalc_bench [--filter <substring>] [--min-time <seconds>] [--repetitions <n>] [--csv]
+ ******************************************************************************/
+
+#define NUCCALC_NO_MAIN
+#include "../nuccalc.cpp"
+
+#include <chrono> // Steady clock for timing
+
+/*******************************************************************************
+ * Harness
+ ******************************************************************************/
+
+// Function to keep the compiler from discarding a benchmarked result
+template <typename T>
+inline void doNotOptimize(const T &value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "g"(&value) : "memory"); // The value escapes to memory the compiler cannot see
+#else
+    static const T *volatile sink;
+    sink = &value;
+#endif
+}
+
+// One benchmark run: body performs iterations operations over its inputs
+struct BenchmarkState
+{
+    size_t iterations; // Operations to perform
+};
+
+// Registered benchmark
+struct Benchmark
+{
+    std::string name;
+    void (*body)(BenchmarkState &state, const void *context);
+    const void *context;
+};
+
+// Function to get all registered benchmarks, in registration order
+inline std::vector<Benchmark> &benchmarks()
+{
+    static std::vector<Benchmark> registry;
+    return registry;
+}
+
+// Function to register a benchmark body callable as body(state)
+template <typename Body>
+inline void registerBenchmark(const std::string &name, const Body &body)
+{
+    static std::vector<const Body *> bodies; // Keeps one copy of each body alive
+    bodies.push_back(new Body(body));
+    benchmarks().push_back({name,
+                            [](BenchmarkState &state, const void *context)
+                            { (*static_cast<const Body *>(context))(state); },
+                            bodies.back()});
+}
+
+// Function to time one run of a benchmark in seconds
+inline double timeBenchmark(const Benchmark &benchmark, size_t iterations)
+{
+    BenchmarkState state = {iterations};
+    auto start = std::chrono::steady_clock::now();
+    benchmark.body(state, benchmark.context);
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Function to measure a benchmark, returns the median nanoseconds per operation and the iteration count used
+inline double measureBenchmark(const Benchmark &benchmark, double minTime, int repetitions, size_t &iterations)
+{
+    iterations = 1;
+    while (timeBenchmark(benchmark, iterations) < minTime && iterations < (size_t(1) << 40))
+    {
+        iterations *= 2;
+    }
+
+    std::vector<double> samples;
+    for (int r = 0; r < repetitions; r++)
+    {
+        samples.push_back(timeBenchmark(benchmark, iterations) * 1e9 / static_cast<double>(iterations));
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+/*******************************************************************************
+ * Inputs
+ ******************************************************************************/
+
+// Yield, height and distance inputs cycled through by the kernels
+struct KernelInputs
+{
+    std::vector<double> yields;    // Megatons, every preset
+    std::vector<double> heights;   // Meters, the preset burst height (or 0 for surface bursts)
+    std::vector<double> distances; // Meters, 100 m to 20 km
+};
+
+// Function to build the inputs over the preset yields; airburst selects the preset height or 0
+inline KernelInputs makeKernelInputs(bool airburst)
+{
+    KernelInputs inputs;
+    for (const WeaponPreset &preset : PRESETS)
+    {
+        inputs.yields.push_back(preset.yield);
+        inputs.heights.push_back(airburst ? std::max(100.0, preset.typicalHeight) : 0.0);
+    }
+    for (int i = 0; i < 64; i++)
+    {
+        inputs.distances.push_back(100.0 * pow(200.0, i / 63.0));
+    }
+    return inputs;
+}
+
+// Function to get the burst label of a benchmark name
+inline const char *burstLabel(bool airburst)
+{
+    return airburst ? "air" : "surface";
+}
+
+template <typename Real>
+inline const char *realLabel()
+{
+    return std::is_same<Real, float>::value ? "float" : std::is_same<Real, double>::value ? "double" : "long double";
+}
+
+/*******************************************************************************
+ * Benchmarks
+ ******************************************************************************/
+
+// Function to register the per-distance, fallout and density kernels at one precision
+template <typename Real>
+inline void registerKernelBenchmarks()
+{
+    const std::string suffix = std::string("<") + realLabel<Real>() + ">";
+
+    for (bool airburst : {false, true})
+    {
+        KernelInputs inputs = makeKernelInputs(airburst);
+        const std::string burst = std::string("/") + burstLabel(airburst);
+
+        registerBenchmark("calculateBlastOverpressure" + suffix + burst, [inputs](BenchmarkState &state)
+                          {
+            size_t y = 0;
+            size_t d = 0;
+            for (size_t i = 0; i < state.iterations; i++)
+            {
+                Real pressure = calculateBlastOverpressure(Real(inputs.distances[d]), Real(inputs.yields[y]),
+                                                           Real(inputs.heights[y]));
+                doNotOptimize(pressure);
+                if (++d == inputs.distances.size())
+                {
+                    d = 0;
+                    y = (y + 1) % inputs.yields.size();
+                }
+            } });
+
+        registerBenchmark("calculateThermalRadiation" + suffix + burst, [inputs](BenchmarkState &state)
+                          {
+            size_t y = 0;
+            size_t d = 0;
+            for (size_t i = 0; i < state.iterations; i++)
+            {
+                Real fluence = calculateThermalRadiation(Real(inputs.distances[d]), Real(inputs.yields[y]),
+                                                         Real(inputs.heights[y]));
+                doNotOptimize(fluence);
+                if (++d == inputs.distances.size())
+                {
+                    d = 0;
+                    y = (y + 1) % inputs.yields.size();
+                }
+            } });
+
+        for (double wind : {0.0, 20.0})
+        {
+            registerBenchmark("calculateFallout" + suffix + burst + (wind > 0 ? "/wind" : "/calm"),
+                              [inputs, airburst, wind](BenchmarkState &state)
+                              {
+                size_t y = 0;
+                for (size_t i = 0; i < state.iterations; i++)
+                {
+                    FalloutDataT<Real> fallout = calculateFallout(Real(inputs.yields[y]), Real(inputs.heights[y]),
+                                                                  airburst, Real(wind));
+                    doNotOptimize(fallout);
+                    y = (y + 1) % inputs.yields.size();
+                } });
+        }
+    }
+
+    registerBenchmark("calculateDensityAtDistance" + suffix, [](BenchmarkState &state)
+                      {
+        size_t c = 0;
+        Real distance = 0;
+        for (size_t i = 0; i < state.iterations; i++)
+        {
+            const CityData &city = CITIES[c];
+            Real density = calculateDensityAtDistance(distance, city);
+            doNotOptimize(density);
+            distance += Real(0.37); // Crosses the city radius into the suburban branch
+            if (distance > Real(3 * city.radius))
+            {
+                distance = 0;
+                c = (c + 1) % CITIES.size();
+            }
+        } });
+}
+
+// Function to register the scenario level benchmarks at one precision
+template <typename Real>
+inline void registerScenarioBenchmarks()
+{
+    const std::string suffix = std::string("<") + realLabel<Real>() + ">";
+
+    // Every preset at its typical height against every city
+    std::vector<Scenario> scenarios;
+    for (size_t p = 0; p < PRESETS.size(); p++)
+    {
+        for (size_t c = 0; c < CITIES.size(); c++)
+        {
+            scenarios.push_back(presetScenario(p, c, 20.0));
+        }
+    }
+
+    const std::pair<const char *, YieldScaling> scalings[] = {{"exact", YieldScaling::Exact},
+                                                              {"tabulated", YieldScaling::Tabulated}};
+    for (const auto &scaling : scalings)
+    {
+        ModelOptions options;
+        options.yieldScaling = scaling.second;
+        registerBenchmark("calculateEffects" + suffix + "/" + scaling.first, [scenarios, options](BenchmarkState &state)
+                          {
+            size_t s = 0;
+            for (size_t i = 0; i < state.iterations; i++)
+            {
+                WeaponEffectsT<Real> effects = calculateEffects<Real>(scenarios[s], options);
+                doNotOptimize(effects);
+                s = (s + 1) % scenarios.size();
+            } });
+    }
+
+    std::vector<WeaponEffectsT<Real>> effects;
+    for (const Scenario &scenario : scenarios)
+    {
+        effects.push_back(calculateEffects<Real>(scenario));
+    }
+    const std::pair<const char *, CasualtyMethod> methods[] = {{"rings", CasualtyMethod::Rings},
+                                                               {"adaptive", CasualtyMethod::Adaptive},
+                                                               {"analytic", CasualtyMethod::Analytic}};
+    for (const auto &method : methods)
+    {
+        ModelOptions options;
+        options.casualtyMethod = method.second;
+        registerBenchmark("calculateCasualties" + suffix + "/" + method.first,
+                          [scenarios, effects, options](BenchmarkState &state)
+                          {
+            size_t s = 0;
+            for (size_t i = 0; i < state.iterations; i++)
+            {
+                CasualtyEstimateT<Real> casualties =
+                    calculateCasualties(effects[s], CITIES[scenarios[s].cityIndex], options);
+                doNotOptimize(casualties);
+                s = (s + 1) % scenarios.size();
+            } });
+    }
+
+    registerBenchmark("computeEffects" + suffix, [scenarios](BenchmarkState &state)
+                      {
+        size_t s = 0;
+        for (size_t i = 0; i < state.iterations; i++)
+        {
+            ScenarioResultT<Real> result = computeEffects<Real>(scenarios[s]);
+            doNotOptimize(result);
+            s = (s + 1) % scenarios.size();
+        } });
+}
+
+// Function to register the vectorized profile kernels; one operation is one distance
+inline void registerProfileBenchmarks()
+{
+    const size_t POINTS = 1024;
+    std::vector<double> distances(POINTS);
+    for (size_t i = 0; i < POINTS; i++)
+    {
+        distances[i] = 20000.0 * (i + 1) / POINTS;
+    }
+
+    for (bool airburst : {false, true})
+    {
+        KernelInputs inputs = makeKernelInputs(airburst);
+        const std::string burst = std::string("/") + burstLabel(airburst);
+
+        registerBenchmark("calculateBlastOverpressureProfile" + burst, [inputs, distances](BenchmarkState &state)
+                          {
+            std::vector<double> pressures(distances.size());
+            size_t y = 0;
+            for (size_t done = 0; done < state.iterations; done += distances.size())
+            {
+                size_t count = std::min(distances.size(), state.iterations - done);
+                BlastInvariants blast = makeBlastInvariants(inputs.yields[y], inputs.heights[y]);
+                calculateBlastOverpressureProfile(blast, distances.data(), pressures.data(), count);
+                doNotOptimize(pressures[0]);
+                y = (y + 1) % inputs.yields.size();
+            } });
+
+        registerBenchmark("calculateThermalRadiationProfile" + burst, [inputs, distances](BenchmarkState &state)
+                          {
+            std::vector<double> fluence(distances.size());
+            size_t y = 0;
+            for (size_t done = 0; done < state.iterations; done += distances.size())
+            {
+                size_t count = std::min(distances.size(), state.iterations - done);
+                ThermalInvariants thermal = makeThermalInvariants(inputs.yields[y], inputs.heights[y]);
+                calculateThermalRadiationProfile(thermal, distances.data(), fluence.data(), count);
+                doNotOptimize(fluence[0]);
+                y = (y + 1) % inputs.yields.size();
+            } });
+    }
+}
+
+// Function to register the batched threshold range solvers; one operation is one query
+inline void registerThresholdRangeBenchmarks()
+{
+    const size_t QUERIES = 1024;
+
+    for (bool airburst : {false, true})
+    {
+        KernelInputs inputs = makeKernelInputs(airburst);
+        const std::string burst = std::string("/") + burstLabel(airburst);
+
+        // Every preset at thresholds spread over 1-100 psi and 1-100 cal/cm²
+        std::vector<BlastInvariants> blast(QUERIES);
+        std::vector<ThermalInvariants> thermal(QUERIES);
+        std::vector<double> overpressures(QUERIES), fluences(QUERIES);
+        for (size_t i = 0; i < QUERIES; i++)
+        {
+            size_t y = i % inputs.yields.size();
+            double spread = pow(100.0, (i % 61) / 60.0);
+            blast[i] = makeBlastInvariants(inputs.yields[y], inputs.heights[y]);
+            thermal[i] = makeThermalInvariants(inputs.yields[y], inputs.heights[y]);
+            overpressures[i] = spread * PhysicalConstants::PSI;
+            fluences[i] = spread * PhysicalConstants::CALORIE_PER_CM2;
+        }
+
+        registerBenchmark("solveOverpressureRanges" + burst, [blast, overpressures](BenchmarkState &state)
+                          {
+            std::vector<double> ranges(blast.size());
+            for (size_t done = 0; done < state.iterations; done += blast.size())
+            {
+                size_t count = std::min(blast.size(), state.iterations - done);
+                solveOverpressureRanges(blast.data(), overpressures.data(), ranges.data(), count);
+                doNotOptimize(ranges[0]);
+            } });
+
+        registerBenchmark("solveThermalRanges" + burst, [thermal, fluences](BenchmarkState &state)
+                          {
+            std::vector<double> ranges(thermal.size());
+            for (size_t done = 0; done < state.iterations; done += thermal.size())
+            {
+                size_t count = std::min(thermal.size(), state.iterations - done);
+                solveThermalRanges(thermal.data(), fluences.data(), ranges.data(), count);
+                doNotOptimize(ranges[0]);
+            } });
+    }
+}
+
+// Function to register the dual-number sensitivity evaluation; one operation is all outputs with their gradients
+inline void registerSensitivityBenchmarks()
+{
+    for (bool airburst : {false, true})
+    {
+        KernelInputs inputs = makeKernelInputs(airburst);
+        const std::string burst = std::string("/") + burstLabel(airburst);
+
+        registerBenchmark("calculateSensitivity" + burst, [inputs, airburst](BenchmarkState &state)
+                          {
+            size_t y = 0;
+            size_t d = 0;
+            for (size_t i = 0; i < state.iterations; i++)
+            {
+                SensitivityQuery query = {inputs.yields[y], inputs.heights[y], airburst, 20.0, inputs.distances[d], {}};
+                SensitivityResult result = calculateSensitivity(query);
+                doNotOptimize(result);
+                if (++d == inputs.distances.size())
+                {
+                    d = 0;
+                    y = (y + 1) % inputs.yields.size();
+                }
+            } });
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const char *filter = "";
+    double minTime = 0.1;
+    int repetitions = 3;
+    bool csv = false;
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--filter") && i + 1 < argc)
+            filter = argv[++i];
+        else if (!strcmp(argv[i], "--min-time") && i + 1 < argc)
+            minTime = strtod(argv[++i], nullptr);
+        else if (!strcmp(argv[i], "--repetitions") && i + 1 < argc)
+            repetitions = std::max(1, atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--csv"))
+            csv = true;
+        else
+        {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--filter <substring>] [--min-time <seconds>] [--repetitions <n>] [--csv]\n";
+            return 1;
+        }
+    }
+
+    registerKernelBenchmarks<float>();
+    registerKernelBenchmarks<double>();
+    registerKernelBenchmarks<long double>();
+    registerScenarioBenchmarks<float>();
+    registerScenarioBenchmarks<double>();
+    registerScenarioBenchmarks<long double>();
+    registerProfileBenchmarks();
+    registerThresholdRangeBenchmarks();
+    registerSensitivityBenchmarks();
+
+    if (csv)
+        std::cout << "name,ns_per_op,ops_per_second,iterations\n";
+    else
+        std::cout << std::left << std::setw(56) << "Benchmark" << std::right << std::setw(14) << "Time/op"
+                  << std::setw(16) << "Ops/s" << std::setw(14) << "Iterations" << "\n"
+                  << std::string(100, '-') << "\n";
+
+    for (const Benchmark &benchmark : benchmarks())
+    {
+        if (benchmark.name.find(filter) == std::string::npos)
+            continue;
+
+        size_t iterations;
+        double nanoseconds = measureBenchmark(benchmark, minTime, repetitions, iterations);
+        double throughput = 1e9 / nanoseconds;
+        if (csv)
+        {
+            std::cout << benchmark.name << "," << nanoseconds << "," << throughput << "," << iterations << "\n";
+        }
+        else
+        {
+            std::cout << std::left << std::setw(56) << benchmark.name << std::right << std::fixed
+                      << std::setprecision(2) << std::setw(11) << nanoseconds << " ns" << std::setprecision(0)
+                      << std::setw(16) << throughput << std::setw(14) << iterations << "\n";
+        }
+    }
+    return 0;
+}
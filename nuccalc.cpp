@@ -42,42 +42,97 @@
 #include <string>    // String manipulation and storage
 #include <iomanip>   // Output formatting control
 #include <vector>    // Dynamic array container
-#include <map>       // Key-value associative container
+#include <array>     // Fixed-size compile-time tables
+#include <string_view> // Non-owning table strings
 #include <algorithm> // Standard algorithms library
+#include <fstream>   // File streams for batch input
+#include <cstdio>    // snprintf for batch record formatting
+#include <cstdlib>   // strtod/strtol for batch field parsing
+#include <cstring>   // strcmp for command line handling
+#include <deque>     // Work-stealing range queues
+#include <mutex>     // Queue and job synchronization
+#include <condition_variable> // Worker wake-up
+#include <thread>    // Worker threads
+#include <atomic>    // Lock-free progress counters
+#include <type_traits> // Job type erasure
+#include <cstdint>   // Fixed-width cache keys
+#include <unordered_map> // Server connection table
+#include <memory>    // Optional cache and writer ownership
+#include <cstddef>   // offsetof for the result schema
+#include <chrono>    // Stage timers of the instrumentation build
+#include <iterator>  // istreambuf_iterator for whole-file input
+#include <cerrno>    // errno of the server sockets
+#include <csignal>   // SIGINT/SIGTERM shutdown of the server
+#include <filesystem> // resize_file for resumed binary output
+
+#ifndef _WIN32
+#include <fcntl.h>       // open for memory-mapped input
+#include <sys/mman.h>    // mmap
+#include <sys/stat.h>    // fstat
+#include <unistd.h>      // close
+#include <sys/socket.h>  // Server sockets
+#include <sys/un.h>      // Unix domain socket addresses
+#include <netinet/in.h>  // TCP socket addresses
+#include <netinet/tcp.h> // TCP_NODELAY
+#include <netdb.h>       // getaddrinfo
+#include <poll.h>        // Server event loop
+#endif
+
+#ifdef NUCCALC_OFFLOAD
+#include <omp.h> // Device memory and target regions of the offload backend
+#endif
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h> // x86 SIMD intrinsics
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h> // AArch64 SIMD intrinsics
+#endif
+
+// Floating-point type of the default instantiations (WeaponEffects, computeEffects() etc.)
+// Build with e.g. -DNUCCALC_REAL="long double" for reference validation runs
+#ifndef NUCCALC_REAL
+#define NUCCALC_REAL double
+#endif
+using DefaultReal = NUCCALC_REAL;
 
 // Data structure for fallout pattern calculations
-struct FalloutData
+template <typename Real>
+struct FalloutDataT
 {
-    double maxDownwindDistance; // Maximum distance fallout travels downwind (km)
-    double maxWidth;            // Maximum width of fallout pattern (km)
-    double dangerousZoneArea;   // Total area of dangerous fallout (km²)
-    double falloutAngle;        // Angular spread of fallout pattern (degrees)
+    Real maxDownwindDistance; // Maximum distance fallout travels downwind (km)
+    Real maxWidth;            // Maximum width of fallout pattern (km)
+    Real dangerousZoneArea;   // Total area of dangerous fallout (km²)
+    Real falloutAngle;        // Angular spread of fallout pattern (degrees)
 };
 
 // Nested structure for different effect levels and their areas
-struct WeaponEffects
+template <typename Real>
+struct WeaponEffectsT
 {
     struct EffectLevels
     {
-        long double severe; // Changed to long double for higher precision
-        long double moderate;
-        long double light;
-        long double severeArea;
-        long double moderateArea;
-        long double lightArea;
+        Real severe;
+        Real moderate;
+        Real light;
+        Real severeArea;
+        Real moderateArea;
+        Real lightArea;
     };
 
-    EffectLevels thermal;   // Thermal radiation effects (burns)
-    EffectLevels blast;     // Blast wave effects (overpressure)
-    EffectLevels radiation; // Initial nuclear radiation effects
-    FalloutData fallout;    // Fallout pattern data
+    EffectLevels thermal;       // Thermal radiation effects (burns)
+    EffectLevels blast;         // Blast wave effects (overpressure)
+    EffectLevels radiation;     // Initial nuclear radiation effects
+    FalloutDataT<Real> fallout; // Fallout pattern data
 };
 
+using FalloutData = FalloutDataT<DefaultReal>;
+using WeaponEffects = WeaponEffectsT<DefaultReal>;
+
 // Structure to store preset weapon data
 struct WeaponPreset
 {
-    std::string name;     // Name of the weapon
-    std::string type;     // Type of the weapon
+    std::string_view name; // Name of the weapon
+    std::string_view type; // Type of the weapon
     double yield;         // Yield in megatons (MT)
     bool isAirburst;      // Flag for air burst vs surface burst
     double typicalHeight; // Typical height of burst in meters
@@ -94,10 +149,11 @@ struct OptimalHeight
 // Structure to store burst type information
 struct BurstTypeInfo
 {
-    std::string name;        // Name of the burst type
-    double falloutFactor;    // Fallout factor for the burst type
-    double radiationFactor;  // Radiation factor for the burst type
-    std::string description; // Description of the burst type
+    std::string_view key;         // Lookup key of the burst type
+    std::string_view name;        // Name of the burst type
+    double falloutFactor;         // Fallout factor for the burst type
+    double radiationFactor;       // Radiation factor for the burst type
+    std::string_view description; // Description of the burst type
 };
 
 // Structure to store physical constants used in calculations
@@ -111,13 +167,15 @@ struct PhysicalConstants
     static constexpr double PLANCK_CONSTANT = 6.62607015e-34;  // Planck constant (J·s)
     static constexpr double BOLTZMANN_CONSTANT = 1.380649e-23; // Boltzmann constant (J/K)
     static constexpr double LIGHT_SPEED = 299792458.0;         // Speed of light (m/s)
+    static constexpr double PSI = 6894.757293168;              // Pascals per pound-force per square inch
+    static constexpr double CALORIE_PER_CM2 = 41840.0;         // J/m² per thermochemical cal/cm²
 };
 
 // Structure to store city data
 struct CityData
 {
-    std::string name;        // Name of the city
-    std::string country;     // Country of the city
+    std::string_view name;    // Name of the city
+    std::string_view country; // Country of the city
     double population;       // Population in millions
     double area;             // Area in square kilometers (km²)
     double density;          // Population density (people per km²)
@@ -125,766 +183,8444 @@ struct CityData
     double suburban_density; // Population density in suburbs (people per km²)
 };
 
-// Main calculator class implementation
-class NuclearEffectsCalculator
+/*******************************************************************************
+ * Built-in tables
+ *
+ * Compile-time constant data shared by every calculator and scenario. These
+ * tables are the default catalog (see Catalogs), which scenarios refer to by
+ * city and preset index.
+ ******************************************************************************/
+
+// Preset weapon data
+inline constexpr std::array<WeaponPreset, 35> PRESETS = {{ // Name, Type, Yield (MT), Airburst, Height (m)
+    // Historic Weapons
+    {"Little Boy (US)", "Uranium Gun-Type", 0.015, true, 580},
+    {"Fat Man (US)", "Plutonium Implosion", 0.021, true, 503},
+    {"Ivy King (US)", "Fission", 0.500, true, 450},
+    {"Castle Bravo (US)", "Thermonuclear", 15.0, true, 2000},
+    {"Tsar Bomba (USSR)", "Thermonuclear", 50.0, true, 4000},
+
+    // United States
+    {"W88", "SLBM Thermonuclear", 0.475, true, 300},
+    {"W87", "ICBM Thermonuclear", 0.300, true, 300},
+    {"W76-1", "SLBM Thermonuclear", 0.100, true, 250},
+    {"W78", "ICBM Thermonuclear", 0.350, true, 300},
+    {"B61-12", "Variable Yield", 0.050, true, 200},
+    {"W80", "Cruise Missile", 0.150, true, 250},
+    {"B83", "Strategic Bomb", 1.200, true, 300},
+
+    // Russia
+    {"RS-28 Sarmat", "MIRV Thermonuclear", 0.800, true, 350},
+    {"R-36M2 Voevoda", "MIRV Thermonuclear", 0.750, true, 300},
+    {"RT-2PM2 Topol-M", "Thermonuclear", 0.550, true, 300},
+    {"RSM-56 Bulava", "SLBM MIRV", 0.150, true, 250},
+    {"9K720 Iskander", "Enhanced Radiation", 0.050, true, 200},
+    {"RS-24 Yars", "Mobile ICBM", 0.300, true, 300},
+
+    // China
+    {"DF-5B", "MIRV Thermonuclear", 0.500, true, 300},
+    {"DF-41", "Mobile MIRV", 0.350, true, 250},
+    {"JL-2", "SLBM", 0.250, true, 250},
+    {"DF-31AG", "Mobile ICBM", 0.250, true, 300},
+    {"DF-26", "IRB Thermonuclear", 0.150, true, 200},
+    {"DF-21", "Medium Range", 0.300, true, 250},
+
+    // Other Nuclear Powers
+    {"Trident D5", "UK SLBM", 0.100, true, 250},
+    {"M51", "French SLBM", 0.150, true, 250},
+    {"ASMP-A", "French Cruise", 0.300, true, 200},
+    {"Jericho III", "Israeli IRBM", 0.400, true, 250},
+    {"Agni-V", "Indian ICBM", 0.250, true, 300},
+    {"K-15 Sagarika", "Indian SLBM", 0.200, true, 250},
+    {"Shaheen-III", "Pakistani MRBM", 0.200, true, 250},
+    {"Babur", "Pakistani Cruise", 0.050, true, 200},
+    {"Hwasong-15", "NK ICBM", 0.200, true, 250},
+    {"Hwasong-14", "NK ICBM", 0.150, true, 250},
+    {"Pukguksong-2", "NK MRBM", 0.050, true, 200}}};
+
+// Burst type information
+inline constexpr std::array<BurstTypeInfo, 4> BURST_TYPES = {{
+    {"surface", "Surface Burst", 1.0, 1.0, "Maximum fallout, reduced blast radius"},
+    {"optimum", "Optimal Air Burst", 0.5, 0.7, "Best blast/thermal effects"},
+    {"low", "Low Air Burst", 0.7, 0.8, "Balanced effects"},
+    {"high", "High Air Burst", 0.3, 0.5, "Minimum fallout, reduced blast"}}};
+
+// Target cities
+inline constexpr std::array<CityData, 31> CITIES = {{
+    {"Amsterdam", "Netherlands", 1.1, 219, 5023, 9.2, 2100},
+    {"Athens", "Greece", 3.2, 412, 7767, 15.2, 2200},
+    {"Barcelona", "Spain", 1.6, 101, 15842, 5.8, 3500},
+    {"Belgrade", "Serbia", 1.7, 360, 4722, 10.7, 1200},
+    {"Berlin", "Germany", 3.7, 892, 4147, 16.8, 1800},
+    {"Brussels", "Belgium", 2.1, 161, 13043, 7.2, 3200},
+    {"Bucharest", "Romania", 2.1, 228, 9210, 8.5, 1500},
+    {"Budapest", "Hungary", 1.8, 525, 3428, 12.9, 1100},
+    {"Copenhagen", "Denmark", 0.8, 180, 4444, 7.5, 1800},
+    {"Dublin", "Ireland", 1.4, 115, 12174, 6.1, 2500},
+    {"Graz", "Austria", 0.29, 127, 2283, 6.4, 800},
+    {"Hamburg", "Germany", 1.9, 755, 2517, 15.5, 1200},
+    {"Helsinki", "Finland", 0.66, 215, 3070, 8.2, 1400},
+    {"Kiev", "Ukraine", 3.0, 839, 3575, 16.3, 900},
+    {"Linz", "Austria", 0.21, 96, 2187, 5.5, 700},
+    {"Lisbon", "Portugal", 2.9, 100, 29000, 5.6, 4200},
+    {"London", "UK", 9.0, 1572, 5724, 22.5, 3500},
+    {"Madrid", "Spain", 3.3, 604, 5464, 13.8, 2200},
+    {"Milan", "Italy", 1.4, 182, 7692, 7.6, 2800},
+    {"Moscow", "Russia", 12.5, 2511, 4978, 28.1, 2000},
+    {"Munich", "Germany", 1.5, 310, 4839, 9.9, 1900},
+    {"Oslo", "Norway", 0.7, 454, 1542, 12.0, 800},
+    {"Paris", "France", 2.2, 105, 20952, 5.8, 5500},
+    {"Prague", "Czech Rep.", 1.3, 496, 2621, 12.5, 1100},
+    {"Rome", "Italy", 4.3, 1285, 3345, 20.2, 1600},
+    {"Sofia", "Bulgaria", 1.3, 492, 2642, 12.5, 900},
+    {"Stockholm", "Sweden", 1.0, 188, 5319, 7.7, 1700},
+    {"Vienna", "Austria", 1.9, 415, 4579, 11.5, 1600},
+    {"Warsaw", "Poland", 1.8, 517, 3483, 12.8, 1400},
+    {"Zagreb", "Croatia", 0.8, 641, 1248, 14.2, 600},
+    {"Zurich", "Switzerland", 0.43, 88, 4886, 5.3, 2200}}};
+
+// Add long-term effects to CasualtyEstimate
+template <typename Real>
+struct CasualtyEstimateT
 {
-private:
-    double yield;     // Nuclear weapon yield in megatons
-    double height;    // Height of burst in meters
-    bool isAirburst;  // Flag for air burst vs surface burst
-    double windSpeed; // Wind speed for fallout calculations (km/h)
+    Real deaths;
+    Real severeInjuries;
+    Real lightInjuries;
+    Real longTermDeaths1Year;
+    Real longTermDeaths5Year;
+    Real longTermDeaths10Year;
+    Real longTermDeaths20Year;
+    size_t densityEvaluations; // Density model evaluations used by the integration
+};
 
-    // Function to clear the screen
-    void clearScreen()
+using CasualtyEstimate = CasualtyEstimateT<DefaultReal>;
+
+// Numerical method of the casualty integration over the population density
+enum class CasualtyMethod
+{
+    Rings,    // Fixed concentric rings, classified at the ring midpoint
+    Adaptive, // Adaptive Simpson between effect radius and density knee boundaries
+    Analytic  // Closed-form integral of the exponential density model, Adaptive for other models
+};
+
+// Source of the fractional yield powers and logarithms of the physics core
+enum class YieldScaling
+{
+    Exact,    // Standard library pow/log10
+    Tabulated // Compile-time tables, relative error below 1e-11
+};
+
+// Model options that do not belong to a scenario
+class PopulationRaster;
+
+struct ModelOptions
+{
+    CasualtyMethod casualtyMethod = CasualtyMethod::Rings; // Casualty integration method
+    int casualtyRings = 20;                                // Ring count of CasualtyMethod::Rings
+    double casualtyTolerance = 1e-6;                       // Relative tolerance of CasualtyMethod::Adaptive
+    YieldScaling yieldScaling = YieldScaling::Exact;       // Yield power evaluation of the effects
+    const PopulationRaster *population = nullptr;          // Gridded population replacing the city density model
+};
+
+// Immutable description of one detonation scenario
+struct Scenario
+{
+    double yield;         // Nuclear weapon yield in megatons
+    double height;        // Height of burst in meters
+    bool isAirburst;      // Flag for air burst vs surface burst
+    double windSpeed;     // Wind speed for fallout calculations (km/h)
+    size_t cityIndex;     // Target city, index into catalog().cities()
+};
+
+// Complete result of one scenario evaluation
+template <typename Real>
+struct ScenarioResultT
+{
+    WeaponEffectsT<Real> effects;       // Effect radii, areas and fallout
+    CasualtyEstimateT<Real> casualties; // Casualty estimate for the target city
+};
+
+using ScenarioResult = ScenarioResultT<DefaultReal>;
+
+/*******************************************************************************
+ * Instrumentation
+ *
+ * Built with -DNUCCALC_INSTRUMENT, the hot paths count their calls, cumulative
+ * time and a log2 latency histogram per stage. Each thread records into its own
+ * counters, which only that thread writes, so recording takes no locks and no
+ * read-modify-write atomics; counters of exited threads are folded into a
+ * retired total. instrumentationSnapshot() sums everything for the library API
+ * and the command line dumps the totals on stderr at exit. Without the define
+ * NUCCALC_STAGE expands to nothing and none of this is compiled.
+ ******************************************************************************/
+
+#ifdef NUCCALC_INSTRUMENT
+
+// Instrumented stages of a scenario evaluation
+enum class Stage
+{
+    EffectRadii,   // Yield scaling of the effect radii and areas (calculateEffects)
+    HeightEffects, // Height of burst adjustment (applyHeightEffects)
+    Fallout,       // Fallout pattern (calculateFallout)
+    Casualties,    // Casualty integration over the city (calculateCasualties)
+    Output,        // Result formatting and writing (ResultWriter::write)
+    COUNT
+};
+
+constexpr size_t STAGE_COUNT = static_cast<size_t>(Stage::COUNT);
+constexpr size_t LATENCY_BUCKETS = 32; // Bucket k holds latencies in [2^(k-1), 2^k) ns, the last one everything above
+
+// Function to get the display name of a stage
+inline const char *stageName(Stage stage)
+{
+    static const char *const NAMES[STAGE_COUNT] = {"effect_radii", "height_effects", "fallout", "casualties", "output"};
+    return NAMES[static_cast<size_t>(stage)];
+}
+
+// Accumulated statistics of one stage
+struct StageProfile
+{
+    uint64_t calls;                       // Completed calls
+    uint64_t nanoseconds;                 // Cumulative time in the stage
+    uint64_t histogram[LATENCY_BUCKETS];  // Call latencies, log2 buckets
+};
+
+using InstrumentationSnapshot = std::array<StageProfile, STAGE_COUNT>;
+
+// Function to get the histogram bucket of a latency
+inline size_t latencyBucket(uint64_t nanoseconds)
+{
+    size_t bucket = 0;
+    while (nanoseconds && bucket < LATENCY_BUCKETS - 1)
     {
-#ifdef _WIN32
-        system("cls"); // Clear screen for Windows
-#else
-        system("clear"); // Clear screen for Unix-based systems
-#endif
+        nanoseconds >>= 1;
+        bucket++;
     }
+    return bucket;
+}
 
-    // Function to print menu header
-    void printMenuHeader(const std::string &title)
+// Counters of one thread, written by that thread only and read by snapshots
+class ThreadInstrumentation
+{
+public:
+    struct Counters
     {
-        std::cout << std::string(78, '-') << "\n"; // Print a line of dashes
-        std::cout << title << "\n";                // Print the title
-        std::cout << std::string(78, '-') << "\n"; // Print another line of dashes
-    }
+        std::atomic<uint64_t> calls{0};
+        std::atomic<uint64_t> nanoseconds{0};
+        std::atomic<uint64_t> histogram[LATENCY_BUCKETS] = {};
+    };
 
-    // Function to print menu divider
-    void printMenuDivider()
+    ThreadInstrumentation();
+    ~ThreadInstrumentation();
+
+    // Function to record one call; a plain load and store, as no other thread writes these counters
+    void record(Stage stage, uint64_t nanoseconds)
     {
-        std::cout << std::string(78, '-') << "\n"; // Print a line of dashes
+        Counters &counters = stages[static_cast<size_t>(stage)];
+        bump(counters.calls, 1);
+        bump(counters.nanoseconds, nanoseconds);
+        bump(counters.histogram[latencyBucket(nanoseconds)], 1);
     }
 
-    // Modified weapon option printing function to show name and type
-    void printWeaponOption(size_t index, size_t maxItems)
+    // Function to add the counters to a snapshot
+    void addTo(InstrumentationSnapshot &snapshot) const
     {
-        std::string mt = std::to_string(PRESETS[index].yield);
-        mt = mt.substr(0, mt.find(".") + 4); // Limit to 3 decimal places
-
-        std::string entry = std::to_string(index + 1) + ". " +
-                            PRESETS[index].name + "/" + PRESETS[index].type +
-                            " (" + mt + " MT)";
-
-        if (index % 2 == 0)
-        {
-            std::cout << std::setw(52) << std::left << entry; // Increased width to accommodate type
-        }
-        else
+        for (size_t s = 0; s < STAGE_COUNT; s++)
         {
-            std::cout << entry << "\n";
+            snapshot[s].calls += stages[s].calls.load(std::memory_order_relaxed);
+            snapshot[s].nanoseconds += stages[s].nanoseconds.load(std::memory_order_relaxed);
+            for (size_t b = 0; b < LATENCY_BUCKETS; b++)
+                snapshot[s].histogram[b] += stages[s].histogram[b].load(std::memory_order_relaxed);
         }
+    }
 
-        // Add newline for odd-numbered sections
-        if (index % 2 == 0 && index == maxItems - 1)
+    // Function to clear the counters
+    void reset()
+    {
+        for (Counters &counters : stages)
         {
-            std::cout << "\n";
+            counters.calls.store(0, std::memory_order_relaxed);
+            counters.nanoseconds.store(0, std::memory_order_relaxed);
+            for (std::atomic<uint64_t> &bucket : counters.histogram)
+                bucket.store(0, std::memory_order_relaxed);
         }
     }
 
-    // Function to apply height effects to weapon effects
-    void applyHeightEffects(WeaponEffects &effects, double height)
-    {
-        // Adjust effects based on height of burst
-        double heightFactor = 1.0 - (height / 10000.0); // Linear decrease with height
-        heightFactor = std::max(0.3, heightFactor);     // Minimum 30% effect
-
-        effects.blast.severe *= heightFactor;   // Reduce severe blast effects
-        effects.blast.moderate *= heightFactor; // Reduce moderate blast effects
-        effects.blast.light *= heightFactor;    // Reduce light blast effects
-
-        effects.radiation.severe *= heightFactor;   // Reduce severe radiation effects
-        effects.radiation.moderate *= heightFactor; // Reduce moderate radiation effects
-        effects.radiation.light *= heightFactor;    // Reduce light radiation effects
-    }
-
-    // Preset weapon data
-    const std::vector<WeaponPreset> PRESETS = { // Name, Type, Yield (MT), Airburst, Height (m)
-        // Historic Weapons
-        {"Little Boy (US)", "Uranium Gun-Type", 0.015, true, 580},
-        {"Fat Man (US)", "Plutonium Implosion", 0.021, true, 503},
-        {"Ivy King (US)", "Fission", 0.500, true, 450},
-        {"Castle Bravo (US)", "Thermonuclear", 15.0, true, 2000},
-        {"Tsar Bomba (USSR)", "Thermonuclear", 50.0, true, 4000},
-
-        // United States
-        {"W88", "SLBM Thermonuclear", 0.475, true, 300},
-        {"W87", "ICBM Thermonuclear", 0.300, true, 300},
-        {"W76-1", "SLBM Thermonuclear", 0.100, true, 250},
-        {"W78", "ICBM Thermonuclear", 0.350, true, 300},
-        {"B61-12", "Variable Yield", 0.050, true, 200},
-        {"W80", "Cruise Missile", 0.150, true, 250},
-        {"B83", "Strategic Bomb", 1.200, true, 300},
-
-        // Russia
-        {"RS-28 Sarmat", "MIRV Thermonuclear", 0.800, true, 350},
-        {"R-36M2 Voevoda", "MIRV Thermonuclear", 0.750, true, 300},
-        {"RT-2PM2 Topol-M", "Thermonuclear", 0.550, true, 300},
-        {"RSM-56 Bulava", "SLBM MIRV", 0.150, true, 250},
-        {"9K720 Iskander", "Enhanced Radiation", 0.050, true, 200},
-        {"RS-24 Yars", "Mobile ICBM", 0.300, true, 300},
-
-        // China
-        {"DF-5B", "MIRV Thermonuclear", 0.500, true, 300},
-        {"DF-41", "Mobile MIRV", 0.350, true, 250},
-        {"JL-2", "SLBM", 0.250, true, 250},
-        {"DF-31AG", "Mobile ICBM", 0.250, true, 300},
-        {"DF-26", "IRB Thermonuclear", 0.150, true, 200},
-        {"DF-21", "Medium Range", 0.300, true, 250},
-
-        // Other Nuclear Powers
-        {"Trident D5", "UK SLBM", 0.100, true, 250},
-        {"M51", "French SLBM", 0.150, true, 250},
-        {"ASMP-A", "French Cruise", 0.300, true, 200},
-        {"Jericho III", "Israeli IRBM", 0.400, true, 250},
-        {"Agni-V", "Indian ICBM", 0.250, true, 300},
-        {"K-15 Sagarika", "Indian SLBM", 0.200, true, 250},
-        {"Shaheen-III", "Pakistani MRBM", 0.200, true, 250},
-        {"Babur", "Pakistani Cruise", 0.050, true, 200},
-        {"Hwasong-15", "NK ICBM", 0.200, true, 250},
-        {"Hwasong-14", "NK ICBM", 0.150, true, 250},
-        {"Pukguksong-2", "NK MRBM", 0.050, true, 200}};
-
-    // Burst type information
-    const std::map<std::string, BurstTypeInfo> BURST_TYPES = {
-        {"surface", {"Surface Burst", 1.0, 1.0, "Maximum fallout, reduced blast radius"}},
-        {"optimum", {"Optimal Air Burst", 0.5, 0.7, "Best blast/thermal effects"}},
-        {"low", {"Low Air Burst", 0.7, 0.8, "Balanced effects"}},
-        {"high", {"High Air Burst", 0.3, 0.5, "Minimum fallout, reduced blast"}}};
-
-    // Helper function to calculate circular area
-    double calculateArea(double radius)
-    {
-        return M_PI * pow(radius / 1000.0, 2); // Convert meters to kilometers for area calculation
+private:
+    static void bump(std::atomic<uint64_t> &counter, uint64_t amount)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
     }
 
-    // Function to print effect header in table format
-    void printEffectHeader()
+    Counters stages[STAGE_COUNT];
+};
+
+// Registry of the live thread counters and the totals of exited threads
+struct InstrumentationRegistry
+{
+    std::mutex mutex;
+    std::vector<ThreadInstrumentation *> threads;
+    InstrumentationSnapshot retired = {};
+
+    static InstrumentationRegistry &instance()
     {
-        std::cout << std::setw(12) << "Severity"     // Print header for effect levels
-                  << std::setw(15) << "Radius (m)"   // Print header for effect radii
-                  << std::setw(20) << "Area (km²)\n" // Print header for effect areas
-                  << std::string(47, '-') << "\n";   // Print a line of dashes
+        static InstrumentationRegistry registry;
+        return registry;
     }
+};
 
-    // Function to display effect levels
-    void displayEffectLevel(const std::string &name, const WeaponEffects::EffectLevels &effect)
+inline ThreadInstrumentation::ThreadInstrumentation()
+{
+    InstrumentationRegistry &registry = InstrumentationRegistry::instance();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.threads.push_back(this);
+}
+
+inline ThreadInstrumentation::~ThreadInstrumentation()
+{
+    InstrumentationRegistry &registry = InstrumentationRegistry::instance();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    addTo(registry.retired);
+    registry.threads.erase(std::find(registry.threads.begin(), registry.threads.end(), this));
+}
+
+// Function to get the counters of the calling thread
+inline ThreadInstrumentation &threadInstrumentation()
+{
+    thread_local ThreadInstrumentation instrumentation;
+    return instrumentation;
+}
+
+// Function to sum the statistics of all threads, live and exited
+inline InstrumentationSnapshot instrumentationSnapshot()
+{
+    InstrumentationRegistry &registry = InstrumentationRegistry::instance();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    InstrumentationSnapshot snapshot = registry.retired;
+    for (const ThreadInstrumentation *thread : registry.threads)
+        thread->addTo(snapshot);
+    return snapshot;
+}
+
+// Function to clear the statistics; calls recorded concurrently may survive, so call it between runs
+inline void resetInstrumentation()
+{
+    InstrumentationRegistry &registry = InstrumentationRegistry::instance();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.retired = {};
+    for (ThreadInstrumentation *thread : registry.threads)
+        thread->reset();
+}
+
+// Function to estimate a latency quantile (ns) from a histogram, as the upper edge of its bucket
+inline uint64_t latencyQuantile(const StageProfile &profile, double quantile)
+{
+    uint64_t target = static_cast<uint64_t>(std::ceil(quantile * double(profile.calls)));
+    uint64_t seen = 0;
+    for (size_t b = 0; b < LATENCY_BUCKETS; b++)
     {
-        std::cout << std::left << std::setw(15) << name << "| ";
+        seen += profile.histogram[b];
+        if (seen >= target && seen > 0)
+            return b ? uint64_t(1) << b : 1;
+    }
+    return uint64_t(1) << (LATENCY_BUCKETS - 1);
+}
 
-        auto formatDistance = [](long double dist) -> std::string
-        {
-            if (dist < 1.0)
-                return "< 1 m";
-            if (dist >= 1000.0)
-            {
-                return std::to_string(static_cast<int>(dist / 1000.0)) + "." +
-                       std::to_string(static_cast<int>(fmod(dist, 1000.0) / 100.0)) + " km";
-            }
-            return std::to_string(static_cast<int>(dist)) + " m";
-        };
+// Function to print a per-stage summary of a snapshot
+inline void printInstrumentation(std::ostream &out, const InstrumentationSnapshot &snapshot)
+{
+    char line[160];
+    int length = snprintf(line, sizeof(line), "%-16s %12s %12s %10s %10s %10s\n",
+                          "stage", "calls", "total_ms", "mean_ns", "p50_ns", "p99_ns");
+    out.write(line, std::min(static_cast<size_t>(std::max(length, 0)), sizeof(line) - 1));
+    for (size_t s = 0; s < STAGE_COUNT; s++)
+    {
+        const StageProfile &profile = snapshot[s];
+        length = snprintf(line, sizeof(line), "%-16s %12llu %12.3f %10.1f %10llu %10llu\n",
+                          stageName(static_cast<Stage>(s)), static_cast<unsigned long long>(profile.calls),
+                          profile.nanoseconds / 1e6, profile.calls ? double(profile.nanoseconds) / profile.calls : 0.0,
+                          static_cast<unsigned long long>(profile.calls ? latencyQuantile(profile, 0.5) : 0),
+                          static_cast<unsigned long long>(profile.calls ? latencyQuantile(profile, 0.99) : 0));
+        out.write(line, std::min(static_cast<size_t>(std::max(length, 0)), sizeof(line) - 1));
+    }
+}
 
-        std::cout << "Severe: " << std::setw(10) << formatDistance(effect.severe)
-                  << " (" << std::fixed << std::setprecision(2) << effect.severeArea << " km²) | ";
-        std::cout << "Moderate: " << std::setw(10) << formatDistance(effect.moderate)
-                  << " (" << effect.moderateArea << " km²) | ";
-        std::cout << "Light: " << std::setw(10) << formatDistance(effect.light)
-                  << " (" << effect.lightArea << " km²)\n";
+// Scope timer recording the time until the end of the enclosing block for a stage
+class StageTimer
+{
+public:
+    explicit StageTimer(Stage stage) : stage(stage), start(std::chrono::steady_clock::now()) {}
+
+    ~StageTimer()
+    {
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+        threadInstrumentation().record(stage, static_cast<uint64_t>(elapsed.count()));
     }
 
-    // Function to display weapon presets
-    void displayPresets()
+    StageTimer(const StageTimer &) = delete;
+    StageTimer &operator=(const StageTimer &) = delete;
+
+private:
+    Stage stage;
+    std::chrono::steady_clock::time_point start;
+};
+
+#define NUCCALC_STAGE_JOIN2(a, b) a##b
+#define NUCCALC_STAGE_JOIN(a, b) NUCCALC_STAGE_JOIN2(a, b)
+#define NUCCALC_STAGE(stage) StageTimer NUCCALC_STAGE_JOIN(stageTimer, __LINE__)(Stage::stage)
+
+#else
+
+#define NUCCALC_STAGE(stage) ((void)0)
+
+#endif // NUCCALC_INSTRUMENT
+
+/*******************************************************************************
+ * Yield scaling
+ *
+ * The physics core takes its fractional powers and logarithms of the yield
+ * from a scaling policy. ExactYieldScaling calls the standard library;
+ * TabulatedYieldScaling reads tables generated at compile time. A positive
+ * x = 2^e * m with m in [1, 2) is looked up as x^p = (2^e)^p * m^p, where
+ * (2^e)^p comes from a per-binade table and m^p from a cubic Hermite
+ * interpolant on 128 uniform mantissa intervals. The interpolation error of
+ * m^p is at most h^4/384 * max|f''''| with h = 1/128, and is checked against
+ * the published ERROR_BOUND at compile time.
+ ******************************************************************************/
+
+// Natural logarithm usable in constant expressions (x > 0)
+constexpr double constexprLog(double x)
+{
+    const double LN2 = 0.693147180559945309417;
+    int exponent = 0;
+    while (x > 1.4142135623730950488)
     {
-        clearScreen();                               // Clear the screen
-        printMenuHeader("Nuclear Weapon Selection"); // Print menu header
+        x /= 2;
+        exponent++;
+    }
+    while (x < 0.7071067811865475244)
+    {
+        x *= 2;
+        exponent--;
+    }
 
-        size_t i = 0;
+    // ln(x) = 2 atanh(s) with s = (x - 1)/(x + 1), |s| < 0.172
+    double s = (x - 1) / (x + 1);
+    double s2 = s * s;
+    double term = s;
+    double sum = 0;
+    for (int k = 1; k < 40; k += 2)
+    {
+        sum += term / k;
+        term *= s2;
+    }
+    return 2 * sum + exponent * LN2;
+}
 
-        // Display Historic Weapons
-        std::cout << "Historic Weapons:\n";
-        for (; i < 5; i++)
-        {
-            printWeaponOption(i, 5); // Print weapon options
-        }
+// Exponential function usable in constant expressions
+constexpr double constexprExp(double x)
+{
+    const double LN2 = 0.693147180559945309417;
+    int exponent = static_cast<int>(x / LN2 + (x < 0 ? -0.5 : 0.5));
+    double r = x - exponent * LN2; // |r| <= ln(2)/2
 
-        printMenuDivider(); // Print menu divider
+    double term = 1;
+    double sum = 1;
+    for (int k = 1; k < 30; k++)
+    {
+        term *= r / k;
+        sum += term;
+    }
+    for (; exponent > 0; exponent--)
+        sum *= 2;
+    for (; exponent < 0; exponent++)
+        sum /= 2;
+    return sum;
+}
 
-        // Display US Weapons
-        std::cout << "United States:\n";
-        for (; i < 12; i++)
-        {
-            printWeaponOption(i, 12); // Print weapon options
-        }
+// Function to split a positive normal double into x = 2^exponent * mantissa, mantissa in [1, 2)
+inline int splitBinade(double x, double &mantissa)
+{
+    uint64_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    int exponent = static_cast<int>((bits >> 52) & 0x7FF) - 1023;
+    bits = (bits & 0x000FFFFFFFFFFFFFull) | 0x3FF0000000000000ull;
+    memcpy(&mantissa, &bits, sizeof(mantissa));
+    return exponent;
+}
 
-        printMenuDivider(); // Print menu divider
+// Cubic Hermite tables of a smooth function over the mantissa range [1, 2)
+// Interval i holds the coefficients of f(1 + (i + t)/INTERVALS) as a cubic in t in [0, 1)
+struct MantissaTable
+{
+    static constexpr int INTERVALS = 128;
+    std::array<std::array<double, 4>, INTERVALS> coefficients{};
 
-        // Display Russian Weapons
-        std::cout << "Russian Weapons:\n";
-        for (; i < 18; i++)
+    // Function to fill the table from values f and derivatives df at the knots
+    template <typename Function, typename Derivative>
+    constexpr void build(Function f, Derivative df)
+    {
+        const double h = 1.0 / INTERVALS;
+        for (int i = 0; i < INTERVALS; i++)
         {
-            printWeaponOption(i, 18); // Print weapon options
+            double m0 = 1.0 + i * h;
+            double m1 = 1.0 + (i + 1) * h;
+            double f0 = f(m0);
+            double f1 = f(m1);
+            double d0 = df(m0) * h;
+            double d1 = df(m1) * h;
+            coefficients[i][0] = f0;
+            coefficients[i][1] = d0;
+            coefficients[i][2] = 3 * (f1 - f0) - 2 * d0 - d1;
+            coefficients[i][3] = 2 * (f0 - f1) + d0 + d1;
         }
+    }
 
-        printMenuDivider(); // Print menu divider
+    // Function to interpolate at mantissa in [1, 2)
+    double operator()(double mantissa) const
+    {
+        double position = (mantissa - 1.0) * INTERVALS;
+        int i = static_cast<int>(position);
+        double t = position - i;
+        const std::array<double, 4> &c = coefficients[i];
+        return ((c[3] * t + c[2]) * t + c[1]) * t + c[0];
+    }
+};
 
-        // Display Chinese Weapons
-        std::cout << "Chinese Weapons:\n";
-        for (; i < 24; i++)
-        {
-            printWeaponOption(i, 24); // Print weapon options
-        }
+// Table of x^(NUMERATOR/DENOMINATOR) for positive x between 2^MIN_BINADE and 2^(MAX_BINADE+1)
+template <int NUMERATOR, int DENOMINATOR>
+struct PowerTable
+{
+    static constexpr double EXPONENT = static_cast<double>(NUMERATOR) / DENOMINATOR;
+    static constexpr int MIN_BINADE = -64;
+    static constexpr int MAX_BINADE = 64;
 
-        printMenuDivider(); // Print menu divider
+    // Relative Hermite interpolation error of the mantissa table
+    static constexpr double interpolationBound()
+    {
+        double h = 1.0 / MantissaTable::INTERVALS;
+        double derivative = EXPONENT * (EXPONENT - 1) * (EXPONENT - 2) * (EXPONENT - 3); // |f''''| peaks at m = 1
+        return (derivative < 0 ? -derivative : derivative) * h * h * h * h / 384;
+    }
+    static constexpr double ERROR_BOUND = 1e-11; // Relative, including table and evaluation rounding
 
-        // Display Other Nuclear Powers
-        std::cout << "Other Nuclear Powers:\n";
-        for (; i < PRESETS.size(); i++)
+    MantissaTable mantissa;
+    std::array<double, MAX_BINADE - MIN_BINADE + 1> binade{}; // (2^e)^EXPONENT
+
+    constexpr PowerTable()
+    {
+        mantissa.build([](double m) { return constexprExp(EXPONENT * constexprLog(m)); },
+                       [](double m) { return EXPONENT * constexprExp((EXPONENT - 1) * constexprLog(m)); });
+        for (int e = MIN_BINADE; e <= MAX_BINADE; e++)
         {
-            printWeaponOption(i, PRESETS.size()); // Print weapon options
+            binade[e - MIN_BINADE] = constexprExp(EXPONENT * e * 0.693147180559945309417);
         }
+    }
 
-        printMenuDivider();                                    // Print menu divider
-        std::cout << PRESETS.size() + 1 << ". Custom Input\n"; // Print custom input option
-        printMenuDivider();                                    // Print menu divider
+    // Function to evaluate x^EXPONENT, falling back to std::pow outside the table range
+    double operator()(double x) const
+    {
+        double m;
+        int e = splitBinade(x, m);
+        if (!(x > 0) || e < MIN_BINADE || e > MAX_BINADE)
+            return pow(x, EXPONENT);
+        return binade[e - MIN_BINADE] * mantissa(m);
     }
+};
+
+// Table of log10(x) for positive normal x, absolute error below ERROR_BOUND
+struct Log10Table
+{
+    static constexpr double LOG10_2 = 0.301029995663981195214;
 
-    // Function to calculate optimal height of burst
-    OptimalHeight calculateOptimalHeight()
+    static constexpr double interpolationBound()
     {
-        OptimalHeight oh;
-        // Height of burst calculations based on yield
-        double yieldFactor = pow(yield, 1.0 / 3.0); // Cube root scaling
-        oh.thermal = 220 * yieldFactor;             // Optimal for thermal effects
-        oh.blast = 180 * yieldFactor;               // Optimal for blast effects
-        oh.combined = 200 * yieldFactor;            // Compromise height
-        return oh;
+        double h = 1.0 / MantissaTable::INTERVALS;
+        return 6 / 2.302585092994045684 * h * h * h * h / 384; // |f''''| = 6/(m^4 ln 10)
     }
+    static constexpr double ERROR_BOUND = 3e-11; // Absolute, including table and evaluation rounding
 
-    // Function to set burst parameters
-    void setBurstParameters()
+    MantissaTable mantissa;
+
+    constexpr Log10Table()
     {
-        clearScreen();                           // Clear the screen
-        printMenuHeader("Burst Type Selection"); // Print menu header
+        mantissa.build([](double m) { return constexprLog(m) / 2.302585092994045684; },
+                       [](double m) { return 1 / (m * 2.302585092994045684); });
+    }
 
-        OptimalHeight oh = calculateOptimalHeight(); // Calculate optimal heights
+    // Function to evaluate log10(x), falling back to std::log10 for zero, negative and subnormal x
+    double operator()(double x) const
+    {
+        double m;
+        int e = splitBinade(x, m);
+        if (!(x >= 2.2250738585072014e-308) || e > 1023)
+            return log10(x);
+        return e * LOG10_2 + mantissa(m);
+    }
+};
 
-        std::cout << "Optimal Heights Analysis:\n";                          // Print optimal heights
-        std::cout << "Thermal effects:     " << (int)oh.thermal << "m\n";    // Print thermal effects
-        std::cout << "Blast effects:       " << (int)oh.blast << "m\n";      // Print blast effects
-        std::cout << "Combined optimum:    " << (int)oh.combined << "m\n\n"; // Print combined effects
+// Rounding allowance of the tables: a few ulps from generation, interpolation and the binade product
+constexpr double TABLE_ROUNDING = 16 * 2.220446049250313e-16;
+static_assert(PowerTable<1, 3>::interpolationBound() + TABLE_ROUNDING <= PowerTable<1, 3>::ERROR_BOUND, "x^(1/3) table too coarse");
+static_assert(PowerTable<2, 5>::interpolationBound() + TABLE_ROUNDING <= PowerTable<2, 5>::ERROR_BOUND, "x^0.4 table too coarse");
+static_assert(PowerTable<19, 100>::interpolationBound() + TABLE_ROUNDING <= PowerTable<19, 100>::ERROR_BOUND, "x^0.19 table too coarse");
+static_assert(PowerTable<3, 8>::interpolationBound() + TABLE_ROUNDING <= PowerTable<3, 8>::ERROR_BOUND, "x^0.375 table too coarse");
+static_assert(Log10Table::interpolationBound() + 1024 * TABLE_ROUNDING <= Log10Table::ERROR_BOUND, "log10 table too coarse");
 
-        std::cout << "Select burst type:\n";
-        std::cout << std::string(78, '-') << "\n";
-        std::cout << "1. Surface Burst     | Height: 0m              | Maximum fallout, reduced blast radius\n";
-        std::cout << std::string(78, '-') << "\n";
-        std::cout << "2. Optimal Air Burst | Height: " << std::setw(5) << (int)oh.combined << "m          | Best combined blast/thermal effects\n";
-        std::cout << std::string(78, '-') << "\n";
-        std::cout << "3. Low Air Burst     | Height: " << std::setw(5) << (int)(oh.combined * 0.7) << "m          | Balanced effects, moderate fallout\n";
-        std::cout << std::string(78, '-') << "\n";
-        std::cout << "4. High Air Burst    | Height: " << std::setw(5) << (int)(oh.combined * 1.5) << "m          | Minimum fallout, reduced effects\n";
-        std::cout << std::string(78, '-') << "\n";
-        std::cout << "5. Thermal Optimized | Height: " << std::setw(5) << (int)oh.thermal << "m          | Maximum thermal radiation effects\n";
-        std::cout << std::string(78, '-') << "\n";
-        std::cout << "6. Blast Optimized   | Height: " << std::setw(5) << (int)oh.blast << "m          | Maximum blast wave effects\n";
-        std::cout << std::string(78, '-') << "\n";
+inline constexpr PowerTable<1, 3> CUBE_ROOT_TABLE{};
+inline constexpr PowerTable<2, 5> POW_0_4_TABLE{};
+inline constexpr PowerTable<19, 100> POW_0_19_TABLE{};
+inline constexpr PowerTable<3, 8> POW_0_375_TABLE{};
+inline constexpr Log10Table LOG10_TABLE{};
+
+// Yield scaling through the standard library
+struct ExactYieldScaling
+{
+    template <typename Real>
+    static Real cubeRoot(Real x)
+    {
+        using std::pow;
+        return pow(x, Real(1.0) / Real(3.0));
+    }
+    template <typename Real>
+    static Real pow0_4(Real x)
+    {
+        using std::pow;
+        return pow(x, Real(0.4));
+    }
+    template <typename Real>
+    static Real pow0_19(Real x)
+    {
+        using std::pow;
+        return pow(x, Real(0.19));
+    }
+    template <typename Real>
+    static Real pow0_375(Real x)
+    {
+        using std::pow;
+        return pow(x, Real(0.375));
+    }
+    template <typename Real>
+    static Real log10(Real x)
+    {
+        using std::log10;
+        return log10(x);
+    }
+};
+
+// Yield scaling through the compile-time tables, evaluated in double
+struct TabulatedYieldScaling
+{
+    template <typename Real>
+    static Real cubeRoot(Real x) { return Real(CUBE_ROOT_TABLE(double(x))); }
+    template <typename Real>
+    static Real pow0_4(Real x) { return Real(POW_0_4_TABLE(double(x))); }
+    template <typename Real>
+    static Real pow0_19(Real x) { return Real(POW_0_19_TABLE(double(x))); }
+    template <typename Real>
+    static Real pow0_375(Real x) { return Real(POW_0_375_TABLE(double(x))); }
+    template <typename Real>
+    static Real log10(Real x) { return Real(LOG10_TABLE(double(x))); }
+};
+
+/*******************************************************************************
+ * Standard atmosphere
+ *
+ * STANDARD_ATMOSPHERE tabulates temperature, pressure and density of the US
+ * Standard Atmosphere 1976 every 100 m from -1 km to 86 km geometric altitude,
+ * generated at compile time from the seven layers of the model. Lookups are
+ * linear interpolation between two entries. The relative pressure and density
+ * error against the full model is below 5e-4 where an interval straddles a
+ * layer boundary (the temperature kink at the tropopause is the worst) and
+ * about 4e-5 elsewhere.
+ *
+ * The blast and thermal kernels take their ambient conditions as arguments.
+ * AtmosphereModel::Legacy reproduces the original constants (sea level
+ * pressure, 0.17/km extinction, 7400 m scale height) and is the default;
+ * AtmosphereModel::Standard derives them from the table at the ground
+ * elevation and burst height of the scenario.
+ ******************************************************************************/
+
+// Temperature, pressure and density at one altitude
+struct AtmosphereState
+{
+    double temperature; // K
+    double pressure;    // Pa
+    double density;     // kg/m³
+};
+
+// Function to evaluate the US Standard Atmosphere 1976 at a geometric altitude (m), usable in constant expressions
+// Valid from -5 km to 86 km; below 86 km the model is defined in geopotential altitude over seven layers
+// with constant lapse rates, integrated hydrostatically from the sea level state
+constexpr AtmosphereState standardAtmosphereAt(double altitude)
+{
+    const double EARTH_RADIUS = 6356766.0;            // Effective radius of the model (m)
+    const double GAS_CONSTANT = 8.31432;              // Universal gas constant of the model (J/(mol·K))
+    const double MOLAR_MASS = 0.0289644;              // Mean molar mass of air (kg/mol)
+    const double HYDROSTATIC = PhysicalConstants::GRAVITY * MOLAR_MASS / GAS_CONSTANT; // g0 M / R* (K/m)
+    const double BASES[8] = {0, 11000, 20000, 32000, 47000, 51000, 71000, 84852}; // Geopotential layer bases (m)
+    const double LAPSE_RATES[7] = {-0.0065, 0, 0.001, 0.0028, 0, -0.0028, -0.002}; // K/m
+
+    double geopotential = EARTH_RADIUS * altitude / (EARTH_RADIUS + altitude);
+    geopotential = std::min(geopotential, BASES[7]);
+
+    double temperature = 288.15;
+    double pressure = PhysicalConstants::ATMOSPHERIC_PRESSURE;
+    for (int layer = 0; layer < 7; layer++)
+    {
+        double top = BASES[layer + 1];
+        double span = std::min(geopotential, top) - BASES[layer]; // Negative below sea level
+        double lapse = LAPSE_RATES[layer];
+        double next = temperature + lapse * span;
+        pressure *= lapse == 0 ? constexprExp(-HYDROSTATIC * span / temperature)
+                               : constexprExp(HYDROSTATIC / lapse * constexprLog(temperature / next));
+        temperature = next;
+        if (geopotential <= top)
+            break;
+    }
+    return {temperature, pressure, pressure * MOLAR_MASS / (GAS_CONSTANT * temperature)};
+}
+
+// Compile-time table of the standard atmosphere with linear interpolation
+struct StandardAtmosphereTable
+{
+    static constexpr double MIN_ALTITUDE = -1000.0; // m
+    static constexpr double MAX_ALTITUDE = 86000.0; // m, the top of the lower atmosphere model
+    static constexpr double STEP = 100.0;           // m
+    static constexpr size_t ENTRIES = static_cast<size_t>((MAX_ALTITUDE - MIN_ALTITUDE) / STEP) + 1;
+
+    std::array<AtmosphereState, ENTRIES> states{};
+
+    constexpr StandardAtmosphereTable()
+    {
+        for (size_t i = 0; i < ENTRIES; i++)
+        {
+            states[i] = standardAtmosphereAt(MIN_ALTITUDE + STEP * static_cast<double>(i));
+        }
+    }
+
+    // Function to look up the atmosphere at a geometric altitude (m), clamped to the table range
+    constexpr AtmosphereState operator()(double altitude) const
+    {
+        double position = (std::min(std::max(altitude, MIN_ALTITUDE), MAX_ALTITUDE) - MIN_ALTITUDE) / STEP;
+        size_t i = std::min(static_cast<size_t>(position), ENTRIES - 2);
+        double t = position - static_cast<double>(i);
+        const AtmosphereState &low = states[i];
+        const AtmosphereState &high = states[i + 1];
+        return {low.temperature + t * (high.temperature - low.temperature),
+                low.pressure + t * (high.pressure - low.pressure),
+                low.density + t * (high.density - low.density)};
+    }
+};
+
+inline constexpr StandardAtmosphereTable STANDARD_ATMOSPHERE{};
+
+// Reference values of the published 1976 tables at geometric altitudes
+constexpr bool closeTo(double value, double reference, double tolerance)
+{
+    return value > reference * (1 - tolerance) && value < reference * (1 + tolerance);
+}
+static_assert(closeTo(STANDARD_ATMOSPHERE(0).density, 1.2250, 1e-4), "sea level density");
+static_assert(closeTo(STANDARD_ATMOSPHERE(11000).pressure, 22699.9, 1e-4), "pressure at 11 km");
+static_assert(closeTo(STANDARD_ATMOSPHERE(20000).pressure, 5529.3, 1e-4), "pressure at 20 km");
+static_assert(closeTo(STANDARD_ATMOSPHERE(50000).temperature, 270.65, 1e-4), "temperature at 50 km");
+static_assert(closeTo(STANDARD_ATMOSPHERE(-1000).pressure, 113929, 1e-4), "pressure at -1 km");
+
+// Atmosphere model of the blast and thermal kernels
+enum class AtmosphereModel
+{
+    Legacy,  // Sea level pressure, 0.17/km extinction and a 7400 m scale height everywhere
+    Standard // US Standard Atmosphere 1976 at the ground elevation and burst height
+};
+
+// Atmosphere selection of a scenario
+struct AtmosphereOptions
+{
+    AtmosphereModel model = AtmosphereModel::Legacy;
+    double groundElevation = 0; // Ground zero above sea level (m), Standard only
+};
+
+// Ambient conditions the blast and thermal kernels take as arguments
+struct AtmosphereConditions
+{
+    double pressure = PhysicalConstants::ATMOSPHERIC_PRESSURE; // Ambient pressure at the ground (Pa)
+    double attenuation = 0.17;                                 // Thermal extinction along the ground (1/km)
+    double scaleHeight = 7400.0;                               // Of the burst height factor exp(-height/scaleHeight) (m)
+};
+
+// Function to derive the ambient conditions of a burst height (m) above the ground
+// Standard: Sachs scaling with the pressure at the ground, extinction in proportion to the air density
+// there, and the burst height factor equal to the density ratio between burst point and ground
+inline AtmosphereConditions makeAtmosphereConditions(const AtmosphereOptions &options, double height)
+{
+    AtmosphereConditions conditions;
+    if (options.model == AtmosphereModel::Legacy)
+        return conditions;
+
+    const AtmosphereState SEA_LEVEL = STANDARD_ATMOSPHERE(0);
+    AtmosphereState ground = STANDARD_ATMOSPHERE(options.groundElevation);
+    conditions.pressure = ground.pressure;
+    conditions.attenuation *= ground.density / SEA_LEVEL.density;
+    if (height > 0)
+    {
+        AtmosphereState burst = STANDARD_ATMOSPHERE(options.groundElevation + height);
+        double ratio = ground.density / burst.density;
+        if (ratio > 1)
+            conditions.scaleHeight = height / log(ratio);
+    }
+    return conditions;
+}
+
+/*******************************************************************************
+ * Population rasters
+ *
+ * Raster files (effect fields and population grids) share one layout: a
+ * 64-byte RasterHeader, width * height float values row by row from the
+ * north-west corner, and optionally, at the next 64-byte boundary, row prefix
+ * sums of the values as double, width + 1 per row. All in host byte order.
+ * Positions are in meters in a local frame whose origin is ground zero.
+ *
+ * PopulationRaster memory-maps a population file (people per cell) and
+ * answers the population of cells whose centers lie inside a disk, ring or
+ * ellipse from the row prefix sums: two lookups per covered row instead of a
+ * scan of the cells. Files without stored prefix sums get them built at load;
+ * writePopulationIndex() stores them so that loading only maps the file.
+ ******************************************************************************/
+
+// Field of a raster file
+enum class RasterField
+{
+    Overpressure,      // Peak overpressure (Pa), calculateBlastOverpressure
+    ThermalFluence,    // Thermal fluence (J/m²), calculateThermalRadiation
+    FalloutDeposition, // Relative fallout deposition, FalloutRasterizer
+    Population         // People per cell, PopulationRaster
+};
+
+// Header of a raster file
+struct RasterHeader
+{
+    char magic[8];       // "NUCRAST\0"
+    uint32_t version;    // RASTER_VERSION
+    uint16_t field;      // RasterField
+    uint16_t flags;      // RASTER_ROW_PREFIX
+    uint64_t width;      // Cells per row
+    uint64_t height;     // Rows
+    double cellSize;     // Cell edge length (m)
+    uint64_t dataOffset; // First value, sizeof(RasterHeader)
+    double west;         // Easting of the western edge (m), version 2
+    double north;        // Northing of the northern edge (m), version 2
+};
+
+static_assert(sizeof(RasterHeader) == 64, "raster header layout");
+
+constexpr uint32_t RASTER_VERSION = 2;    // Version 1 files have no edges and are centered on ground zero
+constexpr uint16_t RASTER_ROW_PREFIX = 1; // Row prefix sums follow the values
+
+// Function to get the offset of the row prefix sums of a raster
+inline uint64_t rasterPrefixOffset(const RasterHeader &header)
+{
+    return (header.dataOffset + header.width * header.height * sizeof(float) + 63) / 64 * 64;
+}
+
+// Read-only contents of a file, memory-mapped where the platform supports it
+class MappedFile
+{
+private:
+    const char *bytes = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    std::vector<char> buffer; // Read into memory
+#endif
+
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile()
+    {
+#ifndef _WIN32
+        if (bytes && length)
+            munmap(const_cast<char *>(bytes), length);
+#endif
+    }
+
+    // Function to map a whole file, returns false if it cannot be read
+    bool open(const char *path)
+    {
+#ifdef _WIN32
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+            return false;
+        buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        bytes = buffer.data();
+        length = buffer.size();
+        return !in.bad();
+#else
+        int descriptor = ::open(path, O_RDONLY);
+        if (descriptor < 0)
+            return false;
+        struct stat status;
+        bool mapped = false;
+        if (fstat(descriptor, &status) == 0 && status.st_size > 0)
+        {
+            void *address = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+            if (address != MAP_FAILED)
+            {
+                bytes = static_cast<const char *>(address);
+                length = static_cast<size_t>(status.st_size);
+                mapped = true;
+            }
+        }
+        ::close(descriptor); // The mapping stays valid
+        return mapped;
+#endif
+    }
+
+    const char *data() const { return bytes; }
+    size_t size() const { return length; }
+};
+
+// Memory-mapped population grid with a row prefix sum index
+class PopulationRaster
+{
+private:
+    MappedFile file;
+    RasterHeader header = {};
+    const double *prefix = nullptr;  // Row prefix sums, width + 1 per row
+    std::vector<double> builtPrefix; // Prefix sums built at load when the file has none
+
+    // Function to sum the cells of rows with centers in [yMin, yMax] (m) and, per row, centers in the
+    // easting interval span(y, west, east) returns true for
+    template <typename Span>
+    double sumRows(double yMin, double yMax, Span &&span) const
+    {
+        const double cell = header.cellSize;
+        double firstRow = std::max(std::ceil((header.north - yMax) / cell - 0.5), 0.0);
+        double lastRow = std::min(std::floor((header.north - yMin) / cell - 0.5), double(header.height) - 1);
+        if (!(firstRow <= lastRow))
+            return 0;
+
+        double sum = 0;
+        for (size_t r = static_cast<size_t>(firstRow); r <= static_cast<size_t>(lastRow); r++)
+        {
+            double west, east;
+            if (!span(header.north - (double(r) + 0.5) * cell, west, east))
+                continue;
+            double first = std::max(std::ceil((west - header.west) / cell - 0.5), 0.0);
+            double last = std::min(std::floor((east - header.west) / cell - 0.5), double(header.width) - 1);
+            if (first > last)
+                continue;
+            const double *row = prefix + r * (header.width + 1);
+            sum += row[static_cast<size_t>(last) + 1] - row[static_cast<size_t>(first)];
+        }
+        return sum;
+    }
+
+public:
+    // Function to load a population raster file, returns false with a message in error on failure
+    bool open(const char *path, std::string &error)
+    {
+        if (!file.open(path))
+        {
+            error = std::string("cannot read ") + path;
+            return false;
+        }
+        if (file.size() < sizeof(RasterHeader) || memcmp(file.data(), "NUCRAST", 8))
+        {
+            error = std::string(path) + " is not a raster file";
+            return false;
+        }
+        memcpy(&header, file.data(), sizeof(header));
+        if (header.version < 1 || header.version > RASTER_VERSION ||
+            header.field != static_cast<uint16_t>(RasterField::Population) || !(header.cellSize > 0) ||
+            header.width == 0 || header.height == 0 || header.dataOffset % alignof(float) ||
+            header.dataOffset > file.size() || // Each bound on its own, so no product or sum of header fields wraps
+            header.width > (file.size() - header.dataOffset) / sizeof(float) / header.height)
+        {
+            error = std::string(path) + " is not a valid population raster";
+            return false;
+        }
+        if (header.version == 1)
+        {
+            header.west = -0.5 * header.cellSize * double(header.width);
+            header.north = 0.5 * header.cellSize * double(header.height);
+        }
+
+        // The cells fit in the file, so neither the prefix offset nor its size can wrap
+        uint64_t prefixOffset = rasterPrefixOffset(header);
+        uint64_t prefixSize = header.height * (header.width + 1) * sizeof(double);
+        if ((header.flags & RASTER_ROW_PREFIX) && prefixOffset <= file.size() && prefixSize <= file.size() - prefixOffset)
+        {
+            prefix = reinterpret_cast<const double *>(file.data() + prefixOffset);
+            return true;
+        }
+
+        const float *cells = values();
+        builtPrefix.resize(header.height * (header.width + 1));
+        for (size_t r = 0; r < header.height; r++)
+        {
+            double *row = &builtPrefix[r * (header.width + 1)];
+            row[0] = 0;
+            for (size_t c = 0; c < header.width; c++)
+                row[c + 1] = row[c] + cells[r * header.width + c];
+        }
+        prefix = builtPrefix.data();
+        return true;
+    }
+
+    const RasterHeader &info() const { return header; }
+    const float *values() const { return reinterpret_cast<const float *>(file.data() + header.dataOffset); }
+    const double *rowPrefix() const { return prefix; }
+
+    // Function to get whether the row prefix sums were mapped from the file rather than built at load
+    bool hasStoredIndex() const { return prefix && builtPrefix.empty(); }
+
+    // Function to get the total population of the raster
+    double totalPopulation() const
+    {
+        return sumRows(-HUGE_VAL, HUGE_VAL, [](double, double &west, double &east)
+                       { west = -HUGE_VAL; east = HUGE_VAL; return true; });
+    }
+
+    // Function to get the population within radius (m) of (x, y) (m)
+    double populationInDisk(double x, double y, double radius) const
+    {
+        if (!(radius > 0))
+            return 0;
+        return sumRows(y - radius, y + radius, [&](double rowY, double &west, double &east)
+                       {
+            double dy = rowY - y;
+            double half = radius * radius - dy * dy;
+            if (half < 0)
+                return false;
+            half = std::sqrt(half);
+            west = x - half;
+            east = x + half;
+            return true; });
+    }
+
+    // Function to get the population between two radii (m) around (x, y) (m)
+    double populationInRing(double x, double y, double inner, double outer) const
+    {
+        return populationInDisk(x, y, outer) - populationInDisk(x, y, inner);
+    }
+
+    // Function to get the population within an ellipse centered on (x, y) (m) with the given semi-axes (m),
+    // the major axis pointing along bearing (degrees clockwise from north)
+    double populationInEllipse(double x, double y, double semiMajor, double semiMinor, double bearing) const
+    {
+        if (!(semiMajor > 0) || !(semiMinor > 0))
+            return 0;
+        double theta = bearing * M_PI / 180.0;
+        double sine = std::sin(theta), cosine = std::cos(theta);
+        double a2 = semiMajor * semiMajor, b2 = semiMinor * semiMinor;
+
+        // Along a row at offset dy the ellipse is A dx² + B dx + C <= 1
+        double A = sine * sine / a2 + cosine * cosine / b2;
+        double extent = std::sqrt(a2 * cosine * cosine + b2 * sine * sine); // Northing half-extent
+        return sumRows(y - extent, y + extent, [&](double rowY, double &west, double &east)
+                       {
+            double dy = rowY - y;
+            double B = 2 * dy * sine * cosine * (1 / a2 - 1 / b2);
+            double C = dy * dy * (cosine * cosine / a2 + sine * sine / b2);
+            double discriminant = B * B - 4 * A * (C - 1);
+            if (discriminant < 0)
+                return false;
+            double root = std::sqrt(discriminant);
+            west = x + (-B - root) / (2 * A);
+            east = x + (-B + root) / (2 * A);
+            return true; });
+    }
+};
+
+// Function to write a population raster with its row prefix sums, returns false if the stream failed
+inline bool writePopulationIndex(std::ostream &out, const PopulationRaster &population)
+{
+    RasterHeader header = population.info();
+    header.version = RASTER_VERSION;
+    header.flags |= RASTER_ROW_PREFIX;
+    header.dataOffset = sizeof(RasterHeader);
+    uint64_t cells = header.width * header.height;
+
+    static const char ZEROS[64] = {};
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(population.values()), cells * sizeof(float));
+    out.write(ZEROS, rasterPrefixOffset(header) - (header.dataOffset + cells * sizeof(float)));
+    out.write(reinterpret_cast<const char *>(population.rowPrefix()), header.height * (header.width + 1) * sizeof(double));
+    out.flush();
+    return static_cast<bool>(out);
+}
+
+/*******************************************************************************
+ * Catalogs
+ *
+ * A Catalog holds the cities and weapon presets that scenarios refer to by
+ * index, with a hash index for looking cities up by name. The built-in tables
+ * are the default catalog; --catalog replaces it at startup with one loaded
+ * from a text file or from a binary snapshot written by --compile-catalog.
+ *
+ * Text catalogs hold one comma separated record per line ('#' starts a
+ * comment line):
+ *
+ *   city,<name>,<country>,<population_millions>,<area_km2>,<density_km2>,<radius_km>,<suburban_density_km2>
+ *   preset,<name>,<type>,<yield_mt>,air|surface,<height_m>
+ *
+ * Records of a kind replace the built-in table of that kind; a file with only
+ * cities keeps the built-in presets. Snapshots are memory-mapped: the names
+ * stay in the mapping and the hash index is used in place, so loading tens of
+ * thousands of cities only converts the fixed-size records.
+ *
+ * Snapshot layout, host byte order:
+ *   CatalogHeader, CatalogCity[cityCount], CatalogPreset[presetCount],
+ *   uint32_t index[indexSize] (city index + 1, 0 = empty, linear probing on
+ *   the FNV-1a hash of the name), then the name strings.
+ ******************************************************************************/
+
+constexpr size_t CATALOG_NAME_LIMIT = 128; // Longest name or country, keeps result records bounded
+
+// Function to hash a city name for the catalog index (64-bit FNV-1a)
+inline uint64_t hashCityName(std::string_view name)
+{
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (char c : name)
+    {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+// Snapshot header
+struct CatalogHeader
+{
+    char magic[8];          // "NUCCATL\0"
+    uint32_t version;       // CATALOG_VERSION
+    uint32_t flags;         // CATALOG_BUILTIN_PRESETS
+    uint64_t cityCount;
+    uint64_t presetCount;
+    uint64_t indexSize;     // Hash index entries, a power of two
+    uint64_t stringsOffset; // Name strings
+    uint64_t stringsSize;
+    uint64_t fileSize;      // Total size, checked at load
+};
+
+// Snapshot city record; strings are offsets into the name strings
+struct CatalogCity
+{
+    uint32_t nameOffset, nameLength;
+    uint32_t countryOffset, countryLength;
+    double population, area, density, radius, suburbanDensity;
+};
+
+// Snapshot preset record
+struct CatalogPreset
+{
+    uint32_t nameOffset, nameLength;
+    uint32_t typeOffset, typeLength;
+    double yield;
+    double typicalHeight;
+    uint32_t isAirburst;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(CatalogHeader) == 64 && sizeof(CatalogCity) == 56 && sizeof(CatalogPreset) == 40,
+              "catalog snapshot layout");
+
+constexpr uint32_t CATALOG_VERSION = 1;
+constexpr uint32_t CATALOG_BUILTIN_PRESETS = 1; // The presets are the built-in table, shown in groups
+
+class Catalog
+{
+private:
+    std::vector<CityData> cityList;
+    std::vector<WeaponPreset> presetList;
+    std::vector<uint32_t> builtIndex; // Hash index built at load, unless mapped from a snapshot
+    const uint32_t *index = nullptr;
+    size_t indexSize = 0;
+    bool builtinPresets = false; // presetList holds the built-in PRESETS
+    std::string text;            // Contents of a text catalog, the names point into it
+    MappedFile mapped;           // Contents of a snapshot
+
+    // Function to build the hash index over cityList
+    void buildIndex()
+    {
+        indexSize = 1;
+        while (indexSize < 2 * cityList.size())
+            indexSize *= 2;
+        builtIndex.assign(indexSize, 0);
+        for (size_t i = 0; i < cityList.size(); i++)
+        {
+            size_t slot = hashCityName(cityList[i].name) & (indexSize - 1);
+            while (builtIndex[slot] != 0)
+            {
+                if (cityList[builtIndex[slot] - 1].name == cityList[i].name)
+                    break; // Duplicate name, the first city keeps it
+                slot = (slot + 1) & (indexSize - 1);
+            }
+            if (builtIndex[slot] == 0)
+                builtIndex[slot] = static_cast<uint32_t>(i + 1);
+        }
+        index = builtIndex.data();
+    }
+
+    // Function to check a catalog name
+    static bool validName(std::string_view name)
+    {
+        if (name.empty() || name.size() > CATALOG_NAME_LIMIT)
+            return false;
+        for (char c : name)
+        {
+            if (static_cast<unsigned char>(c) < 0x20)
+                return false;
+        }
+        return true;
+    }
+
+    // Function to check the names and model inputs of a city record, of a text catalog or a snapshot
+    static bool validCity(const CityData &city)
+    {
+        return validName(city.name) && validName(city.country) && std::isfinite(city.population) &&
+               std::isfinite(city.area) && std::isfinite(city.density) && std::isfinite(city.radius) &&
+               std::isfinite(city.suburban_density) && city.radius > 0 && city.density >= 0 &&
+               city.suburban_density >= 0;
+    }
+
+    // Function to check the names and numbers of a preset record, of a text catalog or a snapshot
+    static bool validPreset(const WeaponPreset &preset)
+    {
+        return validName(preset.name) && validName(preset.type) && std::isfinite(preset.yield) &&
+               std::isfinite(preset.typicalHeight) && preset.yield > 0 && preset.typicalHeight >= 0;
+    }
+
+    bool parseText(const char *path, std::string &error);
+    bool parseSnapshot(const char *path, std::string &error);
+
+    struct BuiltinTables
+    {
+    };
+
+    explicit Catalog(BuiltinTables)
+        : cityList(CITIES.begin(), CITIES.end()), presetList(PRESETS.begin(), PRESETS.end()), builtinPresets(true)
+    {
+        buildIndex();
+    }
+
+public:
+    Catalog() = default;
+    Catalog(const Catalog &) = delete;
+    Catalog &operator=(const Catalog &) = delete;
+
+    // Function to get the catalog of the built-in tables
+    static const Catalog &builtin()
+    {
+        static const Catalog tables{BuiltinTables()};
+        return tables;
+    }
+
+    const std::vector<CityData> &cities() const { return cityList; }
+    const std::vector<WeaponPreset> &presets() const { return presetList; }
+    bool hasBuiltinPresets() const { return builtinPresets; }
+
+    // Function to look up a city by its exact name, returns cities().size() if there is none
+    size_t findCity(std::string_view name) const
+    {
+        size_t slot = hashCityName(name) & (indexSize - 1);
+        for (size_t probe = 0; probe < indexSize && index[slot] != 0; probe++)
+        {
+            size_t city = index[slot] - 1;
+            if (city < cityList.size() && cityList[city].name == name)
+                return city;
+            slot = (slot + 1) & (indexSize - 1);
+        }
+        return cityList.size();
+    }
+
+    // Function to load a text catalog or a snapshot, returns false with a message in error on failure
+    bool load(const char *path, std::string &error)
+    {
+        char magic[8] = {};
+        std::ifstream probe(path, std::ios::binary);
+        if (!probe)
+        {
+            error = std::string("cannot read ") + path;
+            return false;
+        }
+        probe.read(magic, sizeof(magic));
+        probe.close();
+        return memcmp(magic, "NUCCATL", 8) ? parseText(path, error) : parseSnapshot(path, error);
+    }
+
+    // Function to write the catalog as a snapshot, returns false if the stream failed
+    bool writeSnapshot(std::ostream &out) const;
+};
+
+// Function to split a text catalog line at commas, trimming spaces; returns the number of fields
+inline size_t splitCatalogLine(std::string_view line, std::string_view *fields, size_t limit)
+{
+    size_t count = 0;
+    while (count < limit)
+    {
+        size_t comma = line.find(',');
+        std::string_view field = line.substr(0, comma);
+        while (!field.empty() && (field.front() == ' ' || field.front() == '\t'))
+            field.remove_prefix(1);
+        while (!field.empty() && (field.back() == ' ' || field.back() == '\t' || field.back() == '\r'))
+            field.remove_suffix(1);
+        fields[count++] = field;
+        if (comma == std::string_view::npos)
+            return count;
+        line.remove_prefix(comma + 1);
+    }
+    return limit + 1; // Too many fields
+}
+
+// Function to parse a number of a text catalog field, which must be the whole field
+inline bool parseCatalogNumber(std::string_view field, double &value)
+{
+    char buffer[64];
+    if (field.empty() || field.size() >= sizeof(buffer))
+        return false;
+    memcpy(buffer, field.data(), field.size());
+    buffer[field.size()] = '\0';
+    char *end;
+    value = strtod(buffer, &end);
+    return *end == '\0' && std::isfinite(value);
+}
+
+inline bool Catalog::parseText(const char *path, std::string &error)
+{
+    std::ifstream in(path, std::ios::binary);
+    text.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    if (in.bad())
+    {
+        error = std::string("error reading ") + path;
+        return false;
+    }
+
+    std::string_view rest(text);
+    size_t lineNumber = 0;
+    while (!rest.empty())
+    {
+        size_t newline = rest.find('\n');
+        std::string_view line = rest.substr(0, newline);
+        rest.remove_prefix(newline == std::string_view::npos ? rest.size() : newline + 1);
+        lineNumber++;
+
+        std::string_view fields[8];
+        size_t count = splitCatalogLine(line, fields, 8);
+        if ((count == 1 && fields[0].empty()) || (!fields[0].empty() && fields[0].front() == '#'))
+            continue; // Blank or comment line
+
+        bool valid = false;
+        if (fields[0] == "city" && count == 8)
+        {
+            CityData city = {fields[1], fields[2], 0, 0, 0, 0, 0};
+            valid = parseCatalogNumber(fields[3], city.population) && parseCatalogNumber(fields[4], city.area) &&
+                    parseCatalogNumber(fields[5], city.density) && parseCatalogNumber(fields[6], city.radius) &&
+                    parseCatalogNumber(fields[7], city.suburban_density) && validCity(city);
+            if (valid)
+                cityList.push_back(city);
+        }
+        else if (fields[0] == "preset" && count == 6)
+        {
+            WeaponPreset preset = {fields[1], fields[2], 0, fields[4] == "air", 0};
+            valid = (fields[4] == "air" || fields[4] == "surface") && parseCatalogNumber(fields[3], preset.yield) &&
+                    parseCatalogNumber(fields[5], preset.typicalHeight) && validPreset(preset);
+            if (valid)
+                presetList.push_back(preset);
+        }
+        if (!valid)
+        {
+            error = std::string(path) + ": invalid record on line " + std::to_string(lineNumber);
+            return false;
+        }
+    }
+
+    if (cityList.empty())
+        cityList.assign(CITIES.begin(), CITIES.end());
+    if (presetList.empty())
+    {
+        presetList.assign(PRESETS.begin(), PRESETS.end());
+        builtinPresets = true;
+    }
+    if (cityList.size() >= UINT32_MAX)
+    {
+        error = std::string(path) + ": too many cities";
+        return false;
+    }
+    buildIndex();
+    return true;
+}
+
+inline bool Catalog::parseSnapshot(const char *path, std::string &error)
+{
+    error = std::string(path) + " is not a valid catalog snapshot";
+    if (!mapped.open(path) || mapped.size() < sizeof(CatalogHeader))
+        return false;
+
+    CatalogHeader header;
+    memcpy(&header, mapped.data(), sizeof(header));
+    uint64_t citiesOffset = sizeof(CatalogHeader);
+    uint64_t presetsOffset = citiesOffset + header.cityCount * sizeof(CatalogCity);
+    uint64_t indexOffset = presetsOffset + header.presetCount * sizeof(CatalogPreset);
+    if (header.version != CATALOG_VERSION || header.fileSize != mapped.size() ||
+        header.cityCount == 0 || header.cityCount >= UINT32_MAX || header.presetCount == 0 ||
+        header.presetCount > mapped.size() || header.cityCount > mapped.size() ||
+        header.indexSize > mapped.size() || header.indexSize < header.cityCount || (header.indexSize & (header.indexSize - 1)) ||
+        header.stringsOffset > mapped.size() || header.stringsSize > mapped.size() - header.stringsOffset ||
+        indexOffset + header.indexSize * sizeof(uint32_t) > header.stringsOffset) // Sizes first, so no sum wraps
+        return false;
+
+    const char *strings = mapped.data() + header.stringsOffset;
+    auto view = [&](uint32_t offset, uint32_t length, std::string_view &out)
+    {
+        if (uint64_t(offset) + length > header.stringsSize)
+            return false;
+        out = std::string_view(strings + offset, length);
+        return true;
+    };
+
+    cityList.resize(header.cityCount);
+    for (size_t i = 0; i < cityList.size(); i++)
+    {
+        CatalogCity record;
+        memcpy(&record, mapped.data() + citiesOffset + i * sizeof(record), sizeof(record));
+        CityData &city = cityList[i];
+        if (!view(record.nameOffset, record.nameLength, city.name) ||
+            !view(record.countryOffset, record.countryLength, city.country))
+            return false;
+        city.population = record.population;
+        city.area = record.area;
+        city.density = record.density;
+        city.radius = record.radius;
+        city.suburban_density = record.suburbanDensity;
+        if (!validCity(city))
+            return false;
+    }
+    presetList.resize(header.presetCount);
+    for (size_t i = 0; i < presetList.size(); i++)
+    {
+        CatalogPreset record;
+        memcpy(&record, mapped.data() + presetsOffset + i * sizeof(record), sizeof(record));
+        WeaponPreset &preset = presetList[i];
+        if (!view(record.nameOffset, record.nameLength, preset.name) ||
+            !view(record.typeOffset, record.typeLength, preset.type))
+            return false;
+        preset.yield = record.yield;
+        preset.isAirburst = record.isAirburst != 0;
+        preset.typicalHeight = record.typicalHeight;
+        if (!validPreset(preset))
+            return false;
+    }
+
+    builtinPresets = (header.flags & CATALOG_BUILTIN_PRESETS) != 0;
+    index = reinterpret_cast<const uint32_t *>(mapped.data() + indexOffset); // Mapping is page aligned
+    indexSize = header.indexSize;
+    error.clear();
+    return true;
+}
+
+inline bool Catalog::writeSnapshot(std::ostream &out) const
+{
+    std::string strings;
+    auto add = [&](std::string_view value, uint32_t &offset, uint32_t &length)
+    {
+        offset = static_cast<uint32_t>(strings.size());
+        length = static_cast<uint32_t>(value.size());
+        strings.append(value);
+    };
+
+    std::vector<CatalogCity> cities(cityList.size());
+    for (size_t i = 0; i < cityList.size(); i++)
+    {
+        const CityData &city = cityList[i];
+        add(city.name, cities[i].nameOffset, cities[i].nameLength);
+        add(city.country, cities[i].countryOffset, cities[i].countryLength);
+        cities[i].population = city.population;
+        cities[i].area = city.area;
+        cities[i].density = city.density;
+        cities[i].radius = city.radius;
+        cities[i].suburbanDensity = city.suburban_density;
+    }
+    std::vector<CatalogPreset> presets(presetList.size());
+    for (size_t i = 0; i < presetList.size(); i++)
+    {
+        const WeaponPreset &preset = presetList[i];
+        presets[i] = {};
+        add(preset.name, presets[i].nameOffset, presets[i].nameLength);
+        add(preset.type, presets[i].typeOffset, presets[i].typeLength);
+        presets[i].yield = preset.yield;
+        presets[i].typicalHeight = preset.typicalHeight;
+        presets[i].isAirburst = preset.isAirburst ? 1 : 0;
+    }
+
+    CatalogHeader header = {};
+    memcpy(header.magic, "NUCCATL", 8);
+    header.version = CATALOG_VERSION;
+    header.flags = builtinPresets ? CATALOG_BUILTIN_PRESETS : 0;
+    header.cityCount = cities.size();
+    header.presetCount = presets.size();
+    header.indexSize = indexSize;
+    header.stringsOffset = sizeof(header) + cities.size() * sizeof(CatalogCity) +
+                           presets.size() * sizeof(CatalogPreset) + indexSize * sizeof(uint32_t);
+    header.stringsSize = strings.size();
+    header.fileSize = header.stringsOffset + header.stringsSize;
+
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(cities.data()), cities.size() * sizeof(CatalogCity));
+    out.write(reinterpret_cast<const char *>(presets.data()), presets.size() * sizeof(CatalogPreset));
+    out.write(reinterpret_cast<const char *>(index), indexSize * sizeof(uint32_t));
+    out.write(strings.data(), strings.size());
+    out.flush();
+    return static_cast<bool>(out);
+}
+
+// Function to get the slot of the catalog in use
+inline const Catalog *&activeCatalog()
+{
+    static const Catalog *active = &Catalog::builtin();
+    return active;
+}
+
+// Function to get the catalog in use; the built-in tables unless replaced with useCatalog()
+inline const Catalog &catalog()
+{
+    return *activeCatalog();
+}
+
+// Function to replace the catalog in use, before any evaluation starts; catalog must outlive its use
+inline void useCatalog(const Catalog &catalog)
+{
+    activeCatalog() = &catalog;
+}
+
+// Function to build a scenario from a preset weapon of the catalog at its typical burst height
+inline Scenario presetScenario(size_t presetIndex, size_t cityIndex, double windSpeed)
+{
+    const WeaponPreset &preset = catalog().presets()[presetIndex];
+    return {preset.yield, preset.typicalHeight, preset.isAirburst, windSpeed, cityIndex};
+}
+
+/*******************************************************************************
+ * Physics core
+ *
+ * Stateless functions that only read their arguments. Functions taking a
+ * Scaling parameter get their yield powers and logarithms from one of the
+ * yield scaling policies above, ExactYieldScaling by default. They do not allocate and
+ * touch no shared state, so they can be called concurrently from any number of
+ * threads. NuclearEffectsCalculator is the interactive front end on top of them.
+ *
+ * The kernels branch on three properties of a scenario: a burst above the
+ * ground, the air burst flag and a calm (below 0.1 km/h) or windy fallout
+ * pattern. Their BurstRegime overloads take these as a tag and compile the
+ * branches out; the plain overloads classify the scenario and forward to them.
+ * Batch evaluation groups scenarios by regime (computeResultRows), so each
+ * group runs one branch-free specialization.
+ ******************************************************************************/
+
+// Compile-time branch regime of a scenario, passed to the kernels as a tag argument
+// It must be the regime of the scenario the kernel evaluates, as classified by burstRegime()
+template <unsigned Index>
+struct BurstRegime
+{
+    static constexpr bool ELEVATED = (Index & 1) != 0; // Height of burst above 0: Mach stem, slant path, height effects
+    static constexpr bool AIRBURST = (Index & 2) != 0; // Air burst flag: local fallout fraction
+    static constexpr bool WINDY = (Index & 4) != 0;    // Wind of at least 0.1 km/h: wind-driven fallout pattern
+};
+
+constexpr unsigned BURST_REGIMES = 8;
+
+// Function to classify a scenario into its regime index, with the comparisons of the kernels in precision Real
+template <typename Real>
+inline unsigned burstRegime(Real height, bool isAirburst, Real windSpeed)
+{
+    return (height > 0 ? 1u : 0u) | (isAirburst ? 2u : 0u) | (windSpeed < Real(0.1) ? 0u : 4u);
+}
+
+// Function to call body(BurstRegime<index>()) with a regime index known only at run time, returns its result
+template <typename Body>
+inline decltype(auto) withBurstRegime(unsigned index, Body &&body)
+{
+    switch (index)
+    {
+    case 0:
+        return body(BurstRegime<0>());
+    case 1:
+        return body(BurstRegime<1>());
+    case 2:
+        return body(BurstRegime<2>());
+    case 3:
+        return body(BurstRegime<3>());
+    case 4:
+        return body(BurstRegime<4>());
+    case 5:
+        return body(BurstRegime<5>());
+    case 6:
+        return body(BurstRegime<6>());
+    default:
+        return body(BurstRegime<7>());
+    }
+}
+
+// Helper function to calculate circular area
+template <typename Real>
+inline Real calculateArea(Real radius)
+{
+    Real kilometers = radius / Real(1000.0); // Convert meters to kilometers for area calculation
+    return Real(M_PI) * kilometers * kilometers;
+}
+
+// Function to apply height effects to weapon effects
+template <typename Real>
+inline void applyHeightEffects(WeaponEffectsT<Real> &effects, Real height)
+{
+    NUCCALC_STAGE(HeightEffects);
+
+    // Adjust effects based on height of burst
+    Real heightFactor = Real(1.0) - (height / Real(10000.0)); // Linear decrease with height
+    heightFactor = std::max(Real(0.3), heightFactor);         // Minimum 30% effect
+
+    effects.blast.severe *= heightFactor;   // Reduce severe blast effects
+    effects.blast.moderate *= heightFactor; // Reduce moderate blast effects
+    effects.blast.light *= heightFactor;    // Reduce light blast effects
+
+    effects.radiation.severe *= heightFactor;   // Reduce severe radiation effects
+    effects.radiation.moderate *= heightFactor; // Reduce moderate radiation effects
+    effects.radiation.light *= heightFactor;    // Reduce light radiation effects
+}
+
+// Function to calculate optimal height of burst
+template <typename Scaling = ExactYieldScaling>
+inline OptimalHeight calculateOptimalHeight(double yield)
+{
+    OptimalHeight oh;
+    // Height of burst calculations based on yield
+    double yieldFactor = Scaling::cubeRoot(yield); // Cube root scaling
+    oh.thermal = 220 * yieldFactor;             // Optimal for thermal effects
+    oh.blast = 180 * yieldFactor;               // Optimal for blast effects
+    oh.combined = 200 * yieldFactor;            // Compromise height
+    return oh;
+}
+
+// Core calculation function for blast overpressure effects
+// ambientPressure (Pa) is the pressure Sachs scaling refers to, at the ground
+template <typename Real, typename Scaling = ExactYieldScaling, unsigned Regime>
+inline Real calculateBlastOverpressure(Real distance, Real yield, Real height, Real ambientPressure,
+                                       BurstRegime<Regime>)
+{
+    using std::exp;
+
+    // Convert nuclear yield from megatons to joules (1 MT = 4.184e15 J)
+    Real E = yield * Real(4.184e15); // Total energy release in joules
+
+    // Calculate scaled distance using Sachs scaling law for nuclear explosions
+    // This accounts for atmospheric pressure effects on blast wave propagation
+    const Real P0 = ambientPressure;
+    Real scaled_distance = distance / Scaling::cubeRoot(E / P0);
+
+    // Calculate Mach stem enhancement factor for airburst detonations
+    // Mach stem forms when incident and reflected shock waves merge
+    Real mach_stem_factor = Real(1.0); // Initialize to no enhancement
+    if constexpr (BurstRegime<Regime>::ELEVATED)
+    {
+        // Scale height relative to yield using cube root scaling
+        Real mach_height = height / Scaling::cubeRoot(yield);
+        // Enhancement decreases exponentially with scaled height
+        mach_stem_factor = Real(1.0) + Real(0.1) * exp(-mach_height / Real(100.0));
+
+        // Calculate triple-point effects where Mach stem begins to form
+        // This occurs at a specific height-dependent distance from ground zero
+        Real triple_point_height = Real(83) * Scaling::pow0_4(yield); // Empirical relationship
+        // Enhance blast effects in Mach stem region: 25% enhancement, selected without a branch
+        mach_stem_factor *= height < triple_point_height ? Real(1.25) : Real(1.0);
+    }
+
+    // Calculate final overpressure using modified Brode equation
+    // Terms represent different components of blast wave behavior:
+    // - 1.0: ambient pressure term
+    // - 0.076/scaled_distance: initial shock wave
+    // - 0.255/scaled_distance^2: positive phase duration
+    // - 0.536/scaled_distance^3: negative phase effects
+    Real x = Real(1.0) / scaled_distance;
+    return P0 * (Real(1.0) + Real(0.076) * x + Real(0.255) * x * x + Real(0.536) * x * x * x) *
+           mach_stem_factor;
+}
+
+// Blast overpressure of a burst whose regime is decided at run time
+template <typename Real, typename Scaling = ExactYieldScaling>
+inline Real calculateBlastOverpressure(Real distance, Real yield, Real height, Real ambientPressure)
+{
+    if (height > 0)
+        return calculateBlastOverpressure<Real, Scaling>(distance, yield, height, ambientPressure, BurstRegime<1>());
+    return calculateBlastOverpressure<Real, Scaling>(distance, yield, height, ambientPressure, BurstRegime<0>());
+}
+
+// Blast overpressure at sea level pressure
+template <typename Real, typename Scaling = ExactYieldScaling>
+inline Real calculateBlastOverpressure(Real distance, Real yield, Real height)
+{
+    return calculateBlastOverpressure<Real, Scaling>(distance, yield, height, Real(PhysicalConstants::ATMOSPHERIC_PRESSURE));
+}
+
+// Thermal radiation calculation with atmospheric effects
+// attenuation is the atmospheric extinction per km, scaleHeight (m) that of the burst altitude factor
+template <typename Real, unsigned Regime>
+inline Real calculateThermalRadiation(Real distance, Real yield, Real height, Real attenuation, Real scaleHeight,
+                                      BurstRegime<Regime>)
+{
+    using std::exp;
+    using std::sqrt;
+
+    // Fix thermal calculation
+    const Real THERMAL_CONSTANT = Real(10000.0); // Calibration constant
+    Real E = yield * Real(4.184e15) * Real(0.35);
+
+    // Simplified thermal radiation formula
+    Real thermal_energy = THERMAL_CONSTANT * (E / (Real(4.0 * M_PI) * distance * distance));
+
+    // Apply atmospheric attenuation
+    Real transmission = exp(-attenuation * distance / Real(1000.0));
+
+    if constexpr (BurstRegime<Regime>::ELEVATED)
+    {
+        Real slant_ratio = height / (distance + height);
+        Real angle_factor = sqrt(Real(1.0) - slant_ratio * slant_ratio);
+        thermal_energy *= angle_factor * exp(-height / scaleHeight);
+    }
+
+    return thermal_energy * transmission;
+}
+
+// Thermal radiation of a burst whose regime is decided at run time
+template <typename Real>
+inline Real calculateThermalRadiation(Real distance, Real yield, Real height, Real attenuation, Real scaleHeight)
+{
+    if (height > 0)
+        return calculateThermalRadiation(distance, yield, height, attenuation, scaleHeight, BurstRegime<1>());
+    return calculateThermalRadiation(distance, yield, height, attenuation, scaleHeight, BurstRegime<0>());
+}
+
+// Thermal radiation with the nominal 0.17/km extinction and 7400 m scale height
+template <typename Real>
+inline Real calculateThermalRadiation(Real distance, Real yield, Real height)
+{
+    return calculateThermalRadiation(distance, yield, height, Real(0.17), Real(7400.0));
+}
+
+// Yield and height dependent intermediates of the fallout model, reused while only the wind changes
+template <typename Real>
+struct FalloutPrecomputeT
+{
+    Real height;            // Height of burst (m)
+    bool isAirburst;        // Air burst vs surface burst
+    Real stabilizedHeight;  // Stabilized cloud height
+    Real particleFraction;  // Fraction of the debris that falls out locally
+    Real effectiveYield;    // Fission yield contributing to local fallout (MT)
+    Real effectiveScaling;  // effectiveYield^0.4
+    Real yieldLog;          // log10(yield)
+};
+
+// Function to compute the wind independent part of the fallout model (the wind bit of the regime is unused)
+// activityShift is added to the activity fraction of the model, the sensitivity analysis differentiates through it
+template <typename Real, typename Scaling = ExactYieldScaling, unsigned Regime>
+inline FalloutPrecomputeT<Real> makeFalloutPrecompute(Real yield, Real height, BurstRegime<Regime>,
+                                                      Real activityShift = Real(0))
+{
+    using std::exp;
+
+    FalloutPrecomputeT<Real> precompute;
+    precompute.height = height;
+    precompute.isAirburst = BurstRegime<Regime>::AIRBURST;
+
+    // Calculate stabilized cloud height
+    precompute.stabilizedHeight = !BurstRegime<Regime>::ELEVATED ? Real(212.0) * Scaling::pow0_375(yield) : // Ground burst
+                                      Real(188.0) * Scaling::pow0_375(yield);                              // Air burst
+
+    // Calculate particle fraction and activity
+    if constexpr (BurstRegime<Regime>::AIRBURST)
+        precompute.particleFraction = Real(0.3) * exp(-height / (precompute.stabilizedHeight * Real(0.7)));
+    else
+        precompute.particleFraction = Real(1.0);
+    precompute.yieldLog = Scaling::log10(yield);
+    Real activityFraction = Real(0.6) + Real(0.2) * precompute.yieldLog + activityShift;
+    precompute.effectiveYield = yield * precompute.particleFraction * activityFraction;
+    precompute.effectiveScaling = Scaling::pow0_4(precompute.effectiveYield);
+    return precompute;
+}
+
+// Function to compute the wind independent part of the fallout model for a regime decided at run time
+template <typename Real, typename Scaling = ExactYieldScaling>
+inline FalloutPrecomputeT<Real> makeFalloutPrecompute(Real yield, Real height, bool isAirburst)
+{
+    return withBurstRegime(burstRegime(height, isAirburst, Real(0)), [&](auto regime)
+                           { return makeFalloutPrecompute<Real, Scaling>(yield, height, regime); });
+}
+
+// Function to calculate the fallout pattern for a wind speed (km/h) from the precomputed intermediates
+template <typename Real, typename Scaling = ExactYieldScaling, unsigned Regime>
+inline FalloutDataT<Real> calculateFallout(const FalloutPrecomputeT<Real> &precompute, Real windSpeed,
+                                           BurstRegime<Regime>)
+{
+    using std::exp;
+    using std::sqrt;
+
+    const Real height = precompute.height;
+    const Real stabilizedHeight = precompute.stabilizedHeight;
+    FalloutDataT<Real> fallout;
+
+    // Base fallout radius due to mushroom cloud spread
+    Real baseRadius = Real(1000.0) * precompute.effectiveScaling;
+
+    if constexpr (!BurstRegime<Regime>::WINDY)
+    { // Near-zero wind conditions
+        // Create circular pattern
+        fallout.maxDownwindDistance = baseRadius / Real(1000.0); // Convert to km
+        fallout.maxWidth = baseRadius / Real(1000.0);            // Equal in all directions
+        fallout.falloutAngle = Real(360.0);                      // Full circle
+    }
+    else
+    {
+        // Calculate wind-driven pattern
+        fallout.maxDownwindDistance = std::max(
+            baseRadius / Real(1000.0), // Minimum distance
+            windSpeed * Real(3600.0) * (precompute.effectiveScaling / Real(PhysicalConstants::GRAVITY)) *
+                (Real(1.0) + Real(0.15) * precompute.yieldLog));
+
+        // Width calculation with turbulent diffusion
+        fallout.maxWidth = fallout.maxDownwindDistance *
+                           (Real(0.14) + Real(0.02) * precompute.yieldLog) *
+                           sqrt(stabilizedHeight / Real(1000.0));
+
+        // Fallout angle for wind conditions
+        fallout.falloutAngle = Real(40.0) * exp(-height / (stabilizedHeight * Real(2.0))) *
+                               (Real(1.0) - Real(0.1) * Scaling::log10(std::max(Real(1.0), windSpeed)));
+    }
+
+    // Calculate danger zone area
+    if constexpr (!BurstRegime<Regime>::WINDY)
+    {
+        fallout.dangerousZoneArea = Real(M_PI) * fallout.maxDownwindDistance * fallout.maxDownwindDistance;
+    }
+    else
+    {
+        fallout.dangerousZoneArea = Real(0.5) * fallout.maxDownwindDistance *
+                                    fallout.maxWidth * precompute.particleFraction *
+                                    (Real(1.0) - Real(0.2) * Real(BurstRegime<Regime>::AIRBURST));
+    }
+
+    // Scale all values based on burst type
+    Real falloutScale = !BurstRegime<Regime>::ELEVATED ? Real(1.0) : Real(0.3); // Ground burst produces more fallout
+    fallout.dangerousZoneArea *= falloutScale;
+
+    return fallout;
+}
+
+// Function to calculate the fallout pattern from the precomputed intermediates for a regime decided at run time
+template <typename Real, typename Scaling = ExactYieldScaling>
+inline FalloutDataT<Real> calculateFallout(const FalloutPrecomputeT<Real> &precompute, Real windSpeed)
+{
+    return withBurstRegime(burstRegime(precompute.height, precompute.isAirburst, windSpeed), [&](auto regime)
+                           { return calculateFallout<Real, Scaling>(precompute, windSpeed, regime); });
+}
+
+// Function to calculate fallout pattern
+template <typename Real, typename Scaling = ExactYieldScaling, unsigned Regime>
+inline FalloutDataT<Real> calculateFallout(Real yield, Real height, Real windSpeed, BurstRegime<Regime> regime)
+{
+    NUCCALC_STAGE(Fallout);
+
+    return calculateFallout<Real, Scaling>(makeFalloutPrecompute<Real, Scaling>(yield, height, regime), windSpeed, regime);
+}
+
+// Function to calculate fallout pattern for a regime decided at run time
+template <typename Real, typename Scaling = ExactYieldScaling>
+inline FalloutDataT<Real> calculateFallout(Real yield, Real height, bool isAirburst, Real windSpeed)
+{
+    return withBurstRegime(burstRegime(height, isAirburst, windSpeed), [&](auto regime)
+                           { return calculateFallout<Real, Scaling>(yield, height, windSpeed, regime); });
+}
+
+// Add density calculation based on distance from center
+template <typename Real>
+inline Real calculateDensityAtDistance(Real distance, const CityData &city)
+{
+    using std::exp;
+
+    Real cityRadius = Real(city.radius);
+    Real cityDensity = Real(city.density);
+    Real suburbanDensity = Real(city.suburban_density);
+
+    if (distance <= cityRadius)
+    {
+        // Exponential density decrease within city
+        return cityDensity * exp(-distance / cityRadius);
+    }
+    else
+    {
+        // Suburban density with exponential falloff
+        return suburbanDensity * exp(-(distance - cityRadius) / (cityRadius * Real(0.5)));
+    }
+}
+
+// Effect radii (km) that decide the casualty classification, taken from the effect areas
+template <typename Real>
+struct CasualtyRadii
+{
+    Real blastSevere;
+    Real blastModerate;
+    Real blastLight;
+    Real thermalSevere;
+    Real radiationSevere;
+    Real maximum; // Outermost light effect radius, the integration limit
+
+    explicit CasualtyRadii(const WeaponEffectsT<Real> &effects)
+    {
+        using std::sqrt;
+        const Real PI = Real(M_PI);
+        blastSevere = sqrt(effects.blast.severeArea / PI);
+        blastModerate = sqrt(effects.blast.moderateArea / PI);
+        blastLight = sqrt(effects.blast.lightArea / PI);
+        thermalSevere = sqrt(effects.thermal.severeArea / PI);
+        radiationSevere = sqrt(effects.radiation.severeArea / PI);
+        maximum = std::max({blastLight, sqrt(effects.thermal.lightArea / PI), sqrt(effects.radiation.lightArea / PI)});
+    }
+};
+
+// Casualty fractions of the population at one distance
+template <typename Real>
+struct CasualtyWeights
+{
+    Real deaths;
+    Real severeInjuries;
+    Real lightInjuries;
+
+    // Function to classify a distance (km) against the effect radii
+    CasualtyWeights(const CasualtyRadii<Real> &radii, Real distance)
+        : deaths(0), severeInjuries(0), lightInjuries(0)
+    {
+        if (distance <= radii.blastSevere)
+            deaths += Real(0.9); // 90% mortality
+        else if (distance <= radii.blastModerate)
+            severeInjuries += Real(0.5); // 50% severe injuries
+        else if (distance <= radii.blastLight)
+            lightInjuries += Real(0.3); // 30% light injuries
+
+        // Add thermal effects
+        if (distance <= radii.thermalSevere)
+            deaths += Real(0.7); // 70% mortality
+        // ...similar calculations for moderate and light thermal effects...
+
+        // Add radiation effects
+        if (distance <= radii.radiationSevere)
+            severeInjuries += Real(0.8); // 80% severe injuries
+        // ...similar calculations for moderate radiation effects...
+    }
+
+    bool empty() const
+    {
+        return deaths == 0 && severeInjuries == 0 && lightInjuries == 0;
+    }
+};
+
+// Function to integrate a smooth function over [a, b] with adaptive Simpson refinement
+// fa, fm, fb are the values at a, the midpoint and b, whole is the Simpson estimate over [a, b]
+template <typename Real, typename Function>
+inline Real integrateAdaptiveSimpson(Function &f, Real a, Real b, Real fa, Real fm, Real fb,
+                                     Real whole, Real tolerance, int depth)
+{
+    using std::fabs;
+
+    Real m = (a + b) / Real(2);
+    Real flm = f((a + m) / Real(2));
+    Real frm = f((m + b) / Real(2));
+    Real left = (m - a) / Real(6) * (fa + Real(4) * flm + fm);
+    Real right = (b - m) / Real(6) * (fm + Real(4) * frm + fb);
+    Real delta = left + right - whole;
+
+    if (depth <= 0 || fabs(delta) <= Real(15) * tolerance)
+        return left + right + delta / Real(15); // Richardson extrapolation
+
+    return integrateAdaptiveSimpson(f, a, m, fa, flm, fm, left, tolerance / Real(2), depth - 1) +
+           integrateAdaptiveSimpson(f, m, b, fm, frm, fb, right, tolerance / Real(2), depth - 1);
+}
+
+// Function to finish an estimate with the long-term deaths
+template <typename Real>
+inline void estimateLongTermDeaths(CasualtyEstimateT<Real> &casualties)
+{
+    // Estimate long-term deaths based on radiation exposure - guesswork
+    Real totalExposed = casualties.severeInjuries + casualties.lightInjuries; // Total exposed population
+    casualties.longTermDeaths1Year = totalExposed * Real(0.1);                // 10% mortality in 1 year
+    casualties.longTermDeaths5Year = totalExposed * Real(0.2);                // 20% mortality in 5 years
+    casualties.longTermDeaths10Year = totalExposed * Real(0.3);               // 30% mortality in 10 years
+    casualties.longTermDeaths20Year = totalExposed * Real(0.4);               // 40% mortality in 20 years
+}
+
+// Casualty calculation in fixed concentric rings, classified at the ring midpoint
+template <typename Real>
+inline CasualtyEstimateT<Real> calculateCasualtiesInRings(const WeaponEffectsT<Real> &effects, const CityData &city,
+                                                          int rings)
+{
+    CasualtyEstimateT<Real> casualties = {};
+    const Real PI = Real(M_PI);
+    const CasualtyRadii<Real> radii(effects); // Hoisted out of the ring loop
+
+    for (int i = 0; i < rings; i++)
+    {
+        Real innerRadius = (Real(i) * radii.maximum) / Real(rings);                   // Calculate inner ring radius
+        Real outerRadius = (Real(i + 1) * radii.maximum) / Real(rings);               // Calculate outer ring radius
+        Real ringArea = PI * (outerRadius * outerRadius - innerRadius * innerRadius); // Calculate ring area
+        Real avgRadius = (innerRadius + outerRadius) / Real(2);                       // Calculate average radius
+        Real population = ringArea * calculateDensityAtDistance(avgRadius, city);     // Population of the ring
+
+        // Calculate effects for this ring
+        CasualtyWeights<Real> weights(radii, avgRadius);
+        casualties.deaths += population * weights.deaths;
+        casualties.severeInjuries += population * weights.severeInjuries;
+        casualties.lightInjuries += population * weights.lightInjuries;
+    }
+    casualties.densityEvaluations = static_cast<size_t>(rings);
+
+    estimateLongTermDeaths(casualties);
+    return casualties;
+}
+
+// Function to sum populationBetween(a, b) over the segments between the effect radii and densityBoundary,
+// the radius where the density model changes (the city radius)
+// Within a segment the casualty fractions are constant and the density is smooth; segments without
+// casualties are skipped entirely.
+template <typename Real, typename PopulationBetween>
+inline void accumulateCasualtySegments(CasualtyEstimateT<Real> &casualties, const CasualtyRadii<Real> &radii,
+                                       Real densityBoundary, PopulationBetween &&populationBetween)
+{
+    // Segment boundaries in ascending order
+    Real bounds[8] = {0, radii.blastSevere, radii.blastModerate, radii.blastLight,
+                      radii.thermalSevere, radii.radiationSevere, densityBoundary, radii.maximum};
+    for (int i = 1; i < 8; i++) // Insertion sort; std::sort costs microseconds here on some AVX targets
+    {
+        for (int j = i; j > 0 && bounds[j] < bounds[j - 1]; j--)
+            std::swap(bounds[j], bounds[j - 1]);
+    }
+
+    for (int k = 0; k < 7; k++)
+    {
+        Real a = bounds[k];
+        Real b = std::min(bounds[k + 1], radii.maximum);
+        if (!(b > a))
+            continue;
+
+        CasualtyWeights<Real> weights(radii, (a + b) / Real(2));
+        if (weights.empty())
+            continue; // No casualties in this segment
+
+        Real population = populationBetween(a, b);
+        casualties.deaths += population * weights.deaths;
+        casualties.severeInjuries += population * weights.severeInjuries;
+        casualties.lightInjuries += population * weights.lightInjuries;
+    }
+}
+
+// Casualty calculation by adaptive integration of 2*pi*r*density(r)
+// The range is split at every effect radius and at the city radius, where the classification or the
+// density model changes, so adaptive Simpson converges quickly on each segment.
+template <typename Real>
+inline CasualtyEstimateT<Real> calculateCasualtiesAdaptive(const WeaponEffectsT<Real> &effects, const CityData &city,
+                                                           Real tolerance)
+{
+    using std::fabs;
+
+    CasualtyEstimateT<Real> casualties = {};
+    const CasualtyRadii<Real> radii(effects);
+
+    size_t evaluations = 0;
+    auto integrand = [&](Real r)
+    {
+        evaluations++;
+        return Real(2.0 * M_PI) * r * calculateDensityAtDistance(r, city);
+    };
+
+    const int MAX_DEPTH = 40; // Recursion limit per segment
+    accumulateCasualtySegments(casualties, radii, Real(city.radius), [&](Real a, Real b)
+                               {
+        Real fa = integrand(a);
+        Real fm = integrand((a + b) / Real(2));
+        Real fb = integrand(b);
+        Real whole = (b - a) / Real(6) * (fa + Real(4) * fm + fb);
+        return integrateAdaptiveSimpson(integrand, a, b, fa, fm, fb, whole, tolerance * fabs(whole), MAX_DEPTH); });
+    casualties.densityEvaluations = evaluations;
+
+    estimateLongTermDeaths(casualties);
+    return casualties;
+}
+
+// Function to integrate 2*pi*r * amplitude*exp(-(r - origin)/length) over [a, b] in closed form
+// The antiderivative of r*exp(-r/L) is -L*(r + L)*exp(-r/L)
+template <typename Real>
+inline Real exponentialShellPopulation(Real amplitude, Real length, Real origin, Real a, Real b)
+{
+    using std::exp;
+    return Real(2.0 * M_PI) * amplitude * length *
+           ((a + length) * exp(-(a - origin) / length) - (b + length) * exp(-(b - origin) / length));
+}
+
+// Function to get the population between radii a and b (km) of the city density model in closed form
+// calculateDensityAtDistance is density*exp(-r/R) inside the city radius R and
+// suburban_density*exp(-(r-R)/(0.5R)) outside, so each side is one exponential shell
+template <typename Real>
+inline Real calculatePopulationBetween(const CityData &city, Real a, Real b)
+{
+    Real cityRadius = Real(city.radius);
+    Real population = 0;
+    if (a < cityRadius)
+    {
+        population += exponentialShellPopulation(Real(city.density), cityRadius, Real(0), a, std::min(b, cityRadius));
+    }
+    if (b > cityRadius)
+    {
+        population += exponentialShellPopulation(Real(city.suburban_density), cityRadius * Real(0.5), cityRadius,
+                                                 std::max(a, cityRadius), b);
+    }
+    return population;
+}
+
+// Function to check whether calculatePopulationBetween applies to the city density model
+inline bool hasAnalyticDensity(const CityData &city)
+{
+    return city.radius > 0 && std::isfinite(city.radius) && std::isfinite(city.density) &&
+           std::isfinite(city.suburban_density);
+}
+
+// Casualty calculation with the closed-form population of every segment: a fixed
+// two exp calls per segment, no density sampling
+template <typename Real>
+inline CasualtyEstimateT<Real> calculateCasualtiesAnalytic(const WeaponEffectsT<Real> &effects, const CityData &city)
+{
+    CasualtyEstimateT<Real> casualties = {};
+    const CasualtyRadii<Real> radii(effects);
+
+    accumulateCasualtySegments(casualties, radii, Real(city.radius), [&](Real a, Real b)
+                               { return calculatePopulationBetween(city, a, b); });
+
+    estimateLongTermDeaths(casualties);
+    return casualties;
+}
+
+// Casualty calculation on a population raster with ground zero at its origin
+// The population of every segment is a difference of two disk queries; consecutive segments share a radius,
+// so each effect radius is queried once
+template <typename Real>
+inline CasualtyEstimateT<Real> calculateCasualtiesOnRaster(const WeaponEffectsT<Real> &effects,
+                                                           const PopulationRaster &population)
+{
+    CasualtyEstimateT<Real> casualties = {};
+    const CasualtyRadii<Real> radii(effects);
+
+    size_t queries = 0;
+    Real lastRadius = 0, lastPopulation = 0; // Disk of the previous query, radius in km
+    auto disk = [&](Real radius)
+    {
+        if (radius != lastRadius)
+        {
+            queries++;
+            lastRadius = radius;
+            lastPopulation = Real(population.populationInDisk(0, 0, double(radius) * 1000.0));
+        }
+        return lastPopulation;
+    };
+    accumulateCasualtySegments(casualties, radii, radii.maximum, [&](Real a, Real b)
+                               {
+        Real inner = disk(a);
+        return disk(b) - inner; });
+    casualties.densityEvaluations = queries;
+
+    estimateLongTermDeaths(casualties);
+    return casualties;
+}
+
+// Update casualty calculation with long-term effects
+template <typename Real>
+inline CasualtyEstimateT<Real> calculateCasualties(const WeaponEffectsT<Real> &effects, const CityData &city,
+                                                   const ModelOptions &options = ModelOptions())
+{
+    NUCCALC_STAGE(Casualties);
+
+    if (options.population)
+        return calculateCasualtiesOnRaster(effects, *options.population);
+
+    switch (options.casualtyMethod)
+    {
+    case CasualtyMethod::Analytic:
+        if (hasAnalyticDensity(city))
+            return calculateCasualtiesAnalytic(effects, city);
+        // Density models without a closed form are integrated numerically
+        return calculateCasualtiesAdaptive(effects, city, Real(options.casualtyTolerance));
+    case CasualtyMethod::Adaptive:
+        return calculateCasualtiesAdaptive(effects, city, Real(options.casualtyTolerance));
+    case CasualtyMethod::Rings:
+    default:
+        return calculateCasualtiesInRings(effects, city, std::max(1, options.casualtyRings));
+    }
+}
+
+// Function to calculate weapon effects of a scenario in the given regime
+template <typename Real, typename Scaling, unsigned Regime>
+inline WeaponEffectsT<Real> calculateEffects(const Scenario &scenario, BurstRegime<Regime> regime)
+{
+    const Real yield = Real(scenario.yield);
+    const Real height = Real(scenario.height);
+
+    WeaponEffectsT<Real> effects;
+
+    { // Effect radii, timed apart from the height and fallout stages
+        NUCCALC_STAGE(EffectRadii);
+
+        // Updated scaling factors
+        Real blastScaling = Scaling::cubeRoot(yield);    // Cube root scaling
+        Real thermalScaling = Scaling::pow0_4(yield);    // Thermal scaling
+        Real radiationScaling = Scaling::pow0_19(yield); // Radiation scaling
+
+        // Calculate blast effects (in meters)
+        effects.blast = {
+            Real(2000.0) * blastScaling, // Severe damage radius (20 psi)
+            Real(3000.0) * blastScaling, // Moderate damage radius (10 psi)
+            Real(4500.0) * blastScaling, // Light damage radius (5 psi)
+            calculateArea(Real(2000.0) * blastScaling),
+            calculateArea(Real(3000.0) * blastScaling),
+            calculateArea(Real(4500.0) * blastScaling)};
+
+        // Calculate thermal effects (in meters)
+        effects.thermal = {
+            Real(1200.0) * thermalScaling, // Severe burns radius
+            Real(1800.0) * thermalScaling, // Moderate burns radius
+            Real(2400.0) * thermalScaling, // Light burns radius
+            calculateArea(Real(1200.0) * thermalScaling),
+            calculateArea(Real(1800.0) * thermalScaling),
+            calculateArea(Real(2400.0) * thermalScaling)};
+
+        // Calculate radiation effects (in meters)
+        effects.radiation = {
+            Real(800.0) * radiationScaling,  // Lethal dose radius
+            Real(1200.0) * radiationScaling, // Severe effects radius
+            Real(1600.0) * radiationScaling, // Light effects radius
+            calculateArea(Real(800.0) * radiationScaling),
+            calculateArea(Real(1200.0) * radiationScaling),
+            calculateArea(Real(1600.0) * radiationScaling)};
+    }
+
+    // Apply height of burst effects
+    if constexpr (BurstRegime<Regime>::ELEVATED)
+    {
+        applyHeightEffects(effects, height);
+    }
+
+    effects.fallout = calculateFallout<Real, Scaling>(yield, height, Real(scenario.windSpeed), regime);
+    return effects;
+}
+
+// Function to classify a scenario into its regime index in precision Real
+template <typename Real>
+inline unsigned burstRegime(const Scenario &scenario)
+{
+    return burstRegime(Real(scenario.height), scenario.isAirburst, Real(scenario.windSpeed));
+}
+
+// Function to calculate weapon effects
+template <typename Real = DefaultReal, typename Scaling = ExactYieldScaling>
+inline WeaponEffectsT<Real> calculateEffects(const Scenario &scenario)
+{
+    return withBurstRegime(burstRegime<Real>(scenario), [&](auto regime)
+                           { return calculateEffects<Real, Scaling>(scenario, regime); });
+}
+
+// Function to calculate weapon effects with the yield scaling selected in the model options
+template <typename Real = DefaultReal>
+inline WeaponEffectsT<Real> calculateEffects(const Scenario &scenario, const ModelOptions &options)
+{
+    if (options.yieldScaling == YieldScaling::Tabulated)
+        return calculateEffects<Real, TabulatedYieldScaling>(scenario);
+    return calculateEffects<Real, ExactYieldScaling>(scenario);
+}
+
+// Function to evaluate a complete scenario: effects, fallout and casualties
+// Real selects the precision of the whole evaluation, e.g. computeEffects<float>(scenario)
+template <typename Real = DefaultReal>
+inline ScenarioResultT<Real> computeEffects(const Scenario &scenario, const ModelOptions &options = ModelOptions())
+{
+    ScenarioResultT<Real> result;
+    result.effects = calculateEffects<Real>(scenario, options);
+    result.casualties = calculateCasualties(result.effects, catalog().cities()[scenario.cityIndex], options);
+    return result;
+}
+
+// Floating-point precision selectable at run time, for batch and sweep evaluation
+enum class Precision
+{
+    Float,
+    Double,
+    LongDouble
+};
+
+/*******************************************************************************
+ * SIMD helpers
+ *
+ * SimdDouble wraps the widest double-precision vector the target supports:
+ * AVX-512 (8 lanes), AVX2 with FMA (4 lanes), AArch64 NEON (2 lanes), or a
+ * scalar fallback. The profile kernels are written once against this type and
+ * finish the tail of each array with the same arithmetic in scalar code.
+ * Build with e.g. -march=native to enable the vector paths.
+ ******************************************************************************/
+
+#if defined(__AVX512F__)
+
+// GCC 12 flags the self-initialised _mm512_undefined_* sources of the masked intrinsics
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+struct SimdDouble
+{
+    static constexpr size_t WIDTH = 8;
+    __m512d v;
+
+    static SimdDouble broadcast(double x) { return {_mm512_set1_pd(x)}; }
+    static SimdDouble load(const double *p) { return {_mm512_loadu_pd(p)}; }
+    void store(double *p) const { _mm512_storeu_pd(p, v); }
+};
+
+inline SimdDouble operator+(SimdDouble a, SimdDouble b) { return {_mm512_add_pd(a.v, b.v)}; }
+inline SimdDouble operator-(SimdDouble a, SimdDouble b) { return {_mm512_sub_pd(a.v, b.v)}; }
+inline SimdDouble operator*(SimdDouble a, SimdDouble b) { return {_mm512_mul_pd(a.v, b.v)}; }
+inline SimdDouble operator/(SimdDouble a, SimdDouble b) { return {_mm512_div_pd(a.v, b.v)}; }
+inline SimdDouble fma(SimdDouble a, SimdDouble b, SimdDouble c) { return {_mm512_fmadd_pd(a.v, b.v, c.v)}; }
+inline SimdDouble sqrt(SimdDouble a) { return {_mm512_sqrt_pd(a.v)}; }
+inline SimdDouble min(SimdDouble a, SimdDouble b) { return {_mm512_min_pd(a.v, b.v)}; }
+inline SimdDouble max(SimdDouble a, SimdDouble b) { return {_mm512_max_pd(a.v, b.v)}; }
+
+// 2^n for t = n + 1.5 * 2^52, built directly in the exponent bits
+inline SimdDouble powerOfTwoFromShifted(SimdDouble t)
+{
+    __m512i bits = _mm512_add_epi64(_mm512_castpd_si512(t.v), _mm512_set1_epi64(1023));
+    return {_mm512_castsi512_pd(_mm512_slli_epi64(bits, 52))};
+}
+
+// Lanes of value where x < limit are replaced by zero
+inline SimdDouble zeroWhereLess(SimdDouble value, SimdDouble x, SimdDouble limit)
+{
+    return {_mm512_maskz_mov_pd(_mm512_cmp_pd_mask(x.v, limit.v, _CMP_GE_OQ), value.v)};
+}
+
+// Lanes of a where x < limit, of b elsewhere
+inline SimdDouble whereLess(SimdDouble x, SimdDouble limit, SimdDouble a, SimdDouble b)
+{
+    return {_mm512_mask_blend_pd(_mm512_cmp_pd_mask(x.v, limit.v, _CMP_LT_OQ), b.v, a.v)};
+}
+
+#pragma GCC diagnostic pop
+
+#elif defined(__AVX2__) && defined(__FMA__)
+
+struct SimdDouble
+{
+    static constexpr size_t WIDTH = 4;
+    __m256d v;
+
+    static SimdDouble broadcast(double x) { return {_mm256_set1_pd(x)}; }
+    static SimdDouble load(const double *p) { return {_mm256_loadu_pd(p)}; }
+    void store(double *p) const { _mm256_storeu_pd(p, v); }
+};
+
+inline SimdDouble operator+(SimdDouble a, SimdDouble b) { return {_mm256_add_pd(a.v, b.v)}; }
+inline SimdDouble operator-(SimdDouble a, SimdDouble b) { return {_mm256_sub_pd(a.v, b.v)}; }
+inline SimdDouble operator*(SimdDouble a, SimdDouble b) { return {_mm256_mul_pd(a.v, b.v)}; }
+inline SimdDouble operator/(SimdDouble a, SimdDouble b) { return {_mm256_div_pd(a.v, b.v)}; }
+inline SimdDouble fma(SimdDouble a, SimdDouble b, SimdDouble c) { return {_mm256_fmadd_pd(a.v, b.v, c.v)}; }
+inline SimdDouble sqrt(SimdDouble a) { return {_mm256_sqrt_pd(a.v)}; }
+inline SimdDouble min(SimdDouble a, SimdDouble b) { return {_mm256_min_pd(a.v, b.v)}; }
+inline SimdDouble max(SimdDouble a, SimdDouble b) { return {_mm256_max_pd(a.v, b.v)}; }
+
+// 2^n for t = n + 1.5 * 2^52, built directly in the exponent bits
+inline SimdDouble powerOfTwoFromShifted(SimdDouble t)
+{
+    __m256i bits = _mm256_add_epi64(_mm256_castpd_si256(t.v), _mm256_set1_epi64x(1023));
+    return {_mm256_castsi256_pd(_mm256_slli_epi64(bits, 52))};
+}
+
+// Lanes of value where x < limit are replaced by zero
+inline SimdDouble zeroWhereLess(SimdDouble value, SimdDouble x, SimdDouble limit)
+{
+    return {_mm256_and_pd(_mm256_cmp_pd(x.v, limit.v, _CMP_GE_OQ), value.v)};
+}
+
+// Lanes of a where x < limit, of b elsewhere
+inline SimdDouble whereLess(SimdDouble x, SimdDouble limit, SimdDouble a, SimdDouble b)
+{
+    return {_mm256_blendv_pd(b.v, a.v, _mm256_cmp_pd(x.v, limit.v, _CMP_LT_OQ))};
+}
+
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+
+struct SimdDouble
+{
+    static constexpr size_t WIDTH = 2;
+    float64x2_t v;
+
+    static SimdDouble broadcast(double x) { return {vdupq_n_f64(x)}; }
+    static SimdDouble load(const double *p) { return {vld1q_f64(p)}; }
+    void store(double *p) const { vst1q_f64(p, v); }
+};
+
+inline SimdDouble operator+(SimdDouble a, SimdDouble b) { return {vaddq_f64(a.v, b.v)}; }
+inline SimdDouble operator-(SimdDouble a, SimdDouble b) { return {vsubq_f64(a.v, b.v)}; }
+inline SimdDouble operator*(SimdDouble a, SimdDouble b) { return {vmulq_f64(a.v, b.v)}; }
+inline SimdDouble operator/(SimdDouble a, SimdDouble b) { return {vdivq_f64(a.v, b.v)}; }
+inline SimdDouble fma(SimdDouble a, SimdDouble b, SimdDouble c) { return {vfmaq_f64(c.v, a.v, b.v)}; }
+inline SimdDouble sqrt(SimdDouble a) { return {vsqrtq_f64(a.v)}; }
+inline SimdDouble min(SimdDouble a, SimdDouble b) { return {vminq_f64(a.v, b.v)}; }
+inline SimdDouble max(SimdDouble a, SimdDouble b) { return {vmaxq_f64(a.v, b.v)}; }
+
+// 2^n for t = n + 1.5 * 2^52, built directly in the exponent bits
+inline SimdDouble powerOfTwoFromShifted(SimdDouble t)
+{
+    int64x2_t bits = vaddq_s64(vreinterpretq_s64_f64(t.v), vdupq_n_s64(1023));
+    return {vreinterpretq_f64_s64(vshlq_n_s64(bits, 52))};
+}
+
+// Lanes of value where x < limit are replaced by zero
+inline SimdDouble zeroWhereLess(SimdDouble value, SimdDouble x, SimdDouble limit)
+{
+    return {vbslq_f64(vcltq_f64(x.v, limit.v), vdupq_n_f64(0.0), value.v)};
+}
+
+// Lanes of a where x < limit, of b elsewhere
+inline SimdDouble whereLess(SimdDouble x, SimdDouble limit, SimdDouble a, SimdDouble b)
+{
+    return {vbslq_f64(vcltq_f64(x.v, limit.v), a.v, b.v)};
+}
+
+#else
+
+#define NUCCALC_SIMD_SCALAR
+
+struct SimdDouble
+{
+    static constexpr size_t WIDTH = 1;
+    double v;
+
+    static SimdDouble broadcast(double x) { return {x}; }
+    static SimdDouble load(const double *p) { return {*p}; }
+    void store(double *p) const { *p = v; }
+};
+
+inline SimdDouble operator+(SimdDouble a, SimdDouble b) { return {a.v + b.v}; }
+inline SimdDouble operator-(SimdDouble a, SimdDouble b) { return {a.v - b.v}; }
+inline SimdDouble operator*(SimdDouble a, SimdDouble b) { return {a.v * b.v}; }
+inline SimdDouble operator/(SimdDouble a, SimdDouble b) { return {a.v / b.v}; }
+inline SimdDouble fma(SimdDouble a, SimdDouble b, SimdDouble c) { return {a.v * b.v + c.v}; }
+inline SimdDouble sqrt(SimdDouble a) { return {std::sqrt(a.v)}; }
+inline SimdDouble exp(SimdDouble a) { return {std::exp(a.v)}; }
+inline SimdDouble whereLess(SimdDouble x, SimdDouble limit, SimdDouble a, SimdDouble b) { return x.v < limit.v ? a : b; }
+
+#endif
+
+#if !defined(NUCCALC_SIMD_SCALAR)
+// Vector exp: x = n ln2 + r with |r| <= ln2/2, exp(r) by a degree-12 Taylor polynomial
+// (relative error below 3e-16), scaled by 2^n through the exponent bits.
+// Results underflow to zero below -708.3; inputs are not expected above 709.
+inline SimdDouble exp(SimdDouble x)
+{
+    const SimdDouble lowerLimit = SimdDouble::broadcast(-708.3);
+    SimdDouble clamped = min(max(x, lowerLimit), SimdDouble::broadcast(709.0));
+
+    const SimdDouble shifter = SimdDouble::broadcast(6755399441055744.0); // 1.5 * 2^52
+    SimdDouble t = fma(clamped, SimdDouble::broadcast(1.4426950408889634), shifter);
+    SimdDouble n = t - shifter; // round(x / ln2)
+
+    // Cody-Waite reduction with a two-part ln2
+    SimdDouble r = fma(n, SimdDouble::broadcast(-0.693145751953125), clamped);
+    r = fma(n, SimdDouble::broadcast(-1.42860682030941723212e-6), r);
+
+    SimdDouble p = SimdDouble::broadcast(1.0 / 479001600.0); // 1/12!
+    p = fma(p, r, SimdDouble::broadcast(1.0 / 39916800.0));
+    p = fma(p, r, SimdDouble::broadcast(1.0 / 3628800.0));
+    p = fma(p, r, SimdDouble::broadcast(1.0 / 362880.0));
+    p = fma(p, r, SimdDouble::broadcast(1.0 / 40320.0));
+    p = fma(p, r, SimdDouble::broadcast(1.0 / 5040.0));
+    p = fma(p, r, SimdDouble::broadcast(1.0 / 720.0));
+    p = fma(p, r, SimdDouble::broadcast(1.0 / 120.0));
+    p = fma(p, r, SimdDouble::broadcast(1.0 / 24.0));
+    p = fma(p, r, SimdDouble::broadcast(1.0 / 6.0));
+    p = fma(p, r, SimdDouble::broadcast(0.5));
+    p = fma(p, r, SimdDouble::broadcast(1.0));
+    p = fma(p, r, SimdDouble::broadcast(1.0));
+
+    return zeroWhereLess(p * powerOfTwoFromShifted(t), x, lowerLimit);
+}
+#endif
+
+/*******************************************************************************
+ * Profile kernels
+ *
+ * Batched variants of the per-distance kernels for range curves. Everything
+ * that only depends on the scenario is hoisted into an invariants struct once,
+ * and the remaining per-distance work runs over contiguous double arrays.
+ ******************************************************************************/
+
+// Scenario invariants of calculateBlastOverpressure
+struct BlastInvariants
+{
+    double blastScale; // Sachs scaling length (E/P0)^(1/3) in meters
+    double amplitude;  // Ambient pressure times Mach stem enhancement (Pa)
+};
+
+// Function to hoist the yield and height dependent terms of the Brode equation
+inline BlastInvariants makeBlastInvariants(double yield, double height,
+                                           const AtmosphereConditions &atmosphere = AtmosphereConditions())
+{
+    double E = yield * 4.184e15; // Total energy release in joules
+
+    double machStemFactor = 1.0; // Same Mach stem and triple-point model as the scalar kernel
+    if (height > 0)
+    {
+        double machHeight = height / cbrt(yield);
+        machStemFactor = 1.0 + 0.1 * exp(-machHeight / 100.0);
+        if (height < 83 * pow(yield, 0.4))
+            machStemFactor *= 1.25;
+    }
+
+    return {cbrt(E / atmosphere.pressure), atmosphere.pressure * machStemFactor};
+}
+
+// Function to evaluate the blast overpressure (Pa) at count distances (m)
+// With x = 1/scaled_distance the Brode polynomial is amplitude * (1 + x(0.076 + x(0.255 + 0.536x)))
+inline void calculateBlastOverpressureProfile(const BlastInvariants &blast, const double *distances,
+                                              double *pressures, size_t count)
+{
+    const SimdDouble scale = SimdDouble::broadcast(blast.blastScale);
+    const SimdDouble amplitude = SimdDouble::broadcast(blast.amplitude);
+    const SimdDouble one = SimdDouble::broadcast(1.0);
+    const SimdDouble c1 = SimdDouble::broadcast(0.076);
+    const SimdDouble c2 = SimdDouble::broadcast(0.255);
+    const SimdDouble c3 = SimdDouble::broadcast(0.536);
+
+    size_t i = 0;
+    for (; i + SimdDouble::WIDTH <= count; i += SimdDouble::WIDTH)
+    {
+        SimdDouble x = scale / SimdDouble::load(distances + i);
+        SimdDouble polynomial = fma(x, fma(x, fma(x, c3, c2), c1), one);
+        (amplitude * polynomial).store(pressures + i);
+    }
+    for (; i < count; i++)
+    {
+        double x = blast.blastScale / distances[i];
+        pressures[i] = blast.amplitude * (1.0 + x * (0.076 + x * (0.255 + x * 0.536)));
+    }
+}
+
+// Function to build a blast overpressure curve (Pa) for a scenario over the given distances (m)
+inline std::vector<double> blastOverpressureProfile(double yield, double height, const std::vector<double> &distances,
+                                                    const AtmosphereConditions &atmosphere = AtmosphereConditions())
+{
+    std::vector<double> pressures(distances.size());
+    calculateBlastOverpressureProfile(makeBlastInvariants(yield, height, atmosphere), distances.data(),
+                                      pressures.data(), distances.size());
+    return pressures;
+}
+
+// Scenario invariants of calculateThermalRadiation
+struct ThermalInvariants
+{
+    double amplitude;   // Calibrated thermal energy / 4pi, including the burst height absorption (J)
+    double attenuation; // Beer-Lambert attenuation coefficient (1/m)
+    double height;      // Height of burst (m)
+};
+
+// Function to hoist the yield and height dependent terms of the thermal model
+inline ThermalInvariants makeThermalInvariants(double yield, double height,
+                                               const AtmosphereConditions &atmosphere = AtmosphereConditions())
+{
+    const double THERMAL_CONSTANT = 10000.0; // Calibration constant, as in the scalar kernel
+    double amplitude = THERMAL_CONSTANT * yield * 4.184e15 * 0.35 / (4.0 * M_PI);
+    if (height > 0)
+        amplitude *= exp(-height / atmosphere.scaleHeight);
+    return {amplitude, -atmosphere.attenuation / 1000.0, std::max(0.0, height)};
+}
+
+// Function to evaluate the thermal fluence (J/m²) at count distances (m) into a caller-provided buffer
+// The slant-path factor sqrt(1 - (h/(d+h))²) is rewritten as sqrt(d(d+2h))/(d+h), which is exactly 1
+// for surface bursts, so one branch-free expression covers both cases with a single division
+inline void calculateThermalRadiationProfile(const ThermalInvariants &thermal, const double *distances,
+                                             double *fluence, size_t count)
+{
+    const SimdDouble amplitude = SimdDouble::broadcast(thermal.amplitude);
+    const SimdDouble attenuation = SimdDouble::broadcast(thermal.attenuation);
+    const SimdDouble height = SimdDouble::broadcast(thermal.height);
+    const SimdDouble twiceHeight = SimdDouble::broadcast(2.0 * thermal.height);
+
+    size_t i = 0;
+    for (; i + SimdDouble::WIDTH <= count; i += SimdDouble::WIDTH)
+    {
+        SimdDouble d = SimdDouble::load(distances + i);
+        SimdDouble slant = sqrt(d * (d + twiceHeight));
+        SimdDouble denominator = d * d * (d + height);
+        (amplitude * exp(attenuation * d) * slant / denominator).store(fluence + i);
+    }
+    for (; i < count; i++)
+    {
+        double d = distances[i];
+        double slant = std::sqrt(d * (d + 2.0 * thermal.height));
+        fluence[i] = thermal.amplitude * std::exp(thermal.attenuation * d) * slant / (d * d * (d + thermal.height));
+    }
+}
+
+// Function to build a thermal fluence curve (J/m²) for a scenario over the given distances (m)
+inline std::vector<double> thermalRadiationProfile(double yield, double height, const std::vector<double> &distances,
+                                                   const AtmosphereConditions &atmosphere = AtmosphereConditions())
+{
+    std::vector<double> fluence(distances.size());
+    calculateThermalRadiationProfile(makeThermalInvariants(yield, height, atmosphere), distances.data(),
+                                     fluence.data(), distances.size());
+    return fluence;
+}
+
+/*******************************************************************************
+ * Threshold ranges
+ *
+ * The inverse of the profile kernels: the range (m) at which the blast
+ * overpressure or the thermal fluence of a scenario falls to a threshold. The
+ * Brode equation tends to its ambient term (BlastInvariants::amplitude) far
+ * from the burst, so overpressure thresholds apply to the part above it. Both
+ * curves then fall monotonically from infinity at ground zero to zero, and
+ * every positive threshold has exactly one range.
+ *
+ * Queries are solved SimdDouble::WIDTH at a time by Newton's method on
+ * ln(curve / threshold) against ln(range), which is close to linear for both
+ * curves. The logarithm is replaced by 2(r - 1)/(r + 1) of the ratio r, exact
+ * to third order at the root and bounded by 2, so no vector log is needed and
+ * no step changes the range by more than a factor e². Both curves have a
+ * log-log slope of -1 or steeper everywhere, so the first evaluation brackets
+ * the root between the starting range and that range times the ratio, and
+ * iterates that leave the bracket are replaced by geometric bisection.
+ *
+ * The starting range is the dominant scaling law of each curve: cube-root
+ * (Sachs) scaling of the leading Brode term for the blast, and the inverse-
+ * square law with Beer-Lambert extinction for the thermal fluence. From there
+ * two to four iterations reach full double precision.
+ ******************************************************************************/
+
+// Function to solve one block of threshold ranges (m) by safeguarded Newton iteration from guess
+// evaluate(range, ratio, slope) sets the curve over the threshold and its log-log slope at each lane's range;
+// the lanes are independent queries and the block ends when all of them have converged
+template <typename Evaluate>
+inline SimdDouble solveRangeBlock(SimdDouble guess, Evaluate &&evaluate)
+{
+    const int MAX_ITERATIONS = 64;  // Bisection alone shrinks any bracket below the tolerance well before this
+    const double TOLERANCE = 1e-10; // Of the last Newton step in ln(range); the following one would be below 1e-16
+    const SimdDouble one = SimdDouble::broadcast(1.0);
+    const SimdDouble two = SimdDouble::broadcast(2.0);
+    const SimdDouble smallest = SimdDouble::broadcast(1e-300); // Keeps the lower bracket end above zero
+
+    SimdDouble range = guess;
+    SimdDouble ratio, slope;
+    evaluate(range, ratio, slope);
+
+    SimdDouble bound = range * whereLess(ratio, smallest, smallest, ratio);
+    SimdDouble low = whereLess(ratio, one, bound, range);
+    SimdDouble high = whereLess(ratio, one, range, bound);
+
+    for (int iteration = 0; iteration < MAX_ITERATIONS; iteration++)
+    {
+        SimdDouble logStep = two * (one - ratio) / ((ratio + one) * slope);
+        SimdDouble next = range * exp(logStep);
+
+        double steps[SimdDouble::WIDTH];
+        logStep.store(steps);
+        double largest = 0;
+        for (double step : steps)
+            largest = std::max(largest, std::fabs(step));
+        if (largest < TOLERANCE)
+            return next;
+
+        SimdDouble middle = sqrt(low * high);
+        range = whereLess(next, low, middle, whereLess(high, next, middle, next));
+
+        evaluate(range, ratio, slope);
+        low = whereLess(ratio, one, low, range);
+        high = whereLess(ratio, one, range, high);
+    }
+    return range;
+}
+
+// Function to solve the ranges (m) at which the blast overpressure above the ambient term falls to the thresholds (Pa)
+// blast, thresholds and ranges hold count queries; thresholds must be positive
+inline void solveOverpressureRanges(const BlastInvariants *blast, const double *thresholds, double *ranges, size_t count)
+{
+    const size_t WIDTH = SimdDouble::WIDTH;
+    const SimdDouble c1 = SimdDouble::broadcast(0.076);
+    const SimdDouble c2 = SimdDouble::broadcast(0.255);
+    const SimdDouble c3 = SimdDouble::broadcast(0.536);
+    const SimdDouble slope1 = SimdDouble::broadcast(-0.076);
+    const SimdDouble slope2 = SimdDouble::broadcast(-2 * 0.255);
+    const SimdDouble slope3 = SimdDouble::broadcast(-3 * 0.536);
+
+    for (size_t first = 0; first < count; first += WIDTH)
+    {
+        size_t lanes = std::min(WIDTH, count - first);
+        double scales[WIDTH], levels[WIDTH], guesses[WIDTH];
+        for (size_t k = 0; k < WIDTH; k++)
+        {
+            size_t i = first + std::min(k, lanes - 1); // Spare lanes repeat the last query
+            double level = thresholds[i] / blast[i].amplitude;
+            scales[k] = blast[i].blastScale;
+            levels[k] = level;
+            // The larger of the x and x³ asymptotes of x(0.076 + x(0.255 + 0.536x)), from inside the root
+            guesses[k] = blast[i].blastScale / std::min(level / 0.076, cbrt(level / 0.536));
+        }
+
+        const SimdDouble scale = SimdDouble::load(scales);
+        const SimdDouble level = SimdDouble::load(levels);
+        SimdDouble range = solveRangeBlock(SimdDouble::load(guesses), [&](SimdDouble distance, SimdDouble &ratio, SimdDouble &slope)
+                                           {
+            SimdDouble x = scale / distance;
+            SimdDouble polynomial = fma(x, fma(x, c3, c2), c1);
+            ratio = x * polynomial / level;
+            slope = fma(x, fma(x, slope3, slope2), slope1) / polynomial; });
+
+        double solved[WIDTH];
+        range.store(solved);
+        std::copy(solved, solved + lanes, ranges + first);
+    }
+}
+
+// Function to approximate the principal branch of the Lambert W function for z >= 0 (Winitzki, within 2%)
+inline double approximateLambertW(double z)
+{
+    double l = log1p(z);
+    return l * (1.0 - log1p(l) / (2.0 + l));
+}
+
+// Function to solve the ranges (m) at which the thermal fluence falls to the thresholds (J/m²)
+// thermal, thresholds and ranges hold count queries; thresholds must be positive
+inline void solveThermalRanges(const ThermalInvariants *thermal, const double *thresholds, double *ranges, size_t count)
+{
+    const size_t WIDTH = SimdDouble::WIDTH;
+    const SimdDouble half = SimdDouble::broadcast(0.5);
+    const SimdDouble oneAndHalf = SimdDouble::broadcast(1.5);
+
+    for (size_t first = 0; first < count; first += WIDTH)
+    {
+        size_t lanes = std::min(WIDTH, count - first);
+        double amplitudes[WIDTH], attenuations[WIDTH], heights[WIDTH], guesses[WIDTH];
+        for (size_t k = 0; k < WIDTH; k++)
+        {
+            size_t i = first + std::min(k, lanes - 1); // Spare lanes repeat the last query
+            amplitudes[k] = thermal[i].amplitude / thresholds[i];
+            attenuations[k] = thermal[i].attenuation;
+            heights[k] = thermal[i].height;
+
+            // Inverse square law, then exp(-kd)/d² = threshold/amplitude solved through d = (2/k) W(k d0 / 2)
+            double inverseSquare = std::sqrt(amplitudes[k]);
+            double z = -thermal[i].attenuation * inverseSquare / 2.0;
+            guesses[k] = z > 1e-8 ? inverseSquare * approximateLambertW(z) / z : inverseSquare;
+        }
+
+        const SimdDouble amplitude = SimdDouble::load(amplitudes); // Amplitude over the threshold
+        const SimdDouble attenuation = SimdDouble::load(attenuations);
+        const SimdDouble height = SimdDouble::load(heights);
+        const SimdDouble twiceHeight = height + height;
+        SimdDouble range = solveRangeBlock(SimdDouble::load(guesses), [&](SimdDouble d, SimdDouble &ratio, SimdDouble &slope)
+                                           {
+            SimdDouble nearSide = d + twiceHeight;
+            SimdDouble slant = d + height;
+            ratio = amplitude * exp(attenuation * d) * sqrt(d * nearSide) / (d * d * slant);
+            // d/dln(d) of ln(exp(ad) sqrt(d(d + 2h)) / (d²(d + h)))
+            slope = fma(attenuation, d, half * d / nearSide - d / slant - oneAndHalf); });
+
+        double solved[WIDTH];
+        range.store(solved);
+        std::copy(solved, solved + lanes, ranges + first);
+    }
+}
+
+/*******************************************************************************
+ * Time series
+ *
+ * Time-resolved blast and thermal output, generated lazily. A TimeSeries is an
+ * input range whose iterator computes the next sample of its model when it is
+ * advanced, so no series is materialized and a consumer that stops early never
+ * pays for the rest. Every begin() restarts the model at the detonation.
+ *
+ * BlastFrontModel follows the shock front along the ground. The front moves at
+ * the Rankine-Hugoniot shock speed of air, U = c0 sqrt(1 + 6 dp / (7 P0)), with
+ * c0 = SPEED_OF_SOUND and dp the overpressure of the Brode equation above its
+ * ambient term (as for the threshold ranges). Close to ground zero the x³ term
+ * dominates and the front grows as t^(2/5) in closed form. Beyond 2% of the
+ * Sachs length dr/dt = U(r) is integrated by classical Runge-Kutta in substeps
+ * that move the front by at most 5%, so the samples do not depend on the time
+ * step the consumer asks for.
+ *
+ * ThermalPulseModel is the radiated power of the main thermal pulse of an air
+ * burst, P / Pmax = 2τ² / (1 + τ⁴) with τ = t / tmax and tmax = 0.0417 W^0.44 s
+ * (W in kt), normalized to the thermal partition of the thermal kernel.
+ ******************************************************************************/
+
+// One sample of the blast front
+struct BlastFrontSample
+{
+    double time;         // Since the detonation (s)
+    double radius;       // Ground range of the shock front (m)
+    double overpressure; // Peak overpressure behind the front, above the ambient pressure (Pa)
+    double speed;        // Speed of the shock front (m/s)
+};
+
+// Shock front of a burst, advanced in time by sampleAt()
+class BlastFrontModel
+{
+public:
+    using Sample = BlastFrontSample;
+
+    BlastFrontModel(double yield, double height, const AtmosphereConditions &atmosphere = AtmosphereConditions())
+        : blast(makeBlastInvariants(yield, height, atmosphere)),
+          machScale(6.0 / 7.0 * blast.amplitude / atmosphere.pressure)
+    {
+        // With U = A r^(-3/2) from the x³ term, r^(5/2) = (5/2) A t up to the start of the integration
+        double A = PhysicalConstants::SPEED_OF_SOUND * std::sqrt(machScale * 0.536) * std::pow(blast.blastScale, 1.5);
+        growth = 2.5 * A;
+        startRadius = 0.02 * blast.blastScale;
+        startTime = std::pow(startRadius, 2.5) / growth;
+    }
+
+    // Function to advance the front to time (s), which must not precede the previous sample
+    Sample sampleAt(double time)
+    {
+        if (time <= startTime)
+        {
+            current = time;
+            radius = std::pow(growth * time, 0.4);
+        }
+        else
+        {
+            if (current < startTime)
+            {
+                current = startTime;
+                radius = startRadius;
+            }
+            while (current < time)
+            {
+                // Classical Runge-Kutta on dr/dt = U(r), limited to a 5% move of the front
+                double step = std::min(time - current, 0.05 * radius / speedAt(radius));
+                double k1 = speedAt(radius);
+                double k2 = speedAt(radius + 0.5 * step * k1);
+                double k3 = speedAt(radius + 0.5 * step * k2);
+                double k4 = speedAt(radius + step * k3);
+                radius += step / 6.0 * (k1 + 2.0 * k2 + 2.0 * k3 + k4);
+                current = step < time - current ? current + step : time;
+            }
+        }
+        return {time, radius, blast.amplitude * excessAt(radius), speedAt(radius)};
+    }
+
+private:
+    BlastInvariants blast;
+    double machScale;   // 6/7 of the Brode amplitude over the ambient pressure
+    double growth;      // (5/2) A of the closed-form start, r^(5/2) = growth * t (m^(5/2)/s)
+    double startRadius; // Radius where the integration takes over (m)
+    double startTime;   // Time the front reaches startRadius (s)
+    double current = 0; // Time of the front position (s)
+    double radius = 0;  // Front position (m)
+
+    // Function to calculate the Brode overpressure above the ambient term over the amplitude at a range (m)
+    double excessAt(double range) const
+    {
+        double x = blast.blastScale / range;
+        return x * (0.076 + x * (0.255 + x * 0.536));
+    }
+
+    // Function to calculate the shock speed (m/s) at a range (m)
+    double speedAt(double range) const
+    {
+        return PhysicalConstants::SPEED_OF_SOUND * std::sqrt(1.0 + machScale * excessAt(range));
+    }
+};
+
+// One sample of the thermal pulse
+struct ThermalPulseSample
+{
+    double time;    // Since the detonation (s)
+    double power;   // Radiated thermal power of the fireball (W)
+    double emitted; // Fraction of the thermal energy radiated so far
+};
+
+// Main thermal pulse of a burst in closed form
+class ThermalPulseModel
+{
+public:
+    using Sample = ThermalPulseSample;
+
+    explicit ThermalPulseModel(double yield)
+        : peakTime(0.0417 * std::pow(yield * 1000.0, 0.44)),
+          // The pulse integrates to Pmax tmax π/√2
+          peakPower(yield * 4.184e15 * 0.35 * M_SQRT2 / (M_PI * peakTime))
+    {
+    }
+
+    // Function to evaluate the pulse at time (s)
+    Sample sampleAt(double time) const
+    {
+        double t = time / peakTime;
+        double t2 = t * t;
+        // ∫ 2s²/(1 + s⁴) ds from 0 to t, over its limit π/√2
+        double emitted = (0.5 * std::log((t2 - M_SQRT2 * t + 1.0) / (t2 + M_SQRT2 * t + 1.0)) +
+                          std::atan(M_SQRT2 * t + 1.0) + std::atan(M_SQRT2 * t - 1.0)) /
+                         M_PI;
+        return {time, peakPower * 2.0 * t2 / (1.0 + t2 * t2), emitted};
+    }
+
+private:
+    double peakTime;  // Time of the power maximum (s)
+    double peakPower; // Power maximum (W)
+};
+
+// Lazy series of samples of a model at multiples of a time step (s), starting one step after the detonation
+// Model::sampleAt() is called with increasing times, once per iterator increment
+template <typename Model>
+class TimeSeries
+{
+public:
+    using Sample = typename Model::Sample;
+
+    // End of a series, reached after the requested number of samples
+    struct Sentinel
+    {
+    };
+
+    class iterator
+    {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Sample;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Sample *;
+        using reference = const Sample &;
+
+        iterator(const Model &model, double timeStep, size_t samples)
+            : model(model), timeStep(timeStep), samples(samples)
+        {
+            if (samples > 0)
+                sample = this->model.sampleAt(timeStep);
+        }
+
+        const Sample &operator*() const { return sample; }
+        const Sample *operator->() const { return &sample; }
+
+        iterator &operator++()
+        {
+            if (++index < samples)
+                sample = model.sampleAt(static_cast<double>(index + 1) * timeStep);
+            return *this;
+        }
+
+        bool operator!=(Sentinel) const { return index < samples; }
+        bool operator==(Sentinel) const { return index >= samples; }
+
+    private:
+        Model model; // Own copy, so every iteration starts at the detonation
+        double timeStep;
+        size_t samples;
+        size_t index = 0;
+        Sample sample{};
+    };
+
+    TimeSeries(const Model &model, double timeStep, size_t samples)
+        : model(model), timeStep(timeStep), samples(samples)
+    {
+    }
+
+    iterator begin() const { return iterator(model, timeStep, samples); }
+    Sentinel end() const { return Sentinel(); }
+
+private:
+    Model model;
+    double timeStep;
+    size_t samples;
+};
+
+// Function to create the lazy blast front series of a burst
+inline TimeSeries<BlastFrontModel> blastFrontSeries(double yield, double height, double timeStep, size_t samples,
+                                                    const AtmosphereConditions &atmosphere = AtmosphereConditions())
+{
+    return TimeSeries<BlastFrontModel>(BlastFrontModel(yield, height, atmosphere), timeStep, samples);
+}
+
+// Function to create the lazy thermal pulse series of a burst
+inline TimeSeries<ThermalPulseModel> thermalPulseSeries(double yield, double timeStep, size_t samples)
+{
+    return TimeSeries<ThermalPulseModel>(ThermalPulseModel(yield), timeStep, samples);
+}
+
+/*******************************************************************************
+ * Result records
+ *
+ * ResultRow is the precision-independent, flat form of one scenario result
+ * that the result writers consume. RESULT_COLUMNS describes its fields in
+ * output order; the binary and JSON-lines writers are driven by that schema,
+ * the CSV record keeps its historical subset of columns.
+ ******************************************************************************/
+
+// One scenario result with every value widened to double
+struct ResultRow
+{
+    double yield;     // Megatons
+    double height;    // Meters
+    double windSpeed; // km/h
+    uint32_t cityIndex;
+    uint8_t isAirburst;
+
+    double thermalSevere, thermalModerate, thermalLight;                 // Radii (m)
+    double thermalSevereArea, thermalModerateArea, thermalLightArea;     // Areas (km²)
+    double blastSevere, blastModerate, blastLight;                       // Radii (m)
+    double blastSevereArea, blastModerateArea, blastLightArea;           // Areas (km²)
+    double radiationSevere, radiationModerate, radiationLight;           // Radii (m)
+    double radiationSevereArea, radiationModerateArea, radiationLightArea; // Areas (km²)
+
+    double falloutDistance; // km
+    double falloutWidth;    // km
+    double falloutArea;     // km²
+    double falloutAngle;    // Degrees
+
+    double deaths;
+    double severeInjuries;
+    double lightInjuries;
+    double totalCasualties; // Summed at the evaluation precision
+    double longTermDeaths1Year;
+    double longTermDeaths5Year;
+    double longTermDeaths10Year;
+    double longTermDeaths20Year;
+};
+
+// Storage type of a result column
+enum class ColumnType : uint32_t
+{
+    Float64 = 1, // IEEE double
+    Bool = 2,    // uint8_t, 0 or 1
+    City = 3     // uint32_t index into the city table
+};
+
+// Schema entry of one result column
+struct ResultColumn
+{
+    std::string_view name;
+    ColumnType type;
+    size_t offset; // Byte offset of the field in ResultRow
+};
+
+// Function to get the stored width of a column type in bytes
+constexpr size_t columnWidth(ColumnType type)
+{
+    return type == ColumnType::Float64 ? sizeof(double) : type == ColumnType::City ? sizeof(uint32_t) : sizeof(uint8_t);
+}
+
+#define NUCCALC_COLUMN(name, type, field) ResultColumn{name, ColumnType::type, offsetof(ResultRow, field)}
+
+inline constexpr std::array<ResultColumn, 35> RESULT_COLUMNS = {{
+    NUCCALC_COLUMN("yield_mt", Float64, yield),
+    NUCCALC_COLUMN("height_m", Float64, height),
+    NUCCALC_COLUMN("airburst", Bool, isAirburst),
+    NUCCALC_COLUMN("wind_kmh", Float64, windSpeed),
+    NUCCALC_COLUMN("city", City, cityIndex),
+    NUCCALC_COLUMN("thermal_severe_m", Float64, thermalSevere),
+    NUCCALC_COLUMN("thermal_moderate_m", Float64, thermalModerate),
+    NUCCALC_COLUMN("thermal_light_m", Float64, thermalLight),
+    NUCCALC_COLUMN("thermal_severe_area_km2", Float64, thermalSevereArea),
+    NUCCALC_COLUMN("thermal_moderate_area_km2", Float64, thermalModerateArea),
+    NUCCALC_COLUMN("thermal_light_area_km2", Float64, thermalLightArea),
+    NUCCALC_COLUMN("blast_severe_m", Float64, blastSevere),
+    NUCCALC_COLUMN("blast_moderate_m", Float64, blastModerate),
+    NUCCALC_COLUMN("blast_light_m", Float64, blastLight),
+    NUCCALC_COLUMN("blast_severe_area_km2", Float64, blastSevereArea),
+    NUCCALC_COLUMN("blast_moderate_area_km2", Float64, blastModerateArea),
+    NUCCALC_COLUMN("blast_light_area_km2", Float64, blastLightArea),
+    NUCCALC_COLUMN("radiation_severe_m", Float64, radiationSevere),
+    NUCCALC_COLUMN("radiation_moderate_m", Float64, radiationModerate),
+    NUCCALC_COLUMN("radiation_light_m", Float64, radiationLight),
+    NUCCALC_COLUMN("radiation_severe_area_km2", Float64, radiationSevereArea),
+    NUCCALC_COLUMN("radiation_moderate_area_km2", Float64, radiationModerateArea),
+    NUCCALC_COLUMN("radiation_light_area_km2", Float64, radiationLightArea),
+    NUCCALC_COLUMN("fallout_distance_km", Float64, falloutDistance),
+    NUCCALC_COLUMN("fallout_width_km", Float64, falloutWidth),
+    NUCCALC_COLUMN("fallout_area_km2", Float64, falloutArea),
+    NUCCALC_COLUMN("fallout_angle_deg", Float64, falloutAngle),
+    NUCCALC_COLUMN("deaths", Float64, deaths),
+    NUCCALC_COLUMN("severe_injuries", Float64, severeInjuries),
+    NUCCALC_COLUMN("light_injuries", Float64, lightInjuries),
+    NUCCALC_COLUMN("total_casualties", Float64, totalCasualties),
+    NUCCALC_COLUMN("long_term_deaths_1y", Float64, longTermDeaths1Year),
+    NUCCALC_COLUMN("long_term_deaths_5y", Float64, longTermDeaths5Year),
+    NUCCALC_COLUMN("long_term_deaths_10y", Float64, longTermDeaths10Year),
+    NUCCALC_COLUMN("long_term_deaths_20y", Float64, longTermDeaths20Year),
+}};
+
+#undef NUCCALC_COLUMN
+
+// Function to flatten a scenario result into a ResultRow
+template <typename Real>
+inline ResultRow makeResultRow(const Scenario &scenario, const ScenarioResultT<Real> &result)
+{
+    const WeaponEffectsT<Real> &effects = result.effects;
+    const CasualtyEstimateT<Real> &casualties = result.casualties;
+    auto d = [](Real value) { return static_cast<double>(value); };
+
+    ResultRow row;
+    row.yield = scenario.yield;
+    row.height = scenario.height;
+    row.windSpeed = scenario.windSpeed;
+    row.cityIndex = static_cast<uint32_t>(scenario.cityIndex);
+    row.isAirburst = scenario.isAirburst ? 1 : 0;
+
+    row.thermalSevere = d(effects.thermal.severe);
+    row.thermalModerate = d(effects.thermal.moderate);
+    row.thermalLight = d(effects.thermal.light);
+    row.thermalSevereArea = d(effects.thermal.severeArea);
+    row.thermalModerateArea = d(effects.thermal.moderateArea);
+    row.thermalLightArea = d(effects.thermal.lightArea);
+    row.blastSevere = d(effects.blast.severe);
+    row.blastModerate = d(effects.blast.moderate);
+    row.blastLight = d(effects.blast.light);
+    row.blastSevereArea = d(effects.blast.severeArea);
+    row.blastModerateArea = d(effects.blast.moderateArea);
+    row.blastLightArea = d(effects.blast.lightArea);
+    row.radiationSevere = d(effects.radiation.severe);
+    row.radiationModerate = d(effects.radiation.moderate);
+    row.radiationLight = d(effects.radiation.light);
+    row.radiationSevereArea = d(effects.radiation.severeArea);
+    row.radiationModerateArea = d(effects.radiation.moderateArea);
+    row.radiationLightArea = d(effects.radiation.lightArea);
+
+    row.falloutDistance = d(effects.fallout.maxDownwindDistance);
+    row.falloutWidth = d(effects.fallout.maxWidth);
+    row.falloutArea = d(effects.fallout.dangerousZoneArea);
+    row.falloutAngle = d(effects.fallout.falloutAngle);
+
+    row.deaths = d(casualties.deaths);
+    row.severeInjuries = d(casualties.severeInjuries);
+    row.lightInjuries = d(casualties.lightInjuries);
+    row.totalCasualties = d(casualties.deaths + casualties.severeInjuries + casualties.lightInjuries);
+    row.longTermDeaths1Year = d(casualties.longTermDeaths1Year);
+    row.longTermDeaths5Year = d(casualties.longTermDeaths5Year);
+    row.longTermDeaths10Year = d(casualties.longTermDeaths10Year);
+    row.longTermDeaths20Year = d(casualties.longTermDeaths20Year);
+    return row;
+}
+
+// CSV header matching formatResultRecord()
+constexpr const char *RESULT_RECORD_HEADER =
+    "yield_mt,height_m,burst,wind_kmh,city,"
+    "thermal_severe_m,thermal_moderate_m,thermal_light_m,"
+    "blast_severe_m,blast_moderate_m,blast_light_m,"
+    "radiation_severe_m,radiation_moderate_m,radiation_light_m,"
+    "fallout_distance_km,fallout_width_km,fallout_area_km2,"
+    "deaths,severe_injuries,light_injuries,total_casualties\n";
+
+constexpr size_t RESULT_RECORD_SIZE = 768; // Upper bound for one formatted CSV record
+constexpr size_t RESULT_JSON_SIZE = 2048;  // Upper bound for one formatted JSON record
+constexpr size_t ESCAPED_NAME_SIZE = 2 * CATALOG_NAME_LIMIT + 2; // Upper bound for one escaped catalog name
+
+// Function to write a city name as a CSV field into buffer, quoted if it contains a comma or a quote
+inline std::string_view escapeCsvName(std::string_view name, char *buffer)
+{
+    if (name.find_first_of(",\"") == std::string_view::npos)
+        return name;
+    size_t length = 0;
+    buffer[length++] = '"';
+    for (char c : name)
+    {
+        if (c == '"')
+            buffer[length++] = '"';
+        buffer[length++] = c;
+    }
+    buffer[length++] = '"';
+    return std::string_view(buffer, length);
+}
+
+// Function to write a city name as JSON string contents into buffer, escaping quotes and backslashes
+// Catalogs reject control characters in names, so nothing else needs escaping
+inline std::string_view escapeJsonName(std::string_view name, char *buffer)
+{
+    if (name.find_first_of("\"\\") == std::string_view::npos)
+        return name;
+    size_t length = 0;
+    for (char c : name)
+    {
+        if (c == '"' || c == '\\')
+            buffer[length++] = '\\';
+        buffer[length++] = c;
+    }
+    return std::string_view(buffer, length);
+}
+
+// Function to format one result row as a CSV line, returns the number of characters written
+inline size_t formatResultRecord(char *record, size_t size, const ResultRow &row)
+{
+    char escaped[ESCAPED_NAME_SIZE];
+    std::string_view city = escapeCsvName(catalog().cities()[row.cityIndex].name, escaped);
+    int length = snprintf(record, size,
+                          "%.6g,%.6g,%s,%.6g,%.*s,"
+                          "%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,"
+                          "%.3f,%.3f,%.3f,%.0f,%.0f,%.0f,%.0f\n",
+                          row.yield, row.height, row.isAirburst ? "air" : "surface",
+                          row.windSpeed, static_cast<int>(city.size()), city.data(),
+                          row.thermalSevere, row.thermalModerate, row.thermalLight,
+                          row.blastSevere, row.blastModerate, row.blastLight,
+                          row.radiationSevere, row.radiationModerate, row.radiationLight,
+                          row.falloutDistance, row.falloutWidth, row.falloutArea,
+                          row.deaths, row.severeInjuries, row.lightInjuries, row.totalCasualties);
+    if (length < 0)
+        return 0;
+    return std::min(static_cast<size_t>(length), size - 1);
+}
+
+// Function to format one result as a CSV line, returns the number of characters written
+template <typename Real>
+inline size_t formatResultRecord(char *record, size_t size, const Scenario &scenario, const ScenarioResultT<Real> &result)
+{
+    return formatResultRecord(record, size, makeResultRow(scenario, result));
+}
+
+// Function to format one result row as a JSON object on one line with every RESULT_COLUMNS field
+inline size_t formatResultJson(char *record, size_t size, const ResultRow &row)
+{
+    const char *base = reinterpret_cast<const char *>(&row);
+    size_t used = 0;
+    for (size_t c = 0; c < RESULT_COLUMNS.size() && used < size; c++)
+    {
+        const ResultColumn &column = RESULT_COLUMNS[c];
+        const char *separator = c == 0 ? "{" : ",";
+        int length;
+        if (column.type == ColumnType::Float64)
+        {
+            double value;
+            memcpy(&value, base + column.offset, sizeof(value));
+            length = snprintf(record + used, size - used, "%s\"%.*s\":%.10g", separator,
+                              static_cast<int>(column.name.size()), column.name.data(), value);
+        }
+        else if (column.type == ColumnType::Bool)
+        {
+            length = snprintf(record + used, size - used, "%s\"%.*s\":%s", separator,
+                              static_cast<int>(column.name.size()), column.name.data(),
+                              base[column.offset] ? "true" : "false");
+        }
+        else
+        {
+            char escaped[ESCAPED_NAME_SIZE];
+            std::string_view city = escapeJsonName(catalog().cities()[row.cityIndex].name, escaped);
+            length = snprintf(record + used, size - used, "%s\"%.*s\":\"%.*s\"", separator,
+                              static_cast<int>(column.name.size()), column.name.data(),
+                              static_cast<int>(city.size()), city.data());
+        }
+        if (length < 0)
+            return 0;
+        used += static_cast<size_t>(length);
+    }
+    if (used + 2 < size)
+    {
+        record[used++] = '}';
+        record[used++] = '\n';
+        record[used] = '\0';
+    }
+    return std::min(used, size - 1);
+}
+
+/*******************************************************************************
+ * Result cache
+ *
+ * EffectsCache memoizes computeEffects() for workloads that repeat the same
+ * scenarios. Scenario parameters are quantized into a key and a missing entry
+ * is computed from the quantized scenario, so every query mapping to a key gets
+ * the same answer regardless of which one filled the entry. Weapon effects do
+ * not depend on the city and are cached separately from the per-city casualty
+ * estimates. Both levels are bounded LRU maps, striped over independently
+ * locked shards so parallel sweeps do not serialize on one lock.
+ ******************************************************************************/
+
+// Capacity and key quantization of an EffectsCache
+struct CacheOptions
+{
+    size_t capacity = 0;      // Maximum cached results, 0 disables the cache
+    double yieldQuantum = 0;  // Relative yield step, e.g. 0.01 for 1%; 0 keys on the exact value
+    double heightQuantum = 0; // Height step (m); 0 keys on the exact value
+    double windQuantum = 0;   // Wind speed step (km/h); 0 keys on the exact value
+};
+
+// Lookup counters of an EffectsCache
+struct CacheStatistics
+{
+    size_t hits = 0;       // Results returned from the cache
+    size_t misses = 0;     // Results computed
+    size_t effectHits = 0; // Misses that reused the cached effects of another city
+    size_t evictions = 0;  // Entries dropped to stay within the capacity
+};
+
+// Quantized scenario parameters identifying a cache entry
+struct ScenarioKey
+{
+    int64_t yield;
+    int64_t height;
+    int64_t wind;
+    size_t cityIndex;
+    bool isAirburst;
+
+    bool operator==(const ScenarioKey &other) const
+    {
+        return yield == other.yield && height == other.height && wind == other.wind &&
+               cityIndex == other.cityIndex && isAirburst == other.isAirburst;
+    }
+};
+
+struct ScenarioKeyHash
+{
+    size_t operator()(const ScenarioKey &key) const
+    {
+        // 64-bit multiply-xorshift mix of every field
+        uint64_t hash = static_cast<uint64_t>(key.yield) * 0x9E3779B97F4A7C15ull;
+        hash = (hash ^ (hash >> 29) ^ static_cast<uint64_t>(key.height)) * 0xBF58476D1CE4E5B9ull;
+        hash = (hash ^ (hash >> 32) ^ static_cast<uint64_t>(key.wind)) * 0x94D049BB133111EBull;
+        hash ^= (static_cast<uint64_t>(key.cityIndex) << 1) | (key.isAirburst ? 1u : 0u);
+        return static_cast<size_t>(hash ^ (hash >> 31));
+    }
+};
+
+// Function to get the key of a value on a linear grid of step quantum (or its exact bits if quantum is 0)
+// representative receives the value the key stands for
+inline int64_t quantizeLinear(double value, double quantum, double &representative)
+{
+    if (quantum > 0)
+    {
+        int64_t step = llround(value / quantum);
+        representative = static_cast<double>(step) * quantum;
+        return step;
+    }
+    int64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    representative = value;
+    return bits;
+}
+
+// Function to get the key of a positive value on a geometric grid with relative step quantum
+inline int64_t quantizeRelative(double value, double quantum, double &representative)
+{
+    if (quantum > 0 && value > 0)
+    {
+        double ratio = log1p(quantum);
+        int64_t step = llround(log(value) / ratio);
+        representative = exp(static_cast<double>(step) * ratio);
+        return step;
+    }
+    return quantizeLinear(value, 0, representative);
+}
+
+// Bounded map from scenario keys to values that evicts the least recently used entry
+// The entries live in one slab reserved for the capacity and are linked in recency order by index; an
+// open-addressing table indexes them. Lookups, inserts and evictions never allocate once setCapacity() ran.
+template <typename Value>
+class LruMap
+{
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    struct Entry
+    {
+        ScenarioKey key;
+        Value value;
+        uint32_t newer; // Toward the most recently used entry, NONE at the front
+        uint32_t older; // Toward the least recently used entry, NONE at the back
+    };
+
+    std::vector<Entry> entries;  // Never grows past the capacity, so its storage never moves
+    std::vector<uint32_t> slots; // Entry + 1 per slot, 0 is empty; linear probing
+    unsigned slotShift = 64;     // Hash bits above it pick the home slot (the shard uses the low bits)
+    size_t capacity;
+    uint32_t newest = NONE;
+    uint32_t oldest = NONE;
+
+    // Function to get the home slot of a key
+    size_t homeSlot(const ScenarioKey &key) const
+    {
+        uint64_t hash = static_cast<uint64_t>(ScenarioKeyHash()(key)) * 0x9E3779B97F4A7C15ull;
+        return slotShift < 64 ? static_cast<size_t>(hash >> slotShift) : 0;
+    }
+
+    // Function to find the slot holding key, or the empty slot ending its probe sequence
+    size_t findSlot(const ScenarioKey &key) const
+    {
+        size_t mask = slots.size() - 1;
+        size_t slot = homeSlot(key);
+        while (slots[slot] != 0 && !(entries[slots[slot] - 1].key == key))
+            slot = (slot + 1) & mask;
+        return slot;
+    }
+
+    // Function to empty a slot, shifting later entries of the probe sequence back into the gap
+    void eraseSlot(size_t slot)
+    {
+        size_t mask = slots.size() - 1;
+        size_t next = (slot + 1) & mask;
+        while (slots[next] != 0)
+        {
+            size_t home = homeSlot(entries[slots[next] - 1].key);
+            // The entry at next may move to slot unless its home lies cyclically in (slot, next]
+            if (((next - home) & mask) >= ((next - slot) & mask))
+            {
+                slots[slot] = slots[next];
+                slot = next;
+            }
+            next = (next + 1) & mask;
+        }
+        slots[slot] = 0;
+    }
+
+    void unlink(uint32_t e)
+    {
+        Entry &entry = entries[e];
+        (entry.newer == NONE ? newest : entries[entry.newer].older) = entry.older;
+        (entry.older == NONE ? oldest : entries[entry.older].newer) = entry.newer;
+    }
+
+    void pushFront(uint32_t e)
+    {
+        entries[e].newer = NONE;
+        entries[e].older = newest;
+        (newest == NONE ? oldest : entries[newest].newer) = e;
+        newest = e;
+    }
+
+public:
+    explicit LruMap(size_t capacity = 1)
+    {
+        setCapacity(capacity);
+    }
+
+    // Function to set the capacity and drop every entry; reserves all storage up front
+    void setCapacity(size_t value)
+    {
+        capacity = std::min<size_t>(std::max<size_t>(1, value), NONE - 1);
+        entries.clear();
+        entries.reserve(capacity);
+        size_t size = 2;
+        slotShift = 63;
+        while (size < 2 * capacity)
+        {
+            size *= 2;
+            slotShift--;
+        }
+        slots.assign(size, 0);
+        newest = oldest = NONE;
+    }
+
+    size_t size() const
+    {
+        return entries.size();
+    }
+
+    // Function to copy the value of key into value and mark it most recently used
+    bool find(const ScenarioKey &key, Value &value)
+    {
+        uint32_t slot = slots[findSlot(key)];
+        if (slot == 0)
+            return false;
+        uint32_t e = slot - 1;
+        if (e != newest)
+        {
+            unlink(e);
+            pushFront(e);
+        }
+        value = entries[e].value;
+        return true;
+    }
+
+    // Function to add an entry, returns the number of evicted entries
+    size_t insert(const ScenarioKey &key, const Value &value)
+    {
+        size_t slot = findSlot(key);
+        if (slots[slot] != 0)
+        {
+            uint32_t e = slots[slot] - 1;
+            entries[e].value = value; // Filled concurrently by another caller
+            unlink(e);
+            pushFront(e);
+            return 0;
+        }
+
+        size_t evicted = 0;
+        uint32_t e;
+        if (entries.size() < capacity)
+        {
+            e = static_cast<uint32_t>(entries.size());
+            entries.push_back(Entry{key, value, NONE, NONE});
+        }
+        else
+        {
+            e = oldest; // Reuse the least recently used entry
+            unlink(e);
+            eraseSlot(findSlot(entries[e].key));
+            entries[e].key = key;
+            entries[e].value = value;
+            slot = findSlot(key); // The erase may have shifted the probe sequence of key
+            evicted++;
+        }
+        slots[slot] = e + 1;
+        pushFront(e);
+        return evicted;
+    }
+};
+
+// Memoizing front end of computeEffects() for one ModelOptions configuration
+template <typename Real = DefaultReal>
+class EffectsCache
+{
+private:
+    // One lock stripe; effects and casualties of a scenario always live in the same shard
+    struct alignas(64) Shard
+    {
+        std::mutex lock;
+        LruMap<WeaponEffectsT<Real>> effects;
+        LruMap<CasualtyEstimateT<Real>> casualties;
+        CacheStatistics counters;
+    };
+
+    CacheOptions cacheOptions;
+    ModelOptions modelOptions;
+    std::vector<Shard> shards;
+
+    // Function to pick the shard count: up to 16 stripes of at least 64 entries each
+    static size_t shardCount(size_t capacity)
+    {
+        size_t count = 1;
+        while (count < 16 && capacity / (count * 2) >= 64)
+            count *= 2;
+        return count;
+    }
+
+public:
+    explicit EffectsCache(const CacheOptions &cache, const ModelOptions &model = ModelOptions())
+        : cacheOptions(cache), modelOptions(model), shards(shardCount(cache.capacity))
+    {
+        size_t perShard = (std::max<size_t>(1, cache.capacity) + shards.size() - 1) / shards.size();
+        for (Shard &shard : shards)
+        {
+            shard.effects.setCapacity(perShard);
+            shard.casualties.setCapacity(perShard);
+        }
+    }
+
+    EffectsCache(const EffectsCache &) = delete;
+    EffectsCache &operator=(const EffectsCache &) = delete;
+
+    // Function to evaluate a scenario through the cache, safe to call from several threads
+    ScenarioResultT<Real> computeEffects(const Scenario &scenario)
+    {
+        // Quantize the scenario; the representative values are what gets computed
+        Scenario quantized = scenario;
+        ScenarioKey key;
+        key.yield = quantizeRelative(scenario.yield, cacheOptions.yieldQuantum, quantized.yield);
+        key.height = quantizeLinear(scenario.height, cacheOptions.heightQuantum, quantized.height);
+        key.wind = quantizeLinear(scenario.windSpeed, cacheOptions.windQuantum, quantized.windSpeed);
+        key.isAirburst = scenario.isAirburst;
+        key.cityIndex = SIZE_MAX; // Effects key: no city
+
+        Shard &shard = shards[ScenarioKeyHash()(key) & (shards.size() - 1)];
+        ScenarioKey cityKey = key;
+        cityKey.cityIndex = scenario.cityIndex;
+
+        ScenarioResultT<Real> result;
+        bool haveEffects;
+        {
+            std::lock_guard<std::mutex> guard(shard.lock);
+            if (shard.casualties.find(cityKey, result.casualties) && shard.effects.find(key, result.effects))
+            {
+                shard.counters.hits++;
+                return result;
+            }
+            haveEffects = shard.effects.find(key, result.effects);
+            shard.counters.misses++;
+            if (haveEffects)
+                shard.counters.effectHits++;
+        }
+
+        // Compute outside the lock; a concurrent miss on the same key only repeats the work
+        if (!haveEffects)
+            result.effects = calculateEffects<Real>(quantized, modelOptions);
+        result.casualties = calculateCasualties(result.effects, catalog().cities()[scenario.cityIndex], modelOptions);
+
+        std::lock_guard<std::mutex> guard(shard.lock);
+        if (!haveEffects)
+            shard.counters.evictions += shard.effects.insert(key, result.effects);
+        shard.counters.evictions += shard.casualties.insert(cityKey, result.casualties);
+        return result;
+    }
+
+    // Function to sum the counters of all shards
+    CacheStatistics statistics()
+    {
+        CacheStatistics total;
+        for (Shard &shard : shards)
+        {
+            std::lock_guard<std::mutex> guard(shard.lock);
+            total.hits += shard.counters.hits;
+            total.misses += shard.counters.misses;
+            total.effectHits += shard.counters.effectHits;
+            total.evictions += shard.counters.evictions;
+        }
+        return total;
+    }
+};
+
+// Function to print cache counters as one line
+inline void printCacheStatistics(std::ostream &out, const CacheStatistics &statistics)
+{
+    size_t lookups = statistics.hits + statistics.misses;
+    char line[160];
+    int length = snprintf(line, sizeof(line), "cache: %zu hits, %zu misses (%zu with cached effects), %zu evictions, %.1f%% hit rate\n",
+                          statistics.hits, statistics.misses, statistics.effectHits, statistics.evictions,
+                          lookups ? 100.0 * statistics.hits / lookups : 0.0);
+    out.write(line, std::min(static_cast<size_t>(std::max(length, 0)), sizeof(line) - 1));
+}
+
+// Function to evaluate the scenarios at indices of one burst regime into their rows, as computeEffects() does
+template <typename Real, typename Scaling, unsigned Regime>
+inline void computeRegimeRows(const Scenario *scenarios, const uint16_t *indices, size_t count, ResultRow *rows,
+                              const ModelOptions &options, BurstRegime<Regime> regime)
+{
+    for (size_t k = 0; k < count; k++)
+    {
+        const Scenario &scenario = scenarios[indices[k]];
+        ScenarioResultT<Real> result;
+        result.effects = calculateEffects<Real, Scaling>(scenario, regime);
+        result.casualties = calculateCasualties(result.effects, catalog().cities()[scenario.cityIndex], options);
+        rows[indices[k]] = makeResultRow(scenario, result);
+    }
+}
+
+// Function to evaluate count scenarios into rows in input order, through the cache if there is one
+// Without a cache the scenarios are grouped by burst regime, up to 256 at a time, and every group runs
+// one specialization of calculateEffects; the rows are the same as from computeEffects() one by one
+template <typename Real>
+inline void computeResultRows(const Scenario *scenarios, size_t count, ResultRow *rows, const ModelOptions &options,
+                              EffectsCache<Real> *cache)
+{
+    if (cache)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            rows[i] = makeResultRow(scenarios[i], cache->computeEffects(scenarios[i]));
+        }
+        return;
+    }
+
+    const size_t SLICE = 256; // Scenarios grouped at a time, indexed by uint16_t
+    uint16_t order[SLICE];
+    unsigned char regimes[SLICE];
+    for (size_t first = 0; first < count; first += SLICE)
+    {
+        size_t slice = std::min(SLICE, count - first);
+        const Scenario *sliceScenarios = scenarios + first;
+
+        // Counting sort of the slice by regime, stable so each group keeps the input order
+        size_t offsets[BURST_REGIMES + 1] = {};
+        for (size_t i = 0; i < slice; i++)
+        {
+            regimes[i] = static_cast<unsigned char>(burstRegime<Real>(sliceScenarios[i]));
+            offsets[regimes[i] + 1]++;
+        }
+        for (unsigned r = 0; r < BURST_REGIMES; r++)
+            offsets[r + 1] += offsets[r];
+        size_t next[BURST_REGIMES];
+        std::copy(offsets, offsets + BURST_REGIMES, next);
+        for (size_t i = 0; i < slice; i++)
+            order[next[regimes[i]]++] = static_cast<uint16_t>(i);
+
+        for (unsigned r = 0; r < BURST_REGIMES; r++)
+        {
+            const uint16_t *group = order + offsets[r];
+            size_t groupSize = offsets[r + 1] - offsets[r];
+            if (groupSize == 0)
+                continue;
+            withBurstRegime(r, [&](auto regime)
+                            {
+                if (options.yieldScaling == YieldScaling::Tabulated)
+                    computeRegimeRows<Real, TabulatedYieldScaling>(sliceScenarios, group, groupSize, rows + first, options, regime);
+                else
+                    computeRegimeRows<Real, ExactYieldScaling>(sliceScenarios, group, groupSize, rows + first, options, regime); });
+        }
+    }
+}
+
+// Everything selectable at run time for batch and sweep evaluation
+struct EvaluationOptions
+{
+    Precision precision = Precision::Double;
+    ModelOptions model;
+    CacheOptions cache;
+    std::shared_ptr<const PopulationRaster> population; // Owner of model.population
+};
+
+/*******************************************************************************
+ * Parallel execution
+ *
+ * WorkStealingPool runs index ranges over a fixed set of worker threads. Each
+ * worker owns a deque of ranges: it splits its current range in half until it
+ * reaches the grain size, pushing the upper halves onto its own deque, and
+ * works from the bottom. Idle workers steal from the top of other deques, which
+ * holds the largest pending ranges. Uneven per-index cost is balanced
+ * dynamically instead of relying on a static partition.
+ ******************************************************************************/
+
+class WorkStealingPool
+{
+private:
+    struct Range
+    {
+        size_t begin;
+        size_t end;
+    };
+
+    // Per-worker range deque, padded to avoid false sharing between workers
+    struct alignas(64) WorkerQueue
+    {
+        std::mutex lock;
+        std::deque<Range> ranges;
+    };
+
+    // Type-erased job so dispatch does not allocate
+    typedef void (*JobFunction)(void *context, size_t begin, size_t end, unsigned worker);
+
+    std::vector<std::thread> threads;
+    std::vector<WorkerQueue> queues;
+
+    std::mutex jobLock;
+    std::condition_variable jobReady;
+    std::condition_variable jobDone;
+    unsigned long generation = 0; // Incremented for every dispatched job
+    bool stopping = false;
+    unsigned busyHelpers = 0; // Helper threads still inside the current job
+
+    JobFunction jobFunction = nullptr;
+    void *jobContext = nullptr;
+    size_t jobGrain = 1;
+    std::atomic<size_t> remaining{0}; // Indices not yet processed in the current job
+
+    // Function to take the most recently pushed range of this worker
+    bool popLocal(unsigned worker, Range &range)
+    {
+        WorkerQueue &queue = queues[worker];
+        std::lock_guard<std::mutex> guard(queue.lock);
+        if (queue.ranges.empty())
+            return false;
+        range = queue.ranges.back();
+        queue.ranges.pop_back();
+        return true;
+    }
+
+    // Function to push a range onto this worker's deque
+    void pushLocal(unsigned worker, Range range)
+    {
+        WorkerQueue &queue = queues[worker];
+        std::lock_guard<std::mutex> guard(queue.lock);
+        queue.ranges.push_back(range);
+    }
+
+    // Function to steal the oldest (largest) range from another worker
+    bool steal(unsigned worker, unsigned &seed, Range &range)
+    {
+        unsigned count = static_cast<unsigned>(queues.size());
+        seed = seed * 1664525u + 1013904223u; // LCG victim selection
+        unsigned start = seed % count;
+        for (unsigned k = 0; k < count; k++)
+        {
+            unsigned victim = (start + k) % count;
+            if (victim == worker)
+                continue;
+            WorkerQueue &queue = queues[victim];
+            std::lock_guard<std::mutex> guard(queue.lock);
+            if (!queue.ranges.empty())
+            {
+                range = queue.ranges.front();
+                queue.ranges.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Worker loop for the current job
+    void work(unsigned worker)
+    {
+        unsigned seed = worker * 2654435761u + 1;
+        while (remaining.load(std::memory_order_acquire) > 0)
+        {
+            Range range;
+            if (!popLocal(worker, range) && !steal(worker, seed, range))
+            {
+                std::this_thread::yield(); // Remaining ranges are in flight on other workers
+                continue;
+            }
+
+            // Split down to the grain size, leaving the upper halves for thieves
+            while (range.end - range.begin > jobGrain)
+            {
+                size_t middle = range.begin + (range.end - range.begin) / 2;
+                pushLocal(worker, {middle, range.end});
+                range.end = middle;
+            }
+
+            jobFunction(jobContext, range.begin, range.end, worker);
+            remaining.fetch_sub(range.end - range.begin, std::memory_order_acq_rel);
+        }
+    }
+
+    // Helper thread main loop
+    void helperLoop(unsigned worker)
+    {
+        unsigned long seen = 0;
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> guard(jobLock);
+                jobReady.wait(guard, [&] { return stopping || generation != seen; });
+                if (stopping)
+                    return;
+                seen = generation;
+            }
+
+            work(worker);
+
+            std::lock_guard<std::mutex> guard(jobLock);
+            if (--busyHelpers == 0)
+                jobDone.notify_one();
+        }
+    }
+
+    // Function to run a type-erased job on all workers, the calling thread is worker 0
+    void run(size_t count, size_t grain, JobFunction function, void *context)
+    {
+        if (count == 0)
+            return;
+
+        jobFunction = function;
+        jobContext = context;
+        jobGrain = std::max<size_t>(1, grain);
+        remaining.store(count, std::memory_order_release);
+
+        // Seed every worker with an equal share; stealing balances the rest
+        size_t workers = queues.size();
+        for (size_t w = 0; w < workers; w++)
+        {
+            size_t begin = count * w / workers;
+            size_t end = count * (w + 1) / workers;
+            if (begin < end)
+                pushLocal(static_cast<unsigned>(w), {begin, end});
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(jobLock);
+            busyHelpers = static_cast<unsigned>(threads.size());
+            generation++;
+        }
+        jobReady.notify_all();
+
+        work(0);
+
+        std::unique_lock<std::mutex> guard(jobLock);
+        jobDone.wait(guard, [&] { return busyHelpers == 0; });
+    }
+
+public:
+    // Creates a pool with the given number of workers (0 = one per hardware thread)
+    explicit WorkStealingPool(unsigned workers = 0)
+        : queues(workers ? workers : std::max(1u, std::thread::hardware_concurrency()))
+    {
+        for (unsigned w = 1; w < queues.size(); w++)
+        {
+            threads.emplace_back(&WorkStealingPool::helperLoop, this, w);
+        }
+    }
+
+    ~WorkStealingPool()
+    {
+        {
+            std::lock_guard<std::mutex> guard(jobLock);
+            stopping = true;
+        }
+        jobReady.notify_all();
+        for (std::thread &thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    // Number of workers, including the calling thread
+    unsigned size() const
+    {
+        return static_cast<unsigned>(queues.size());
+    }
+
+    // Function to call body(begin, end, worker) over [0, count) in chunks of at most grain indices
+    // Blocks until every index has been processed; worker is in [0, size())
+    template <typename Body>
+    void parallelFor(size_t count, size_t grain, Body &&body)
+    {
+        typedef typename std::remove_reference<Body>::type BodyType;
+        run(count, grain,
+            [](void *context, size_t begin, size_t end, unsigned worker)
+            { (*static_cast<BodyType *>(context))(begin, end, worker); },
+            const_cast<void *>(static_cast<const void *>(&body)));
+    }
+};
+
+// Function to evaluate count scenarios into rows in input order on the pool's workers, in precision Real
+// A caller that repeats scenarios over several calls passes its own cache, made with the cache and model
+// options of options; without one, options.cache only sets up a cache for this call
+template <typename Real>
+inline void evaluateScenariosWith(const Scenario *scenarios, size_t count, ResultRow *rows,
+                                  const EvaluationOptions &options, WorkStealingPool &pool,
+                                  EffectsCache<Real> *cache = nullptr)
+{
+    std::unique_ptr<EffectsCache<Real>> callCache;
+    if (!cache && options.cache.capacity > 0)
+    {
+        callCache.reset(new EffectsCache<Real>(options.cache, options.model));
+        cache = callCache.get();
+    }
+
+    const size_t GRAIN = 256; // Scenarios per scheduled chunk, one regime grouping slice
+    pool.parallelFor(count, GRAIN, [&](size_t begin, size_t end, unsigned)
+                     { computeResultRows(scenarios + begin, end - begin, rows + begin, options.model, cache); });
+}
+
+// Function to evaluate count scenarios into caller-provided rows in the selected precision, for library use
+// The result cache of options.cache lasts for this call; see evaluateScenariosWith() for one across calls
+inline void evaluateScenarios(const Scenario *scenarios, size_t count, ResultRow *rows,
+                              const EvaluationOptions &options, WorkStealingPool &pool)
+{
+    switch (options.precision)
+    {
+    case Precision::Float:
+        evaluateScenariosWith<float>(scenarios, count, rows, options, pool);
+        break;
+    case Precision::Double:
+        evaluateScenariosWith<double>(scenarios, count, rows, options, pool);
+        break;
+    case Precision::LongDouble:
+        evaluateScenariosWith<long double>(scenarios, count, rows, options, pool);
+        break;
+    }
+}
+
+/*******************************************************************************
+ * Sensitivity analysis
+ *
+ * Forward-mode automatic differentiation of the blast, thermal and fallout
+ * kernels. Dual<Real, N> carries a value and its gradient against N inputs;
+ * the kernels are templates on their number type, so instantiated with Dual
+ * one evaluation returns every output with its partial derivatives, instead of
+ * 2N + 1 evaluations of finite differences and without their step size error.
+ * The values are bit-identical to the plain kernels, since Dual computes them
+ * with the same operations.
+ *
+ * The inputs are those of a SensitivityQuery plus the activity fraction of the
+ * fallout model, which is differentiated through makeFalloutPrecompute()'s
+ * activityShift at a shift of 0. The atmosphere conditions are independent
+ * inputs, so the height derivative does not include their dependence on the
+ * burst height under AtmosphereModel::Standard. The kernels branch on the
+ * burst regime and take maxima; derivatives are those of the branch the
+ * scenario takes. Only ExactYieldScaling applies, the tables have no
+ * derivatives.
+ *
+ * The gradient is a fixed-size array updated component by component, which
+ * the compiler turns into vector arithmetic; calculateSensitivities() runs a
+ * span of queries on the pool's workers.
+ ******************************************************************************/
+
+// Number with its gradient against N independent inputs, for forward-mode differentiation
+template <typename Real, size_t N>
+struct Dual
+{
+    Real value;
+    std::array<Real, N> gradient; // Partial derivatives of value against the inputs
+
+    // Constant, with a zero gradient; implicit, so the kernels' Real(literal) and mixed arithmetic work
+    Dual(Real constant = Real(0)) : value(constant), gradient{} {}
+
+    // Function to make the independent input index with the given value
+    static Dual variable(Real value, size_t index)
+    {
+        Dual input(value);
+        input.gradient[index] = Real(1);
+        return input;
+    }
+
+    // Function to apply the chain rule: a result of x with the given value and derivative against x
+    static Dual chain(const Dual &x, Real value, Real derivative)
+    {
+        Dual result(value);
+        for (size_t i = 0; i < N; i++)
+            result.gradient[i] = derivative * x.gradient[i];
+        return result;
+    }
+
+    friend Dual operator-(const Dual &x)
+    {
+        return chain(x, -x.value, Real(-1));
+    }
+    friend Dual operator+(const Dual &a, const Dual &b)
+    {
+        Dual result(a.value + b.value);
+        for (size_t i = 0; i < N; i++)
+            result.gradient[i] = a.gradient[i] + b.gradient[i];
+        return result;
+    }
+    friend Dual operator-(const Dual &a, const Dual &b)
+    {
+        Dual result(a.value - b.value);
+        for (size_t i = 0; i < N; i++)
+            result.gradient[i] = a.gradient[i] - b.gradient[i];
+        return result;
+    }
+    friend Dual operator*(const Dual &a, const Dual &b)
+    {
+        Dual result(a.value * b.value);
+        for (size_t i = 0; i < N; i++)
+            result.gradient[i] = a.gradient[i] * b.value + a.value * b.gradient[i];
+        return result;
+    }
+    friend Dual operator/(const Dual &a, const Dual &b)
+    {
+        Dual result(a.value / b.value);
+        Real inverse = Real(1) / b.value;
+        for (size_t i = 0; i < N; i++)
+            result.gradient[i] = (a.gradient[i] - result.value * b.gradient[i]) * inverse;
+        return result;
+    }
+    Dual &operator+=(const Dual &other) { return *this = *this + other; }
+    Dual &operator-=(const Dual &other) { return *this = *this - other; }
+    Dual &operator*=(const Dual &other) { return *this = *this * other; }
+    Dual &operator/=(const Dual &other) { return *this = *this / other; }
+
+    // Comparisons, and with them the branches of the kernels, go by the value
+    friend bool operator<(const Dual &a, const Dual &b) { return a.value < b.value; }
+    friend bool operator>(const Dual &a, const Dual &b) { return a.value > b.value; }
+    friend bool operator<=(const Dual &a, const Dual &b) { return a.value <= b.value; }
+    friend bool operator>=(const Dual &a, const Dual &b) { return a.value >= b.value; }
+    friend bool operator==(const Dual &a, const Dual &b) { return a.value == b.value; }
+    friend bool operator!=(const Dual &a, const Dual &b) { return a.value != b.value; }
+
+    // Elementary functions, found by argument-dependent lookup from the kernels' using std::exp etc.
+    friend Dual exp(const Dual &x)
+    {
+        using std::exp;
+        Real e = exp(x.value);
+        return chain(x, e, e);
+    }
+    friend Dual sqrt(const Dual &x)
+    {
+        using std::sqrt;
+        Real root = sqrt(x.value);
+        return chain(x, root, Real(0.5) / root);
+    }
+    friend Dual log(const Dual &x)
+    {
+        using std::log;
+        return chain(x, log(x.value), Real(1) / x.value);
+    }
+    friend Dual log10(const Dual &x)
+    {
+        using std::log10;
+        return chain(x, log10(x.value), Real(1) / (x.value * Real(M_LN10)));
+    }
+    // x^y for x > 0; the yield powers have constant exponents, which skip the logarithm
+    friend Dual pow(const Dual &x, const Dual &y)
+    {
+        using std::log;
+        using std::pow;
+        Dual result(pow(x.value, y.value));
+        Real base = y.value * result.value / x.value;
+        bool constantExponent = true;
+        for (size_t i = 0; i < N; i++)
+            constantExponent = constantExponent && y.gradient[i] == Real(0);
+        Real exponent = constantExponent || !(x.value > 0) ? Real(0) : result.value * log(x.value);
+        for (size_t i = 0; i < N; i++)
+            result.gradient[i] = base * x.gradient[i] + exponent * y.gradient[i];
+        return result;
+    }
+};
+
+// Independent inputs of the sensitivity analysis, the gradient indices of its outputs
+enum class SensitivityInput
+{
+    Yield,           // MT
+    Height,          // Height of burst (m)
+    Distance,        // Ground range of the blast and thermal outputs (m)
+    WindSpeed,       // km/h
+    AmbientPressure, // Pa
+    Attenuation,     // Thermal extinction (1/km)
+    ScaleHeight,     // Of the burst height factor (m)
+    ActivityFraction // Of the fallout model, 0.6 + 0.2 log10(yield) at the query
+};
+
+constexpr size_t SENSITIVITY_INPUTS = 8;
+
+// Column suffixes of the inputs, in gradient order
+constexpr std::array<const char *, SENSITIVITY_INPUTS> SENSITIVITY_INPUT_NAMES = {
+    "yield_mt", "height_m", "distance_m", "wind_kmh", "pressure_pa", "attenuation_per_km", "scale_height_m",
+    "activity_fraction"};
+
+// Scenario and ground range of one sensitivity evaluation
+struct SensitivityQuery
+{
+    double yield;                    // MT
+    double height;                   // Height of burst (m)
+    bool isAirburst;                 // Air burst vs surface burst
+    double windSpeed;                // km/h
+    double distance;                 // Ground range of the blast and thermal outputs (m)
+    AtmosphereConditions atmosphere; // Ambient pressure, thermal extinction and scale height
+};
+
+// Outputs of a query with their gradients against every SensitivityInput
+template <typename Real>
+struct SensitivityResultT
+{
+    typedef Dual<Real, SENSITIVITY_INPUTS> Number;
+
+    Number overpressure;         // Peak overpressure at the distance (Pa)
+    Number thermalFluence;       // Thermal fluence at the distance (J/m²)
+    FalloutDataT<Number> fallout; // Fallout pattern
+};
+
+using SensitivityResult = SensitivityResultT<DefaultReal>;
+
+// Function to evaluate the blast, thermal and fallout kernels of a query with their gradients in one pass
+template <typename Real = DefaultReal>
+inline SensitivityResultT<Real> calculateSensitivity(const SensitivityQuery &query)
+{
+    typedef typename SensitivityResultT<Real>::Number Number;
+    auto input = [](double value, SensitivityInput index)
+    { return Number::variable(Real(value), static_cast<size_t>(index)); };
+
+    const Number yield = input(query.yield, SensitivityInput::Yield);
+    const Number height = input(query.height, SensitivityInput::Height);
+    const Number distance = input(query.distance, SensitivityInput::Distance);
+    const Number windSpeed = input(query.windSpeed, SensitivityInput::WindSpeed);
+    const Number pressure = input(query.atmosphere.pressure, SensitivityInput::AmbientPressure);
+    const Number attenuation = input(query.atmosphere.attenuation, SensitivityInput::Attenuation);
+    const Number scaleHeight = input(query.atmosphere.scaleHeight, SensitivityInput::ScaleHeight);
+    const Number activityShift = input(0, SensitivityInput::ActivityFraction);
+
+    SensitivityResultT<Real> result;
+    withBurstRegime(burstRegime(Real(query.height), query.isAirburst, Real(query.windSpeed)), [&](auto regime)
+                    {
+        result.overpressure = calculateBlastOverpressure<Number>(distance, yield, height, pressure, regime);
+        result.thermalFluence = calculateThermalRadiation(distance, yield, height, attenuation, scaleHeight, regime);
+        result.fallout = calculateFallout<Number>(makeFalloutPrecompute<Number>(yield, height, regime, activityShift),
+                                                  windSpeed, regime); });
+    return result;
+}
+
+// Function to evaluate count queries into results in input order on the pool's workers
+template <typename Real = DefaultReal>
+inline void calculateSensitivities(const SensitivityQuery *queries, size_t count, SensitivityResultT<Real> *results,
+                                   WorkStealingPool &pool)
+{
+    const size_t GRAIN = 256; // Queries per scheduled chunk
+    pool.parallelFor(count, GRAIN, [&](size_t begin, size_t end, unsigned)
+                     {
+        for (size_t i = begin; i < end; i++)
+            results[i] = calculateSensitivity<Real>(queries[i]); });
+}
+
+/*******************************************************************************
+ * Result writers
+ *
+ * A ResultWriter receives result rows in output order. The text writers (CSV
+ * and JSON lines) format a block of rows into fixed-size slots, on the pool's
+ * workers when one is given, and write them in order. ColumnarResultWriter
+ * writes the binary columnar format:
+ *
+ *   header      ColumnarHeader, then one ColumnarColumn per RESULT_COLUMNS entry
+ *   cities      NUL-terminated city names, indexed by the City column
+ *   row groups  from dataOffset; every group holds rowGroupRows rows (the last
+ *               one the remainder) as one chunk per column in schema order,
+ *               each chunk starting on a 64-byte boundary
+ *
+ * Offsets and values are in host byte order. The row count is patched into the
+ * header after every complete row group and when the writer is closed, so the
+ * output must be a seekable file. A file cut short holds its complete groups:
+ * a writer constructed from a ColumnarCheckpoint continues such a file after
+ * them, and the job key in the header tells which sweep shard it belongs to.
+ ******************************************************************************/
+
+// Output format of the batch and sweep modes
+enum class OutputFormat
+{
+    Csv,
+    JsonLines,
+    Columnar
+};
+
+// Destination of results; rows arrive in output order
+class ResultWriter
+{
+public:
+    virtual ~ResultWriter() {}
+
+    // Function to write count rows, formatting on the pool's workers where the format allows
+    virtual void write(const ResultRow *rows, size_t count, WorkStealingPool *pool = nullptr) = 0;
+
+    // Function to finish the output, returns false if anything could not be written
+    virtual bool close() = 0;
+};
+
+// Writer of one formatted text line per row
+class TextResultWriter : public ResultWriter
+{
+private:
+    typedef size_t (*Formatter)(char *record, size_t size, const ResultRow &row);
+
+    std::ostream &out;
+    Formatter formatter;
+    size_t slotSize;
+    std::vector<char> slots;
+    std::vector<size_t> lengths;
+
+public:
+    TextResultWriter(std::ostream &out, Formatter formatter, size_t slotSize, const char *header)
+        : out(out), formatter(formatter), slotSize(slotSize)
+    {
+        if (header)
+            out << header;
+    }
+
+    void write(const ResultRow *rows, size_t count, WorkStealingPool *pool = nullptr) override
+    {
+        NUCCALC_STAGE(Output);
+
+        if (count == 1)
+        {
+            char record[RESULT_JSON_SIZE];
+            out.write(record, formatter(record, std::min(slotSize, sizeof(record)), rows[0]));
+            return;
+        }
+
+        if (slots.size() < count * slotSize)
+        {
+            slots.resize(count * slotSize);
+            lengths.resize(count);
+        }
+        auto format = [&](size_t begin, size_t end, unsigned)
+        {
+            for (size_t i = begin; i < end; i++)
+            {
+                lengths[i] = formatter(&slots[i * slotSize], slotSize, rows[i]);
+            }
+        };
+        const size_t GRAIN = 256; // Rows per scheduled chunk
+        if (pool && count > GRAIN)
+            pool->parallelFor(count, GRAIN, format);
+        else
+            format(0, count, 0);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            out.write(&slots[i * slotSize], lengths[i]);
+        }
+    }
+
+    bool close() override
+    {
+        out.flush();
+        return static_cast<bool>(out);
+    }
+};
+
+// CSV writer (RESULT_RECORD_HEADER columns)
+class CsvResultWriter : public TextResultWriter
+{
+public:
+    explicit CsvResultWriter(std::ostream &out)
+        : TextResultWriter(out, formatResultRecord, RESULT_RECORD_SIZE, RESULT_RECORD_HEADER)
+    {
+    }
+};
+
+// JSON-lines writer (one object per row with every RESULT_COLUMNS field)
+class JsonLinesResultWriter : public TextResultWriter
+{
+public:
+    explicit JsonLinesResultWriter(std::ostream &out)
+        : TextResultWriter(out, formatResultJson, RESULT_JSON_SIZE, nullptr)
+    {
+    }
+};
+
+// File header of the columnar format
+struct ColumnarHeader
+{
+    char magic[8];         // "NUCCOLS\0"
+    uint32_t version;      // COLUMNAR_VERSION
+    uint32_t columnCount;  // ColumnarColumn entries following the header
+    uint64_t rowCount;     // Rows in the file, written after every row group and when the writer is closed
+    uint64_t rowGroupRows; // Rows of every row group but the last
+    uint64_t citiesOffset; // City name table
+    uint64_t citiesSize;   // Bytes of the city name table
+    uint64_t dataOffset;   // First row group, 64-byte aligned
+    uint64_t jobKey;       // Sweep shard of a resumable file (sweepJobKey), 0 otherwise
+};
+
+// Schema entry of the columnar format
+struct ColumnarColumn
+{
+    char name[48];    // NUL-terminated column name
+    uint32_t type;    // ColumnType
+    uint32_t width;   // Bytes per value
+    uint64_t reserved;
+};
+
+static_assert(sizeof(ColumnarHeader) == 64 && sizeof(ColumnarColumn) == 64, "columnar header layout");
+
+constexpr uint32_t COLUMNAR_VERSION = 1;
+constexpr size_t COLUMNAR_ALIGNMENT = 64;     // Alignment of every column chunk
+constexpr size_t COLUMNAR_GROUP_ROWS = 65536; // Rows per row group
+
+// Function to round a file offset up to the column chunk alignment
+constexpr uint64_t alignColumnar(uint64_t offset)
+{
+    return (offset + COLUMNAR_ALIGNMENT - 1) / COLUMNAR_ALIGNMENT * COLUMNAR_ALIGNMENT;
+}
+
+// Function to calculate the bytes of a row group of the columnar format, complete by default
+inline uint64_t columnarGroupBytes(uint64_t rows = COLUMNAR_GROUP_ROWS)
+{
+    uint64_t bytes = 0;
+    for (const ResultColumn &column : RESULT_COLUMNS)
+    {
+        bytes += alignColumnar(rows * columnWidth(column.type));
+    }
+    return bytes;
+}
+
+// Function to build the columnar header of the current schema and catalog, with no rows
+inline ColumnarHeader makeColumnarHeader(uint64_t jobKey)
+{
+    // City name table right after the schema, data on the next aligned offset
+    uint64_t citiesOffset = sizeof(ColumnarHeader) + RESULT_COLUMNS.size() * sizeof(ColumnarColumn);
+    uint64_t citiesSize = 0;
+    for (const CityData &city : catalog().cities())
+    {
+        citiesSize += city.name.size() + 1;
+    }
+
+    ColumnarHeader header = {};
+    memcpy(header.magic, "NUCCOLS", 8);
+    header.version = COLUMNAR_VERSION;
+    header.columnCount = static_cast<uint32_t>(RESULT_COLUMNS.size());
+    header.rowGroupRows = COLUMNAR_GROUP_ROWS;
+    header.citiesOffset = citiesOffset;
+    header.citiesSize = citiesSize;
+    header.dataOffset = alignColumnar(citiesOffset + citiesSize);
+    header.jobKey = jobKey;
+    return header;
+}
+
+// Complete part of an interrupted columnar file
+struct ColumnarCheckpoint
+{
+    uint64_t rowCount = 0; // Rows of the complete row groups
+    uint64_t size = 0;     // Bytes up to the end of the last complete row group, 0 if there is no file
+};
+
+// Function to read the checkpoint of the columnar file at path for the job jobKey of totalRows rows
+// A missing file is an empty checkpoint. Anything after the last complete row group is cut off the file.
+// Returns false with an error if the file is not an interruption or the completion of that job
+inline bool readColumnarCheckpoint(const char *path, uint64_t jobKey, uint64_t totalRows,
+                                   ColumnarCheckpoint &checkpoint, std::string &error)
+{
+    checkpoint = ColumnarCheckpoint();
+    std::ifstream in(path, std::ios::binary);
+    if (!in || in.peek() == std::ifstream::traits_type::eof())
+        return true; // Nothing written yet
+
+    ColumnarHeader header = {};
+    ColumnarHeader expected = makeColumnarHeader(jobKey);
+    in.read(reinterpret_cast<char *>(&header), sizeof(header));
+    expected.rowCount = header.rowCount;
+    if (!in || memcmp(&header, &expected, sizeof(header)) != 0)
+    {
+        error = std::string(path) + ": not a binary output of this sweep shard";
+        return false;
+    }
+    if (header.rowCount > totalRows || (header.rowCount < totalRows && header.rowCount % COLUMNAR_GROUP_ROWS != 0))
+    {
+        error = std::string(path) + ": row count does not match this sweep shard";
+        return false;
+    }
+
+    uint64_t completeSize = header.dataOffset + header.rowCount / COLUMNAR_GROUP_ROWS * columnarGroupBytes();
+    uint64_t partialRows = header.rowCount % COLUMNAR_GROUP_ROWS; // Rows of a final partial group
+    in.seekg(0, std::ios::end);
+    if (static_cast<uint64_t>(in.tellg()) < completeSize + (partialRows ? columnarGroupBytes(partialRows) : 0))
+    {
+        error = std::string(path) + ": truncated before its last row group";
+        return false;
+    }
+    in.close();
+    checkpoint.rowCount = header.rowCount;
+    if (partialRows)
+        return true; // Closed after the last group, nothing to continue
+    checkpoint.size = completeSize;
+
+    std::error_code failure;
+    std::filesystem::resize_file(path, checkpoint.size, failure);
+    if (failure)
+    {
+        error = std::string(path) + ": " + failure.message();
+        return false;
+    }
+    return true;
+}
+
+// Writer of the binary columnar format; rows are transposed into per-column buffers of one row group
+class ColumnarResultWriter : public ResultWriter
+{
+private:
+    std::ostream &out;
+    std::vector<std::vector<char>> columns; // Pending row group, one buffer per column
+    size_t pending = 0;                     // Rows in the pending row group
+    uint64_t rowCount = 0;
+    uint64_t written = 0; // Bytes written so far
+
+    void writeBytes(const void *data, size_t size)
+    {
+        out.write(static_cast<const char *>(data), size);
+        written += size;
+    }
+
+    void pad()
+    {
+        static const char ZEROS[COLUMNAR_ALIGNMENT] = {};
+        writeBytes(ZEROS, alignColumnar(written) - written);
+    }
+
+    // Function to write the pending rows as one row group
+    void flushGroup()
+    {
+        for (size_t c = 0; c < columns.size(); c++)
+        {
+            writeBytes(columns[c].data(), pending * columnWidth(RESULT_COLUMNS[c].type));
+            pad();
+        }
+        rowCount += pending;
+        pending = 0;
+    }
+
+    // Function to patch the row count into the header and return to the end
+    void writeRowCount()
+    {
+        out.seekp(offsetof(ColumnarHeader, rowCount));
+        out.write(reinterpret_cast<const char *>(&rowCount), sizeof(rowCount));
+        out.seekp(0, std::ios::end);
+        out.flush();
+    }
+
+    void allocateColumns()
+    {
+        for (size_t c = 0; c < columns.size(); c++)
+        {
+            columns[c].resize(COLUMNAR_GROUP_ROWS * columnWidth(RESULT_COLUMNS[c].type));
+        }
+    }
+
+public:
+    // Writer of a new file; jobKey marks the sweep shard of a resumable one
+    explicit ColumnarResultWriter(std::ostream &out, uint64_t jobKey = 0) : out(out), columns(RESULT_COLUMNS.size())
+    {
+        allocateColumns();
+
+        ColumnarHeader header = makeColumnarHeader(jobKey);
+        writeBytes(&header, sizeof(header));
+
+        for (const ResultColumn &column : RESULT_COLUMNS)
+        {
+            ColumnarColumn entry = {};
+            memcpy(entry.name, column.name.data(), std::min(column.name.size(), sizeof(entry.name) - 1));
+            entry.type = static_cast<uint32_t>(column.type);
+            entry.width = static_cast<uint32_t>(columnWidth(column.type));
+            writeBytes(&entry, sizeof(entry));
+        }
+        for (const CityData &city : catalog().cities())
+        {
+            writeBytes(city.name.data(), city.name.size());
+            writeBytes("", 1);
+        }
+        pad();
+        out.flush(); // An interrupted file always starts with its header
+    }
+
+    // Writer continuing a file after its checkpoint (readColumnarCheckpoint), with out at the end of the file
+    ColumnarResultWriter(std::ostream &out, const ColumnarCheckpoint &checkpoint)
+        : out(out), columns(RESULT_COLUMNS.size()), rowCount(checkpoint.rowCount), written(checkpoint.size)
+    {
+        allocateColumns();
+    }
+
+    void write(const ResultRow *rows, size_t count, WorkStealingPool * = nullptr) override
+    {
+        NUCCALC_STAGE(Output);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            const char *row = reinterpret_cast<const char *>(&rows[i]);
+            for (size_t c = 0; c < columns.size(); c++)
+            {
+                size_t width = columnWidth(RESULT_COLUMNS[c].type);
+                memcpy(&columns[c][pending * width], row + RESULT_COLUMNS[c].offset, width);
+            }
+            if (++pending == COLUMNAR_GROUP_ROWS)
+            {
+                flushGroup();
+                writeRowCount(); // Checkpoint of the complete groups
+            }
+        }
+    }
+
+    bool close() override
+    {
+        if (pending > 0)
+            flushGroup();
+        writeRowCount();
+        return static_cast<bool>(out);
+    }
+};
+
+// Function to create a writer of the given format on out
+inline std::unique_ptr<ResultWriter> makeResultWriter(OutputFormat format, std::ostream &out)
+{
+    switch (format)
+    {
+    case OutputFormat::JsonLines:
+        return std::unique_ptr<ResultWriter>(new JsonLinesResultWriter(out));
+    case OutputFormat::Columnar:
+        return std::unique_ptr<ResultWriter>(new ColumnarResultWriter(out));
+    case OutputFormat::Csv:
+    default:
+        return std::unique_ptr<ResultWriter>(new CsvResultWriter(out));
+    }
+}
+
+/*******************************************************************************
+ * Parameter sweeps
+ ******************************************************************************/
+
+// One swept parameter: steps values from min to max (inclusive)
+struct SweepRange
+{
+    double min;
+    double max;
+    size_t steps;
+    bool logarithmic; // Space values geometrically instead of linearly
+
+    // Function to get the value of step i
+    double at(size_t i) const
+    {
+        if (steps <= 1)
+            return min;
+        double t = static_cast<double>(i) / static_cast<double>(steps - 1);
+        if (logarithmic)
+            return min * pow(max / min, t);
+        return min + (max - min) * t;
+    }
+};
+
+// Cartesian sweep over cities x yields x heights x wind speeds
+struct SweepSpec
+{
+    SweepRange yield;  // Megatons
+    SweepRange height; // Meters, 0 is a surface burst, anything above an air burst
+    SweepRange wind;   // km/h
+};
+
+// Function to count the scenarios of a sweep over all cities
+inline size_t sweepSize(const SweepSpec &spec)
+{
+    return catalog().cities().size() * spec.yield.steps * spec.height.steps * spec.wind.steps;
+}
+
+// Part k of N of a sweep, for running one sweep on several nodes
+struct SweepShard
+{
+    size_t index = 0; // k, from 0
+    size_t count = 1; // N
+};
+
+// Function to get the scenario range [begin, end) of a shard in sweep order
+// The sweep is split into count contiguous ranges that differ by at most one scenario, so shards 0 to N-1
+// concatenate to the whole sweep on any node
+inline void shardRange(size_t total, const SweepShard &shard, size_t &begin, size_t &end)
+{
+    size_t base = total / shard.count;
+    size_t extra = total % shard.count; // The first shards take one more
+    begin = shard.index * base + std::min(shard.index, extra);
+    end = begin + base + (shard.index < extra ? 1 : 0);
+}
+
+// Function to derive the key of a sweep shard from everything that determines its rows
+// A binary output carries it so a resumed run only continues the results of the same job
+inline uint64_t sweepJobKey(const SweepSpec &spec, const SweepShard &shard, const EvaluationOptions &options)
+{
+    uint64_t hash = 0xCBF29CE484222325ull; // 64-bit FNV-1a over the fields
+    auto add = [&](const auto &value)
+    {
+        const unsigned char *bytes = reinterpret_cast<const unsigned char *>(&value);
+        for (size_t i = 0; i < sizeof(value); i++)
+        {
+            hash ^= bytes[i];
+            hash *= 0x100000001B3ull;
+        }
+    };
+    for (const SweepRange *range : {&spec.yield, &spec.height, &spec.wind})
+    {
+        add(range->min);
+        add(range->max);
+        add(range->steps);
+        add(range->logarithmic);
+    }
+    add(shard.index);
+    add(shard.count);
+    add(options.precision);
+    add(options.model.casualtyMethod);
+    add(options.model.casualtyRings);
+    add(options.model.casualtyTolerance);
+    add(options.model.yieldScaling);
+    add(options.model.population != nullptr);
+    if (const PopulationRaster *population = options.model.population) // Its grid and every cell
+    {
+        const RasterHeader &header = population->info();
+        add(header.width);
+        add(header.height);
+        add(header.cellSize);
+        add(header.west);
+        add(header.north);
+        const float *cells = population->values();
+        for (size_t i = 0; i < header.width * header.height; i++)
+            add(cells[i]);
+    }
+    if (options.cache.capacity > 0) // Quantized keys change the results, the capacity does not
+    {
+        add(options.cache.yieldQuantum);
+        add(options.cache.heightQuantum);
+        add(options.cache.windQuantum);
+    }
+    for (const CityData &city : catalog().cities())
+    {
+        add(hashCityName(city.name));
+        add(city.population);
+        add(city.area);
+        add(city.density);
+        add(city.radius);
+        add(city.suburban_density);
+    }
+    return hash | 1; // Never the 0 of files without a key
+}
+
+// Function to evaluate the scenarios [from, to) of a sweep over all cities and write them in sweep order
+// Scenarios are evaluated in blocks; each block is formatted by the workers and written by the caller
+template <typename Real>
+inline void runSweepWith(const SweepSpec &spec, const EvaluationOptions &options, WorkStealingPool &pool,
+                         ResultWriter &writer, size_t from, size_t to)
+{
+    std::unique_ptr<EffectsCache<Real>> cache;
+    if (options.cache.capacity > 0)
+        cache.reset(new EffectsCache<Real>(options.cache, options.model));
+
+    const size_t perYield = spec.height.steps * spec.wind.steps;
+    const size_t perCity = spec.yield.steps * perYield;
+    to = std::min(to, sweepSize(spec));
+    from = std::min(from, to);
+
+    const size_t BLOCK = 1 << 15; // Scenarios per output block
+    const size_t GRAIN = 64;      // Scenarios per scheduled chunk
+    std::vector<ResultRow> rows(std::min(BLOCK, to - from));
+
+    for (size_t first = from; first < to; first += BLOCK)
+    {
+        size_t count = std::min(BLOCK, to - first);
+        pool.parallelFor(count, GRAIN, [&](size_t begin, size_t end, unsigned)
+                         {
+            Scenario scenarios[GRAIN];
+            for (size_t i = begin; i < end; i += GRAIN)
+            {
+                size_t n = std::min(GRAIN, end - i);
+                for (size_t k = 0; k < n; k++)
+                {
+                    // Decompose the linear index: city, yield, height, wind (fastest)
+                    size_t index = first + i + k;
+                    size_t c = index / perCity;
+                    size_t rest = index % perCity;
+                    size_t y = rest / perYield;
+                    rest %= perYield;
+                    size_t h = rest / spec.wind.steps;
+                    size_t w = rest % spec.wind.steps;
+
+                    double height = spec.height.at(h);
+                    scenarios[k] = {spec.yield.at(y), height, height > 0, spec.wind.at(w), c};
+                }
+                computeResultRows(scenarios, n, rows.data() + i, options.model, cache.get());
+            } });
+
+        writer.write(rows.data(), count, &pool);
+    }
+
+    if (cache)
+        printCacheStatistics(std::cerr, cache->statistics());
+}
+
+// Function to run the scenarios [from, to) of a sweep (all by default) at the selected floating-point
+// precision into a result writer. The writer is left open for the caller to close
+inline void runSweep(const SweepSpec &spec, WorkStealingPool &pool, ResultWriter &writer,
+                     const EvaluationOptions &options = EvaluationOptions(), size_t from = 0,
+                     size_t to = SIZE_MAX)
+{
+    switch (options.precision)
+    {
+    case Precision::Float:
+        runSweepWith<float>(spec, options, pool, writer, from, to);
+        break;
+    case Precision::Double:
+        runSweepWith<double>(spec, options, pool, writer, from, to);
+        break;
+    case Precision::LongDouble:
+        runSweepWith<long double>(spec, options, pool, writer, from, to);
+        break;
+    }
+}
+
+// Function to run a sweep and write CSV records in sweep order
+inline void runSweep(const SweepSpec &spec, WorkStealingPool &pool, std::ostream &out,
+                     const EvaluationOptions &options = EvaluationOptions())
+{
+    CsvResultWriter writer(out);
+    runSweep(spec, pool, writer, options);
+    writer.close();
+}
+
+// Threshold ranges over yields x heights
+struct ThresholdSweepSpec
+{
+    SweepRange yield;                  // Megatons
+    SweepRange height;                 // Meters, 0 is a surface burst
+    std::vector<double> overpressures; // Blast thresholds (psi above the ambient term)
+    std::vector<double> fluences;      // Thermal thresholds (cal/cm²)
+    AtmosphereOptions atmosphere;
+};
+
+// Function to solve the threshold ranges of every scenario of a sweep and write them as CSV in sweep order
+// One row per yield and height (fastest) with a range column (m) per threshold
+inline void runThresholdSweep(const ThresholdSweepSpec &spec, WorkStealingPool &pool, std::ostream &out)
+{
+    const size_t total = spec.yield.steps * spec.height.steps;
+    const size_t blastColumns = spec.overpressures.size();
+    const size_t columns = blastColumns + spec.fluences.size();
+
+    out << "yield_mt,height_m";
+    char field[64];
+    for (double psi : spec.overpressures)
+        out.write(field, snprintf(field, sizeof(field), ",blast_%gpsi_m", psi));
+    for (double cal : spec.fluences)
+        out.write(field, snprintf(field, sizeof(field), ",thermal_%gcal_m", cal));
+    out << "\n";
+
+    const size_t BLOCK = 1 << 15; // Scenarios per output block
+    const size_t GRAIN = 256;     // Scenarios per scheduled chunk, solved as one batch per threshold
+    std::vector<double> ranges(BLOCK * columns); // Column c of scenario i at c * BLOCK + i
+    std::string text;
+
+    for (size_t first = 0; first < total; first += BLOCK)
+    {
+        size_t count = std::min(BLOCK, total - first);
+        pool.parallelFor(count, GRAIN, [&](size_t begin, size_t end, unsigned)
+                         {
+            size_t n = end - begin;
+            std::vector<BlastInvariants> blast(n);
+            std::vector<ThermalInvariants> thermal(n);
+            std::vector<double> thresholds(n);
+            for (size_t i = 0; i < n; i++)
+            {
+                size_t index = first + begin + i;
+                double yield = spec.yield.at(index / spec.height.steps);
+                double height = spec.height.at(index % spec.height.steps);
+                AtmosphereConditions atmosphere = makeAtmosphereConditions(spec.atmosphere, height);
+                blast[i] = makeBlastInvariants(yield, height, atmosphere);
+                thermal[i] = makeThermalInvariants(yield, height, atmosphere);
+            }
+            for (size_t c = 0; c < columns; c++)
+            {
+                double *solved = ranges.data() + c * BLOCK + begin;
+                if (c < blastColumns)
+                {
+                    std::fill(thresholds.begin(), thresholds.end(), spec.overpressures[c] * PhysicalConstants::PSI);
+                    solveOverpressureRanges(blast.data(), thresholds.data(), solved, n);
+                }
+                else
+                {
+                    std::fill(thresholds.begin(), thresholds.end(),
+                              spec.fluences[c - blastColumns] * PhysicalConstants::CALORIE_PER_CM2);
+                    solveThermalRanges(thermal.data(), thresholds.data(), solved, n);
+                }
+            } });
+
+        text.clear();
+        for (size_t i = 0; i < count; i++)
+        {
+            size_t index = first + i;
+            text.append(field, snprintf(field, sizeof(field), "%.6g,%.3f", spec.yield.at(index / spec.height.steps),
+                                        spec.height.at(index % spec.height.steps)));
+            for (size_t c = 0; c < columns; c++)
+                text.append(field, snprintf(field, sizeof(field), ",%.3f", ranges[c * BLOCK + i]));
+            text += '\n';
+        }
+        out.write(text.data(), static_cast<std::streamsize>(text.size()));
+    }
+}
+
+/*******************************************************************************
+ * Effect rasters
+ *
+ * rasterizeEffectField() evaluates overpressure or thermal fluence on a grid of
+ * square cells centered on ground zero. Row 0 is the northern edge and column 0
+ * the western edge; each cell is evaluated at its center. The fields only
+ * depend on the distance from ground zero, so the cell offsets in half-cell
+ * units |2c + 1 - width| and |2r + 1 - height| index one quadrant table that
+ * covers the whole grid. When width and height have the same parity the
+ * quadrant is symmetric about its diagonal and only one octant is evaluated.
+ *
+ * The octant rows are evaluated in parallel into the quadrant table, then the
+ * grid is filled in 64x64 cell tiles, gathering from the table. A tile reads a
+ * compact block of the table (or its transposed block across the diagonal), so
+ * the gather stays in cache even for 4096x4096 grids.
+ *
+ * FalloutRasterizer renders the wind-advected fallout deposition on the same
+ * grids. It keeps the yield and height dependent part of the fallout model
+ * between frames, so changing the wind only re-evaluates the wind dependent
+ * pattern and the cells it covers.
+ *
+ * writeRaster() stores a raster in the raster file layout described with
+ * PopulationRaster, without row prefix sums.
+ ******************************************************************************/
+
+// Grid of an effect raster, centered on ground zero
+struct RasterSpec
+{
+    size_t width;    // Cells from west to east
+    size_t height;   // Cells from north to south
+    double cellSize; // Cell edge length (m)
+};
+
+// Evaluated effect raster, values row by row from the north-west corner
+struct EffectRaster
+{
+    RasterSpec spec;
+    std::vector<float> values;
+
+    float at(size_t row, size_t column) const
+    {
+        return values[row * spec.width + column];
+    }
+};
+
+// Function to evaluate a raster field at count distances (m) in precision Real
+// The scenario invariants are hoisted as in makeBlastInvariants() and makeThermalInvariants()
+template <typename Real>
+class RasterFieldEvaluator
+{
+private:
+    RasterField field;
+    Real blastScale;       // Sachs scaling length (m)
+    Real blastAmplitude;   // Ambient pressure times Mach stem enhancement (Pa)
+    Real thermalAmplitude; // Thermal energy / 4pi including the burst height absorption (J)
+    Real extinction;       // Negative thermal extinction coefficient (1/km)
+    Real height;
+
+public:
+    RasterFieldEvaluator(RasterField field, double yield, double burstHeight, const AtmosphereConditions &atmosphere)
+        : field(field), extinction(-Real(atmosphere.attenuation)), height(Real(burstHeight))
+    {
+        using std::cbrt;
+        using std::exp;
+        using std::pow;
+
+        const Real Y = Real(yield);
+        const Real P0 = Real(atmosphere.pressure);
+        Real machStemFactor = Real(1.0);
+        if (height > 0)
+        {
+            machStemFactor = Real(1.0) + Real(0.1) * exp(-(height / cbrt(Y)) / Real(100.0));
+            if (height < Real(83) * pow(Y, Real(0.4)))
+                machStemFactor *= Real(1.25);
+        }
+        blastScale = cbrt(Y * Real(4.184e15) / P0);
+        blastAmplitude = P0 * machStemFactor;
+
+        thermalAmplitude = Real(10000.0) * Y * Real(4.184e15) * Real(0.35) / Real(4.0 * M_PI);
+        if (height > 0)
+            thermalAmplitude *= exp(-height / Real(atmosphere.scaleHeight));
+    }
+
+    void operator()(const Real *distances, Real *values, size_t count) const
+    {
+        using std::exp;
+        using std::sqrt;
+
+        for (size_t i = 0; i < count; i++)
+        {
+            Real d = distances[i];
+            if (field == RasterField::Overpressure)
+            {
+                Real x = blastScale / d;
+                values[i] = blastAmplitude * (Real(1.0) + x * (Real(0.076) + x * (Real(0.255) + x * Real(0.536))));
+            }
+            else
+            {
+                Real slant = sqrt(d * (d + Real(2) * height)) / (d + height); // 1 for surface bursts
+                values[i] = thermalAmplitude * exp(extinction * d / Real(1000.0)) * slant / (d * d);
+            }
+        }
+    }
+};
+
+// double uses the batched SIMD profile kernels
+template <>
+class RasterFieldEvaluator<double>
+{
+private:
+    RasterField field;
+    BlastInvariants blast;
+    ThermalInvariants thermal;
+
+public:
+    RasterFieldEvaluator(RasterField field, double yield, double height, const AtmosphereConditions &atmosphere)
+        : field(field), blast(makeBlastInvariants(yield, height, atmosphere)),
+          thermal(makeThermalInvariants(yield, height, atmosphere)) {}
+
+    void operator()(const double *distances, double *values, size_t count) const
+    {
+        if (field == RasterField::Overpressure)
+            calculateBlastOverpressureProfile(blast, distances, values, count);
+        else
+            calculateThermalRadiationProfile(thermal, distances, values, count);
+    }
+};
+
+// Function to rasterize an effect field of a burst, evaluated in precision Real on the pool's workers
+template <typename Real>
+inline EffectRaster rasterizeEffectFieldWith(RasterField field, double yield, double burstHeight,
+                                             const RasterSpec &spec, WorkStealingPool &pool,
+                                             const AtmosphereConditions &atmosphere)
+{
+    using std::sqrt;
+
+    EffectRaster raster = {spec, std::vector<float>(spec.width * spec.height)};
+    if (raster.values.empty())
+        return raster;
+
+    // Quadrant table: entry (j, i) holds the cell at half-cell offsets (u, v) = (2i + w, 2j + h),
+    // with w and h 1 for even and 0 for odd grid extents
+    const size_t columns = (spec.width + 1) / 2;
+    const size_t rows = (spec.height + 1) / 2;
+    const size_t uOffset = spec.width % 2 ? 0 : 1;
+    const size_t vOffset = spec.height % 2 ? 0 : 1;
+    const bool octant = uOffset == vOffset; // Same offsets in both directions: symmetric about the diagonal
+    std::vector<float> quadrant(rows * columns);
+
+    const RasterFieldEvaluator<Real> evaluate(field, yield, burstHeight, atmosphere);
+    const Real halfCell = Real(spec.cellSize / 2);
+    std::vector<Real> scratch(2 * columns * pool.size()); // Distances and values, per worker
+
+    pool.parallelFor(rows, 8, [&](size_t begin, size_t end, unsigned worker)
+                     {
+        Real *distances = &scratch[2 * columns * worker];
+        Real *values = distances + columns;
+        for (size_t j = begin; j < end; j++)
+        {
+            // Cells below the diagonal are gathered from their mirror image
+            size_t first = octant && j < columns ? j : 0;
+            Real v = Real(2 * j + vOffset);
+            for (size_t i = first; i < columns; i++)
+            {
+                Real u = Real(2 * i + uOffset);
+                distances[i - first] = halfCell * sqrt(u * u + v * v);
+            }
+            if (j == 0 && uOffset == 0 && vOffset == 0)
+                distances[0] = halfCell / Real(2); // Ground zero at a cell center: evaluate a quarter cell out
+            evaluate(distances, values, columns - first);
+            for (size_t i = first; i < columns; i++)
+            {
+                quadrant[j * columns + i] = static_cast<float>(values[i - first]);
+            }
+        } });
+
+    const size_t TILE = 64; // Cells per tile edge
+    const size_t tilesAcross = (spec.width + TILE - 1) / TILE;
+    const size_t tiles = tilesAcross * ((spec.height + TILE - 1) / TILE);
+    pool.parallelFor(tiles, 4, [&](size_t begin, size_t end, unsigned)
+                     {
+        for (size_t t = begin; t < end; t++)
+        {
+            size_t row0 = (t / tilesAcross) * TILE;
+            size_t column0 = (t % tilesAcross) * TILE;
+            size_t row1 = std::min(row0 + TILE, spec.height);
+            size_t column1 = std::min(column0 + TILE, spec.width);
+            for (size_t r = row0; r < row1; r++)
+            {
+                size_t j = (2 * r + 1 > spec.height ? 2 * r + 1 - spec.height : spec.height - 2 * r - 1) / 2;
+                float *out = &raster.values[r * spec.width];
+                for (size_t c = column0; c < column1; c++)
+                {
+                    size_t i = (2 * c + 1 > spec.width ? 2 * c + 1 - spec.width : spec.width - 2 * c - 1) / 2;
+                    out[c] = octant && i < j && j < columns ? quadrant[i * columns + j] : quadrant[j * columns + i];
+                }
+            }
+        } });
+    return raster;
+}
+
+// Function to rasterize an effect field in the selected precision
+inline EffectRaster rasterizeEffectField(RasterField field, double yield, double burstHeight, const RasterSpec &spec,
+                                         WorkStealingPool &pool, Precision precision = Precision::Double,
+                                         const AtmosphereConditions &atmosphere = AtmosphereConditions())
+{
+    switch (precision)
+    {
+    case Precision::Float:
+        return rasterizeEffectFieldWith<float>(field, yield, burstHeight, spec, pool, atmosphere);
+    case Precision::LongDouble:
+        return rasterizeEffectFieldWith<long double>(field, yield, burstHeight, spec, pool, atmosphere);
+    case Precision::Double:
+    default:
+        return rasterizeEffectFieldWith<double>(field, yield, burstHeight, spec, pool, atmosphere);
+    }
+}
+
+// Wind-advected fallout deposition raster over a fixed grid, re-rendered as the wind changes
+// The yield and height dependent part of the fallout model is computed once by the constructor and every
+// frame only re-evaluates the wind dependent pattern. Cells are relative deposition, 1 at the peak of a
+// surface burst: a ground zero deposit exp(-(r/R0)²) with R0 the base fallout radius, and a downwind plume
+// exp(-q) over an ellipse of length maxDownwindDistance and width maxWidth starting at ground zero, both
+// scaled by the local fallout fraction of the burst and cut off below DEPOSITION_CUTOFF.
+// Each frame only visits, per row, the span of cells above the cutoff and clears the previous frame's span.
+template <typename Real = DefaultReal, typename Scaling = ExactYieldScaling>
+class FalloutRasterizer
+{
+private:
+    static constexpr double DEPOSITION_CUTOFF = 1e-3; // Smallest relative deposition that is rasterized
+
+    FalloutPrecomputeT<Real> precompute;
+    Real depositionScale;       // Local fallout fraction times the burst type scale
+    EffectRaster output;        // Rendered raster
+    std::vector<Real> eastings; // Cell center easting per column (km)
+    std::vector<Real> northings; // Cell center northing per row (km)
+    std::vector<std::pair<size_t, size_t>> spans; // Columns written per row by the last frame
+    FalloutDataT<Real> pattern = {};              // Fallout pattern of the last frame
+
+public:
+    FalloutRasterizer(double yield, double height, bool isAirburst, const RasterSpec &spec)
+        : precompute(makeFalloutPrecompute<Real, Scaling>(Real(yield), Real(height), isAirburst)),
+          depositionScale(precompute.particleFraction * (height == 0 ? Real(1.0) : Real(0.3))),
+          output{spec, std::vector<float>(spec.width * spec.height)},
+          eastings(spec.width), northings(spec.height), spans(spec.height, {0, 0})
+    {
+        for (size_t c = 0; c < spec.width; c++)
+            eastings[c] = Real((double(c) + 0.5 - spec.width / 2.0) * spec.cellSize / 1000.0);
+        for (size_t r = 0; r < spec.height; r++)
+            northings[r] = Real((spec.height / 2.0 - double(r) - 0.5) * spec.cellSize / 1000.0);
+    }
+
+    // Function to render the deposition for a wind speed (km/h) and the direction the wind blows from
+    // (degrees clockwise from north), optionally with the rows spread over a pool
+    const EffectRaster &render(double windSpeed, double windDirection, WorkStealingPool *pool = nullptr)
+    {
+        using std::exp;
+        using std::sqrt;
+
+        pattern = calculateFallout<Real, Scaling>(precompute, Real(windSpeed));
+
+        // Deposition is exp(-Q q) with q = 1 on the edges of the pattern, so it falls to the cutoff there
+        const Real Q = Real(-std::log(DEPOSITION_CUTOFF));
+        const Real stemRadius = precompute.effectiveScaling; // Base fallout radius (km), the calm pattern's radius
+        const Real a = pattern.maxDownwindDistance / Real(2); // Plume semi-axes (km)
+        const Real b = pattern.maxWidth / Real(2);
+        const bool plume = !(Real(windSpeed) < Real(0.1)) && b > 0; // Same calm threshold as calculateFallout
+        const double bearing = (windDirection + 180.0) * M_PI / 180.0; // Downwind direction
+        const Real sine = Real(std::sin(bearing));
+        const Real cosine = Real(std::cos(bearing));
+
+        // Plume q(x) = A x² + B x + C along a row, from the downwind and crosswind coordinates; q = 1 on the
+        // ellipse from ground zero to maxDownwindDistance, so nothing is deposited upwind of ground zero
+        const Real A = sine * sine / (a * a) + cosine * cosine / (b * b);
+        const double columnScale = 1000.0 / output.spec.cellSize; // Cells per km
+        const double columnOrigin = output.spec.width / 2.0 - 0.5;  // Column of easting 0
+
+        auto renderRows = [&](size_t begin, size_t end, unsigned)
+        {
+            for (size_t r = begin; r < end; r++)
+            {
+                const Real y = northings[r];
+                float *row = &output.values[r * output.spec.width];
+
+                // Eastings (km) above the cutoff: the ground zero disk, extended by the plume ellipse
+                Real low = 0, high = -1;
+                Real stemSquare = stemRadius * stemRadius - y * y;
+                if (stemSquare >= 0)
+                {
+                    high = sqrt(stemSquare);
+                    low = -high;
+                }
+                Real B = 0, C = 0;
+                if (plume)
+                {
+                    Real along = y * cosine - a;
+                    B = Real(2) * (along * sine / (a * a) - y * sine * cosine / (b * b));
+                    C = along * along / (a * a) + y * y * sine * sine / (b * b);
+                    Real discriminant = B * B - Real(4) * A * (C - Real(1));
+                    if (discriminant >= 0)
+                    {
+                        Real root = sqrt(discriminant);
+                        Real west = (-B - root) / (Real(2) * A);
+                        Real east = (-B + root) / (Real(2) * A);
+                        low = high < low ? west : std::min(low, west);
+                        high = std::max(high, east);
+                    }
+                }
+
+                size_t first = 0, last = 0; // Columns [first, last) of the span
+                if (high >= low)
+                {
+                    double from = std::ceil(double(low) * columnScale + columnOrigin);
+                    double to = std::floor(double(high) * columnScale + columnOrigin) + 1;
+                    first = static_cast<size_t>(std::min(std::max(from, 0.0), double(output.spec.width)));
+                    last = static_cast<size_t>(std::min(std::max(to, double(first)), double(output.spec.width)));
+                }
+
+                std::fill(row + spans[r].first, row + spans[r].second, 0.0f);
+                for (size_t c = first; c < last; c++)
+                {
+                    const Real x = eastings[c];
+                    Real q = (x * x + y * y) / (stemRadius * stemRadius);
+                    if (plume)
+                        q = std::min(q, (A * x + B) * x + C);
+                    row[c] = q < Real(1) ? static_cast<float>(depositionScale * exp(-Q * q)) : 0.0f;
+                }
+                spans[r] = {first, last};
+            }
+        };
+
+        if (pool)
+            pool->parallelFor(output.spec.height, 16, renderRows);
+        else
+            renderRows(0, output.spec.height, 0);
+        return output;
+    }
+
+    // Function to get the raster of the last frame
+    const EffectRaster &raster() const
+    {
+        return output;
+    }
+
+    // Function to get the fallout pattern of the last frame
+    const FalloutDataT<Real> &fallout() const
+    {
+        return pattern;
+    }
+};
+
+// Function to write a raster file, returns false if the stream failed
+inline bool writeRaster(std::ostream &out, RasterField field, const EffectRaster &raster)
+{
+    RasterHeader header = {};
+    memcpy(header.magic, "NUCRAST", 8);
+    header.version = RASTER_VERSION;
+    header.field = static_cast<uint32_t>(field);
+    header.width = raster.spec.width;
+    header.height = raster.spec.height;
+    header.cellSize = raster.spec.cellSize;
+    header.dataOffset = sizeof(RasterHeader);
+    header.west = -0.5 * raster.spec.cellSize * double(raster.spec.width); // Centered on ground zero
+    header.north = 0.5 * raster.spec.cellSize * double(raster.spec.height);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(raster.values.data()), raster.values.size() * sizeof(float));
+    out.flush();
+    return static_cast<bool>(out);
+}
+
+#ifdef NUCCALC_OFFLOAD
+/*******************************************************************************
+ * Device offload
+ *
+ * Built with -DNUCCALC_OFFLOAD and an OpenMP offloading compiler (e.g. g++
+ * -fopenmp -foffload=nvptx-none, or clang++ -fopenmp with --offload-arch for
+ * an NVIDIA or AMD GPU), DeviceRaster renders the overpressure, thermal and
+ * fallout fields on an accelerator. Without an offload target OpenMP runs the
+ * same regions on the host, so the backend builds and can be checked anywhere;
+ * rasterizeEffectField() and FalloutRasterizer remain the reference.
+ *
+ * A DeviceRaster keeps its cells in device memory between stages. render()
+ * and renderFallout() overwrite them, populationAtLeast() reduces them against
+ * a DevicePopulation on the device and returns one number, and download()
+ * copies the grid to the host in one transfer when the caller asks for it.
+ * Every cell is evaluated independently at its center, in double, from the
+ * invariants the CPU kernels hoist (computed on the host); the device fields
+ * match the double CPU rasters up to the last bits of exp.
+ ******************************************************************************/
+
+// Grid of a device raster; west and north are the outer edges in cells from ground zero
+struct DeviceGrid
+{
+    size_t width;     // Cells from west to east
+    size_t height;    // Cells from north to south
+    double cellSize;  // Cell edge length (m)
+    double westCells; // Easting of the western edge over the cell size
+    double northCells; // Northing of the northern edge over the cell size
+
+    bool operator==(const DeviceGrid &other) const
+    {
+        return width == other.width && height == other.height && cellSize == other.cellSize &&
+               westCells == other.westCells && northCells == other.northCells;
+    }
+};
+
+// Function to get the device grid of a raster centered on ground zero
+inline DeviceGrid makeDeviceGrid(const RasterSpec &spec)
+{
+    return {spec.width, spec.height, spec.cellSize, -0.5 * double(spec.width), 0.5 * double(spec.height)};
+}
+
+// Buffer of count values of T in the memory of an OpenMP device
+template <typename T>
+class DeviceBuffer
+{
+private:
+    T *data_ = nullptr;
+    size_t count_ = 0;
+    int device_;
+
+public:
+    DeviceBuffer(size_t count, int device) : count_(count), device_(device)
+    {
+        if (count > 0)
+            data_ = static_cast<T *>(omp_target_alloc(count * sizeof(T), device));
+        if (count > 0 && !data_)
+            throw std::bad_alloc();
+    }
+
+    ~DeviceBuffer()
+    {
+        if (data_)
+            omp_target_free(data_, device_);
+    }
+
+    DeviceBuffer(const DeviceBuffer &) = delete;
+    DeviceBuffer &operator=(const DeviceBuffer &) = delete;
+
+    // Function to copy count values from the host, in one transfer
+    void upload(const T *values)
+    {
+        if (count_ > 0)
+            omp_target_memcpy(data_, values, count_ * sizeof(T), 0, 0, device_, omp_get_initial_device());
+    }
+
+    // Function to copy the values to the host, in one transfer
+    void download(T *values) const
+    {
+        if (count_ > 0)
+            omp_target_memcpy(values, data_, count_ * sizeof(T), 0, 0, omp_get_initial_device(), device_);
+    }
+
+    T *data() const { return data_; }
+    size_t size() const { return count_; }
+    int device() const { return device_; }
+};
+
+// Population raster uploaded to a device, people per cell on the raster's own grid
+class DevicePopulation
+{
+private:
+    DeviceGrid grid_;
+    DeviceBuffer<float> cells;
+
+public:
+    explicit DevicePopulation(const PopulationRaster &population, int device = omp_get_default_device())
+        : grid_{population.info().width, population.info().height, population.info().cellSize,
+                population.info().west / population.info().cellSize,
+                population.info().north / population.info().cellSize},
+          cells(grid_.width * grid_.height, device)
+    {
+        cells.upload(population.values());
+    }
+
+    const DeviceGrid &grid() const { return grid_; }
+    const float *data() const { return cells.data(); }
+};
+
+// Effect field on a grid in device memory
+class DeviceRaster
+{
+private:
+    DeviceGrid grid_;
+    DeviceBuffer<float> cells;
+
+public:
+    // Raster centered on ground zero, as rasterizeEffectField() renders it
+    explicit DeviceRaster(const RasterSpec &spec, int device = omp_get_default_device())
+        : grid_(makeDeviceGrid(spec)), cells(spec.width * spec.height, device)
+    {
+    }
+
+    // Raster on the grid of a population, for populationAtLeast()
+    explicit DeviceRaster(const DevicePopulation &population, int device = omp_get_default_device())
+        : grid_(population.grid()), cells(grid_.width * grid_.height, device)
+    {
+    }
+
+    // Function to render the overpressure (Pa) or thermal fluence (J/m²) of a burst into the cells
+    void render(RasterField field, double yield, double height,
+                const AtmosphereConditions &atmosphere = AtmosphereConditions())
+    {
+        const BlastInvariants blast = makeBlastInvariants(yield, height, atmosphere);
+        const ThermalInvariants thermal = makeThermalInvariants(yield, height, atmosphere);
+        const bool overpressure = field == RasterField::Overpressure;
+        const size_t width = grid_.width;
+        const size_t rows = grid_.height;
+        const double halfCell = grid_.cellSize / 2;
+        const double westCells = grid_.westCells;
+        const double northCells = grid_.northCells;
+        float *values = cells.data();
+
+#pragma omp target teams distribute parallel for collapse(2) is_device_ptr(values) device(cells.device())
+        for (size_t r = 0; r < rows; r++)
+        {
+            for (size_t c = 0; c < width; c++)
+            {
+                // Half-cell offsets from ground zero, exact for grids centered on it as on the CPU
+                double u = 2 * (double(c) + 0.5 + westCells);
+                double v = 2 * (northCells - double(r) - 0.5);
+                double d = halfCell * std::sqrt(u * u + v * v);
+                if (!(d > 0))
+                    d = halfCell / 2; // Ground zero at a cell center: evaluate a quarter cell out
+                double value;
+                if (overpressure)
+                {
+                    double x = blast.blastScale / d;
+                    value = blast.amplitude * (1.0 + x * (0.076 + x * (0.255 + x * 0.536)));
+                }
+                else
+                {
+                    double slant = std::sqrt(d * (d + 2.0 * thermal.height));
+                    value = thermal.amplitude * std::exp(thermal.attenuation * d) * slant / (d * d * (d + thermal.height));
+                }
+                values[r * width + c] = static_cast<float>(value);
+            }
+        }
+    }
+
+    // Function to render the relative fallout deposition of FalloutRasterizer for a wind speed (km/h) and the
+    // direction the wind blows from (degrees clockwise from north) into the cells
+    void renderFallout(double yield, double height, bool isAirburst, double windSpeed, double windDirection)
+    {
+        const FalloutPrecomputeT<double> precompute = makeFalloutPrecompute<double>(yield, height, isAirburst);
+        const FalloutDataT<double> pattern = calculateFallout<double>(precompute, windSpeed);
+        const double depositionScale = precompute.particleFraction * (height == 0 ? 1.0 : 0.3);
+        const double Q = -std::log(1e-3); // Exponent at the cutoff of FalloutRasterizer
+        const double stemRadius = precompute.effectiveScaling;
+        const double a = pattern.maxDownwindDistance / 2;
+        const double b = pattern.maxWidth / 2;
+        const bool plume = !(windSpeed < 0.1) && b > 0;
+        const double bearing = (windDirection + 180.0) * M_PI / 180.0;
+        const double sine = std::sin(bearing);
+        const double cosine = std::cos(bearing);
+        const double A = sine * sine / (a * a) + cosine * cosine / (b * b);
+        const size_t width = grid_.width;
+        const size_t rows = grid_.height;
+        const double kilometers = grid_.cellSize / 1000.0;
+        const double westCells = grid_.westCells;
+        const double northCells = grid_.northCells;
+        float *values = cells.data();
+
+#pragma omp target teams distribute parallel for collapse(2) is_device_ptr(values) device(cells.device())
+        for (size_t r = 0; r < rows; r++)
+        {
+            for (size_t c = 0; c < width; c++)
+            {
+                double x = (double(c) + 0.5 + westCells) * kilometers;
+                double y = (northCells - double(r) - 0.5) * kilometers;
+                double q = (x * x + y * y) / (stemRadius * stemRadius);
+                if (plume)
+                {
+                    double along = y * cosine - a;
+                    double B = 2 * (along * sine / (a * a) - y * sine * cosine / (b * b));
+                    double C = along * along / (a * a) + y * y * sine * sine / (b * b);
+                    q = std::min(q, (A * x + B) * x + C);
+                }
+                values[r * width + c] = q < 1 ? static_cast<float>(depositionScale * std::exp(-Q * q)) : 0.0f;
+            }
+        }
+    }
+
+    // Function to sum the people of the cells whose field is at least threshold, on the device
+    // The population must be on the grid of this raster; NaN otherwise
+    double populationAtLeast(const DevicePopulation &population, float threshold) const
+    {
+        if (!(population.grid() == grid_))
+            return NAN;
+        const size_t count = grid_.width * grid_.height;
+        const float *values = cells.data();
+        const float *people = population.data();
+        double sum = 0;
+
+#pragma omp target teams distribute parallel for reduction(+ : sum) map(tofrom : sum) is_device_ptr(values, people) \
+    device(cells.device())
+        for (size_t i = 0; i < count; i++)
+        {
+            if (values[i] >= threshold)
+                sum += people[i];
+        }
+        return sum;
+    }
+
+    // Function to copy the cells to a host raster, in one transfer; only for grids centered on ground zero
+    void download(EffectRaster &raster) const
+    {
+        raster.spec = {grid_.width, grid_.height, grid_.cellSize};
+        raster.values.resize(cells.size());
+        cells.download(raster.values.data());
+    }
+
+    const DeviceGrid &grid() const { return grid_; }
+};
+#endif
+
+/*******************************************************************************
+ * Ensembles
+ *
+ * An ensemble evaluates one scenario for N members whose uncertain inputs are
+ * drawn from distributions: the wind speed of calculateFallout() and the
+ * extinction coefficient and scale height of calculateThermalRadiation().
+ * Member i draws its inputs from Philox4x32-10 with counter i and the seed as
+ * key, so every member sees the same numbers on any thread count and in any
+ * order. Members are generated in blocks, one SoA lane per member, in a loop
+ * the compiler vectorizes.
+ *
+ * Every output goes into a LogHistogram per worker, merged at the end, so
+ * memory stays constant in N. The summary gives mean, standard deviation and
+ * quantiles; a quantile is off by at most one bin, 0.8% of its value.
+ ******************************************************************************/
+
+// Function to run Philox4x32-10 (Salmon et al., SC'11) on count counters {first + i, 0, 0, 0}
+// The four output words of counter i are written to out[0..3][i]
+inline void philox4x32Block(uint64_t first, size_t count, uint64_t seed, uint32_t *const out[4])
+{
+    const uint32_t M0 = 0xD2511F53u, M1 = 0xCD9E8D57u; // Round multipliers
+    const uint32_t W0 = 0x9E3779B9u, W1 = 0xBB67AE85u; // Key schedule increments
+    uint32_t *c0 = out[0], *c1 = out[1], *c2 = out[2], *c3 = out[3];
+    for (size_t i = 0; i < count; i++)
+    {
+        uint64_t counter = first + i;
+        c0[i] = static_cast<uint32_t>(counter);
+        c1[i] = static_cast<uint32_t>(counter >> 32);
+        c2[i] = 0;
+        c3[i] = 0;
+    }
+
+    uint32_t k0 = static_cast<uint32_t>(seed), k1 = static_cast<uint32_t>(seed >> 32);
+    for (int round = 0; round < 10; round++)
+    {
+        for (size_t i = 0; i < count; i++) // Independent lanes, 32x32->64 bit multiplies
+        {
+            uint64_t p0 = static_cast<uint64_t>(M0) * c0[i];
+            uint64_t p1 = static_cast<uint64_t>(M1) * c2[i];
+            uint32_t x0 = static_cast<uint32_t>(p1 >> 32) ^ c1[i] ^ k0;
+            uint32_t x2 = static_cast<uint32_t>(p0 >> 32) ^ c3[i] ^ k1;
+            c1[i] = static_cast<uint32_t>(p1);
+            c3[i] = static_cast<uint32_t>(p0);
+            c0[i] = x0;
+            c2[i] = x2;
+        }
+        k0 += W0;
+        k1 += W1;
+    }
+}
+
+// Function to map a random word to a uniform double in (0, 1)
+inline double uniformFromBits(uint32_t bits)
+{
+    return (static_cast<double>(bits) + 0.5) * (1.0 / 4294967296.0);
+}
+
+// Uncertain input of an ensemble, given by its mean and standard deviation
+struct EnsembleInput
+{
+    double mean;
+    double deviation; // 0 = fixed at the mean
+};
+
+// Function to draw a normal variate clamped at zero, for inputs where zero is physical (calm wind)
+inline double sampleClampedNormal(const EnsembleInput &input, double normal)
+{
+    return std::max(0.0, input.mean + input.deviation * normal);
+}
+
+// Function to draw a lognormal variate with the input's mean and standard deviation, for positive inputs
+inline double sampleLognormal(const EnsembleInput &input, double normal)
+{
+    if (input.deviation <= 0)
+        return input.mean;
+    double ratio = input.deviation / input.mean;
+    double sigma2 = log1p(ratio * ratio);
+    return input.mean * exp(sqrt(sigma2) * normal - 0.5 * sigma2);
+}
+
+// Mergeable histogram of non-negative values in logarithmic bins, for quantiles of streamed samples
+// Every power of two is split into SUBDIVISIONS linear bins, so a bin is at most 1/SUBDIVISIONS wide
+// relative to its values; values below 2^MIN_EXPONENT count as zero, values above the top go to the top bin
+class LogHistogram
+{
+public:
+    static constexpr int SUBDIVISIONS = 128;
+    static constexpr int MIN_EXPONENT = -64;
+    static constexpr int MAX_EXPONENT = 64;
+    static constexpr size_t BINS = static_cast<size_t>(MAX_EXPONENT - MIN_EXPONENT) * SUBDIVISIONS;
+
+private:
+    std::vector<uint64_t> bins;
+    uint64_t zeros = 0;
+    uint64_t total = 0;
+    double average = 0;  // Running mean
+    double squares = 0;  // Sum of squared deviations from the mean (Welford)
+    double minimum = HUGE_VAL;
+    double maximum = -HUGE_VAL;
+
+    // Function to get the lower edge of a bin
+    static double binLower(size_t bin)
+    {
+        int exponent = static_cast<int>(bin / SUBDIVISIONS) + MIN_EXPONENT + 1;
+        double mantissa = 0.5 + 0.5 * static_cast<double>(bin % SUBDIVISIONS) / SUBDIVISIONS;
+        return ldexp(mantissa, exponent);
+    }
+
+public:
+    LogHistogram() : bins(BINS, 0) {}
+
+    // Function to add one sample; negative values count as zero
+    void add(double value)
+    {
+        total++;
+        double delta = value - average;
+        average += delta / static_cast<double>(total);
+        squares += delta * (value - average);
+        minimum = std::min(minimum, value);
+        maximum = std::max(maximum, value);
+
+        int exponent;
+        double mantissa = frexp(value, &exponent); // value = mantissa * 2^exponent, mantissa in [0.5, 1)
+        if (!(value > 0) || exponent <= MIN_EXPONENT)
+        {
+            zeros++;
+            return;
+        }
+        size_t bin = static_cast<size_t>(exponent - 1 - MIN_EXPONENT) * SUBDIVISIONS +
+                     static_cast<size_t>((mantissa - 0.5) * 2 * SUBDIVISIONS);
+        bins[std::min(bin, BINS - 1)]++;
+    }
+
+    // Function to add the samples of another histogram (Chan et al. for the moments)
+    void merge(const LogHistogram &other)
+    {
+        if (other.total == 0)
+            return;
+        for (size_t b = 0; b < BINS; b++)
+        {
+            bins[b] += other.bins[b];
+        }
+        double combined = static_cast<double>(total + other.total);
+        double delta = other.average - average;
+        squares += other.squares + delta * delta * static_cast<double>(total) * static_cast<double>(other.total) / combined;
+        average += delta * static_cast<double>(other.total) / combined;
+        zeros += other.zeros;
+        total += other.total;
+        minimum = std::min(minimum, other.minimum);
+        maximum = std::max(maximum, other.maximum);
+    }
+
+    uint64_t count() const { return total; }
+    double mean() const { return average; }
+    double deviation() const { return total > 1 ? sqrt(squares / static_cast<double>(total - 1)) : 0.0; }
+
+    // Function to estimate the q-quantile, interpolating linearly within the bin that holds it
+    double quantile(double q) const
+    {
+        if (total == 0)
+            return 0;
+        double rank = std::min(std::max(q, 0.0), 1.0) * static_cast<double>(total);
+        double seen = static_cast<double>(zeros);
+        if (rank <= seen)
+            return std::max(0.0, minimum);
+        for (size_t b = 0; b < BINS; b++)
+        {
+            if (bins[b] == 0)
+                continue;
+            double next = seen + static_cast<double>(bins[b]);
+            if (rank <= next)
+            {
+                double lower = binLower(b);
+                double upper = b + 1 < BINS ? binLower(b + 1) : maximum;
+                double value = lower + (upper - lower) * (rank - seen) / static_cast<double>(bins[b]);
+                return std::min(std::max(value, minimum), maximum);
+            }
+            seen = next;
+        }
+        return maximum;
+    }
+};
+
+// Ensemble of one scenario with uncertain atmospheric inputs
+struct EnsembleSpec
+{
+    double yield = 1;           // Megatons
+    double height = 0;          // Meters, air burst above 0
+    size_t members = 100000;
+    uint64_t seed = 1;
+    EnsembleInput wind = {10, 3};            // km/h, normal clamped at 0
+    EnsembleInput attenuation = {0.17, 0.04}; // Thermal extinction per km, lognormal
+    EnsembleInput scaleHeight = {7400, 500};  // Thermal scale height (m), lognormal
+    std::vector<double> distances = {1000, 2000, 5000, 10000, 20000}; // Thermal fluence ranges (m)
+};
+
+// One summarized output of an ensemble
+struct EnsembleQuantity
+{
+    const char *name;
+    double distance; // Thermal fluence range (m), 0 for the other quantities
+    LogHistogram histogram;
+};
+
+// Output histograms of an ensemble: the three inputs, fallout distance, width and area, then the fluences
+inline std::vector<EnsembleQuantity> makeEnsembleQuantities(const EnsembleSpec &spec)
+{
+    std::vector<EnsembleQuantity> quantities;
+    for (const char *name : {"wind_kmh", "attenuation_per_km", "scale_height_m",
+                             "fallout_distance_km", "fallout_width_km", "fallout_area_km2"})
+    {
+        quantities.push_back({name, 0, LogHistogram()});
+    }
+    for (double distance : spec.distances)
+    {
+        quantities.push_back({"thermal_j_m2", distance, LogHistogram()});
+    }
+    return quantities;
+}
+
+// Function to evaluate an ensemble in parallel blocks of members at precision Real
+template <typename Real>
+inline std::vector<EnsembleQuantity> runEnsembleWith(const EnsembleSpec &spec, WorkStealingPool &pool)
+{
+    const size_t BLOCK = 256; // Members per RNG block
+    const bool isAirburst = spec.height > 0;
+    const FalloutPrecomputeT<Real> fallout = makeFalloutPrecompute<Real>(Real(spec.yield), Real(spec.height), isAirburst);
+
+    std::vector<std::vector<EnsembleQuantity>> perWorker(pool.size());
+    for (std::vector<EnsembleQuantity> &quantities : perWorker)
+    {
+        quantities = makeEnsembleQuantities(spec);
+    }
+
+    size_t blocks = (spec.members + BLOCK - 1) / BLOCK;
+    pool.parallelFor(blocks, 1, [&](size_t begin, size_t end, unsigned worker)
+                     {
+        std::vector<EnsembleQuantity> &quantities = perWorker[worker];
+        uint32_t words[4][BLOCK];
+        uint32_t *const lanes[4] = {words[0], words[1], words[2], words[3]};
+        for (size_t block = begin; block < end; block++)
+        {
+            size_t first = block * BLOCK;
+            size_t count = std::min(BLOCK, spec.members - first);
+            philox4x32Block(first, count, spec.seed, lanes);
+
+            for (size_t i = 0; i < count; i++)
+            {
+                // Two Box-Muller pairs from the four words of the member
+                double r0 = sqrt(-2.0 * log(uniformFromBits(words[0][i])));
+                double r1 = sqrt(-2.0 * log(uniformFromBits(words[2][i])));
+                double a0 = 2.0 * M_PI * uniformFromBits(words[1][i]);
+                double a1 = 2.0 * M_PI * uniformFromBits(words[3][i]);
+                double windSpeed = sampleClampedNormal(spec.wind, r0 * cos(a0));
+                double attenuation = sampleLognormal(spec.attenuation, r0 * sin(a0));
+                double scaleHeight = sampleLognormal(spec.scaleHeight, r1 * cos(a1));
+
+                FalloutDataT<Real> pattern = calculateFallout(fallout, Real(windSpeed));
+                quantities[0].histogram.add(windSpeed);
+                quantities[1].histogram.add(attenuation);
+                quantities[2].histogram.add(scaleHeight);
+                quantities[3].histogram.add(static_cast<double>(pattern.maxDownwindDistance));
+                quantities[4].histogram.add(static_cast<double>(pattern.maxWidth));
+                quantities[5].histogram.add(static_cast<double>(pattern.dangerousZoneArea));
+                for (size_t d = 0; d < spec.distances.size(); d++)
+                {
+                    Real fluence = calculateThermalRadiation(Real(spec.distances[d]), Real(spec.yield), Real(spec.height),
+                                                             Real(attenuation), Real(scaleHeight));
+                    quantities[6 + d].histogram.add(static_cast<double>(fluence));
+                }
+            }
+        } });
+
+    std::vector<EnsembleQuantity> merged = std::move(perWorker[0]);
+    for (size_t w = 1; w < perWorker.size(); w++)
+    {
+        for (size_t q = 0; q < merged.size(); q++)
+        {
+            merged[q].histogram.merge(perWorker[w][q].histogram);
+        }
+    }
+    return merged;
+}
+
+// Function to evaluate an ensemble at the selected precision
+inline std::vector<EnsembleQuantity> runEnsemble(const EnsembleSpec &spec, WorkStealingPool &pool,
+                                                 Precision precision = Precision::Double)
+{
+    switch (precision)
+    {
+    case Precision::Float:
+        return runEnsembleWith<float>(spec, pool);
+    case Precision::LongDouble:
+        return runEnsembleWith<long double>(spec, pool);
+    case Precision::Double:
+    default:
+        return runEnsembleWith<double>(spec, pool);
+    }
+}
+
+// Quantiles of the ensemble summary, matching ENSEMBLE_SUMMARY_HEADER
+constexpr std::array<double, 7> ENSEMBLE_QUANTILES = {0.01, 0.05, 0.25, 0.5, 0.75, 0.95, 0.99};
+
+constexpr const char *ENSEMBLE_SUMMARY_HEADER = "quantity,distance_m,members,mean,stddev,p01,p05,p25,p50,p75,p95,p99\n";
+
+// Function to write the summary of an ensemble as CSV, one line per quantity
+inline void writeEnsembleSummary(std::ostream &out, const std::vector<EnsembleQuantity> &quantities)
+{
+    out << ENSEMBLE_SUMMARY_HEADER;
+    char record[512];
+    for (const EnsembleQuantity &quantity : quantities)
+    {
+        const LogHistogram &histogram = quantity.histogram;
+        int length = snprintf(record, sizeof(record), "%s,%.6g,%llu,%.6g,%.6g", quantity.name, quantity.distance,
+                              static_cast<unsigned long long>(histogram.count()), histogram.mean(), histogram.deviation());
+        for (double q : ENSEMBLE_QUANTILES)
+        {
+            length += snprintf(record + length, sizeof(record) - length, ",%.6g", histogram.quantile(q));
+        }
+        record[length++] = '\n';
+        out.write(record, length);
+    }
+}
+
+/*******************************************************************************
+ * Streaming batch evaluation
+ *
+ * Scenario lines are read, evaluated and written in a pipeline: a reader thread
+ * parses lines into fixed-size chunks, worker threads evaluate chunks, and the
+ * calling thread writes finished chunks in input order. A fixed set of chunks
+ * circulates through bounded queues (free -> work -> done -> free), so memory
+ * stays flat regardless of input size and a slow writer throttles the reader.
+ ******************************************************************************/
+
+// Function to look up a batch city field, either a 1-based index or a city name of the catalog
+inline bool findCity(const char *field, size_t &index)
+{
+    const std::vector<CityData> &cities = catalog().cities();
+    char *end;
+    long number = strtol(field, &end, 10);
+    if (end != field && *end == '\0')
+    {
+        if (number < 1 || number > static_cast<long>(cities.size()))
+            return false;
+        index = static_cast<size_t>(number - 1);
+        return true;
+    }
+
+    index = catalog().findCity(field);
+    return index < cities.size();
+}
+
+// Function to parse one batch line: yield height burst wind city
+// Returns false if the line is malformed; blank lines and '#' comments are handled by the caller
+inline bool parseScenarioLine(char *line, Scenario &scenario)
+{
+    char *fields[5];
+    size_t count = 0;
+    char *p = line;
+
+    // Split the first four whitespace/comma separated fields, the rest is the city
+    while (count < 4)
+    {
+        while (*p == ' ' || *p == '\t' || *p == ',')
+            p++;
+        if (*p == '\0')
+            return false;
+        fields[count++] = p;
+        while (*p != '\0' && *p != ' ' && *p != '\t' && *p != ',')
+            p++;
+        if (*p != '\0')
+            *p++ = '\0';
+    }
+
+    while (*p == ' ' || *p == '\t' || *p == ',')
+        p++;
+    char *last = p + strlen(p);
+    while (last > p && (last[-1] == ' ' || last[-1] == '\t' || last[-1] == '\r'))
+        *--last = '\0';
+    if (*p == '\0')
+        return false;
+    fields[count] = p;
+
+    char *end;
+    scenario.yield = strtod(fields[0], &end);
+    if (*end != '\0' || !(scenario.yield > 0))
+        return false;
+
+    scenario.height = strtod(fields[1], &end);
+    if (*end != '\0' || scenario.height < 0)
+        return false;
+
+    const char *burst = fields[2];
+    if (!strcmp(burst, "air") || !strcmp(burst, "a") || !strcmp(burst, "1"))
+        scenario.isAirburst = true;
+    else if (!strcmp(burst, "surface") || !strcmp(burst, "ground") || !strcmp(burst, "s") ||
+             !strcmp(burst, "g") || !strcmp(burst, "0"))
+        scenario.isAirburst = false;
+    else
+        return false;
+
+    scenario.windSpeed = strtod(fields[3], &end);
+    if (*end != '\0' || scenario.windSpeed < 0)
+        return false;
+
+    return findCity(fields[4], scenario.cityIndex);
+}
+
+// Function to read the next scenario line, skipping blank lines and comments
+// lineNumber counts every line read; returns 0 at end of input, 1 for a scenario and -1 for a malformed line
+inline int readScenarioLine(std::istream &in, std::string &line, size_t &lineNumber, Scenario &scenario)
+{
+    while (std::getline(in, line))
+    {
+        lineNumber++;
+        size_t start = line.find_first_not_of(" \t\r");
+        if (start == std::string::npos || line[start] == '#')
+            continue; // Skip blank lines and comments
+        return parseScenarioLine(&line[start], scenario) ? 1 : -1;
+    }
+    return 0;
+}
+
+// Blocking FIFO with a fixed capacity; pop() drains the remaining items after close()
+template <typename T>
+class BoundedQueue
+{
+private:
+    std::mutex lock;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    std::deque<T> items;
+    size_t capacity;
+    bool closed = false;
+
+public:
+    explicit BoundedQueue(size_t capacity) : capacity(std::max<size_t>(1, capacity)) {}
+
+    // Function to append an item, blocking while the queue is full; false if the queue was closed
+    bool push(T item)
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        notFull.wait(guard, [&] { return closed || items.size() < capacity; });
+        if (closed)
+            return false;
+        items.push_back(std::move(item));
+        notEmpty.notify_one();
+        return true;
+    }
+
+    // Function to take the oldest item, blocking while the queue is empty; false once closed and drained
+    bool pop(T &item)
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        notEmpty.wait(guard, [&] { return closed || !items.empty(); });
+        if (items.empty())
+            return false;
+        item = std::move(items.front());
+        items.pop_front();
+        notFull.notify_one();
+        return true;
+    }
+
+    // Function to stop accepting items and wake every waiting thread
+    void close()
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        closed = true;
+        notEmpty.notify_all();
+        notFull.notify_all();
+    }
+};
+
+// Unit of work of the streaming pipeline
+struct ScenarioChunk
+{
+    static constexpr size_t CAPACITY = 256; // Scenarios per chunk
+
+    size_t sequence = 0;  // Position in the input, in chunks
+    size_t count = 0;     // Scenarios in use
+    size_t malformed = 0; // Malformed lines read into this chunk
+    Scenario scenarios[CAPACITY];
+    ResultRow rows[CAPACITY];
+    size_t malformedLines[CAPACITY]; // Reported by the writer, the only thread touching the streams
+};
+
+// Function to evaluate a scenario stream with a reader thread, workers compute threads and the calling
+// thread as the ordered writer. Returns the number of malformed lines, reported on std::cerr and skipped
+template <typename Real>
+inline size_t runBatchStreamWith(std::istream &in, ResultWriter &writer, const EvaluationOptions &options,
+                                 unsigned workers)
+{
+    std::unique_ptr<EffectsCache<Real>> cache;
+    if (options.cache.capacity > 0)
+        cache.reset(new EffectsCache<Real>(options.cache, options.model));
+
+    // Every chunk is always in exactly one queue or stage, which bounds memory and the reorder window
+    const size_t CHUNKS = 2 * static_cast<size_t>(workers) + 2;
+    std::vector<ScenarioChunk> chunks(CHUNKS);
+    BoundedQueue<ScenarioChunk *> freeChunks(CHUNKS);
+    BoundedQueue<ScenarioChunk *> work(CHUNKS);
+    BoundedQueue<ScenarioChunk *> done(CHUNKS);
+    for (ScenarioChunk &chunk : chunks)
+    {
+        freeChunks.push(&chunk);
+    }
+
+    // std::cin flushes std::cout before every read; the reader thread must not touch the writer's stream
+    std::ostream *tied = in.tie(nullptr);
+
+    size_t errors = 0;
+    std::thread reader([&]
+                       {
+        std::string line;
+        size_t lineNumber = 0;
+        size_t sequence = 0;
+        ScenarioChunk *chunk = nullptr;
+        Scenario scenario;
+        int status;
+        while ((status = readScenarioLine(in, line, lineNumber, scenario)) != 0)
+        {
+            if (!chunk)
+            {
+                freeChunks.pop(chunk); // Blocks while every chunk is in flight
+                chunk->sequence = sequence++;
+                chunk->count = 0;
+                chunk->malformed = 0;
+            }
+            if (status < 0)
+                chunk->malformedLines[chunk->malformed++] = lineNumber;
+            else
+                chunk->scenarios[chunk->count++] = scenario;
+            if (chunk->count == ScenarioChunk::CAPACITY || chunk->malformed == ScenarioChunk::CAPACITY)
+            {
+                work.push(chunk);
+                chunk = nullptr;
+            }
+        }
+        if (chunk)
+            work.push(chunk);
+        work.close(); });
+
+    std::atomic<unsigned> running{workers};
+    std::vector<std::thread> computers;
+    for (unsigned w = 0; w < workers; w++)
+    {
+        computers.emplace_back([&]
+                               {
+            ScenarioChunk *chunk;
+            while (work.pop(chunk))
+            {
+                computeResultRows(chunk->scenarios, chunk->count, chunk->rows, options.model, cache.get());
+                done.push(chunk);
+            }
+            if (--running == 0)
+                done.close(); });
+    }
+
+    // Ordered writer: chunks finish out of order, at most CHUNKS of them are pending
+    std::vector<ScenarioChunk *> pending(CHUNKS, nullptr);
+    size_t next = 0;
+    ScenarioChunk *chunk;
+    while (done.pop(chunk))
+    {
+        pending[chunk->sequence % CHUNKS] = chunk;
+        while (ScenarioChunk *ready = pending[next % CHUNKS])
+        {
+            if (ready->sequence != next)
+                break;
+            pending[next % CHUNKS] = nullptr;
+            for (size_t i = 0; i < ready->malformed; i++)
+            {
+                std::cerr << "batch: skipping malformed line " << ready->malformedLines[i] << "\n";
+            }
+            errors += ready->malformed;
+            writer.write(ready->rows, ready->count);
+            freeChunks.push(ready);
+            next++;
+        }
+    }
+
+    reader.join();
+    for (std::thread &computer : computers)
+    {
+        computer.join();
+    }
+    in.tie(tied);
+
+    if (cache)
+        printCacheStatistics(std::cerr, cache->statistics());
+    return errors;
+}
+
+// Function to evaluate a scenario stream at the selected precision (workers 0 = one per hardware thread)
+inline size_t runBatchStream(std::istream &in, ResultWriter &writer, const EvaluationOptions &options = EvaluationOptions(),
+                             unsigned workers = 0)
+{
+    if (workers == 0)
+        workers = std::max(1u, std::thread::hardware_concurrency());
+    switch (options.precision)
+    {
+    case Precision::Float:
+        return runBatchStreamWith<float>(in, writer, options, workers);
+    case Precision::LongDouble:
+        return runBatchStreamWith<long double>(in, writer, options, workers);
+    default:
+        return runBatchStreamWith<double>(in, writer, options, workers);
+    }
+}
+
+/*******************************************************************************
+ * Server mode
+ *
+ * ScenarioServer keeps the catalog, the result cache and the compute threads
+ * alive between requests. Clients connect over a Unix or TCP socket and send
+ * one request per line, either a JSON object or a batch scenario line:
+ *
+ *   {"id":7,"yield_mt":0.3,"height_m":500,"airburst":true,"wind_kmh":10,"city":"London"}
+ *   0.3 500 air 10 London
+ *
+ * In JSON, airburst defaults to height_m > 0, wind_kmh to 0, and city is a
+ * name or a 1-based index. Every request is answered with one JSON line: the
+ * jsonl result record with the request's "id" in front, or {"id":...,"error":
+ * "..."}. A request without an id gets its line number on the connection.
+ * Responses are sent as soon as they are ready, so they can arrive out of order.
+ *
+ * One I/O thread polls the sockets, splits and parses the lines, and queues the
+ * requests of each read together. Compute threads take up to maxBatch queued
+ * requests at a time, optionally waiting up to batchWindow for a fuller batch,
+ * and send each connection's responses of a batch with one write. Requests
+ * coalesce into batches while the compute threads are busy, so batching adds
+ * no latency at low load.
+ ******************************************************************************/
+
+#ifndef _WIN32
+
+struct ServerOptions
+{
+    unsigned threads = 0;                     // Compute threads, 0 = one per hardware thread
+    size_t maxBatch = 64;                     // Requests a compute thread takes at a time
+    std::chrono::microseconds batchWindow{0}; // Wait for a fuller batch, 0 = take what is queued
+};
+
+constexpr size_t SERVER_LINE_LIMIT = 4096; // Longest request line
+constexpr size_t SERVER_ID_LIMIT = 64;     // Longest request id, as JSON text
+
+// Write end of the pipe that wakes the server's I/O thread, for the signal handler
+inline std::atomic<int> serverSignalFd{-1};
+
+// Function to stop the server from a SIGINT/SIGTERM handler
+inline void stopServerOnSignal(int)
+{
+    int fd = serverSignalFd.load();
+    if (fd >= 0)
+    {
+        char stop = 's';
+        ssize_t written = write(fd, &stop, 1); // Async-signal-safe
+        (void)written;
+    }
+}
+
+// Client connection, shared by the I/O thread and the compute threads answering its requests
+struct ServerConnection
+{
+    int fd;
+    std::string input;                 // Bytes after the last complete line (I/O thread only)
+    size_t lineNumber = 0;             // Lines received (I/O thread only)
+    std::atomic<bool> readClosed{false}; // Peer finished sending, or the line limit was exceeded
+    std::atomic<size_t> inFlight{0};   // Requests queued or being computed
+    std::mutex lock;                   // Guards output and broken
+    std::string output;                // Responses the socket has not accepted yet
+    bool broken = false;               // Connection failed, responses are dropped
+
+    explicit ServerConnection(int fd) : fd(fd) {}
+    ~ServerConnection() { ::close(fd); }
+
+    // Function to send buffered responses without blocking, with lock held; true once everything is sent
+    bool flush()
+    {
+        size_t sent = 0;
+        while (!broken && sent < output.size())
+        {
+            ssize_t count = ::send(fd, output.data() + sent, output.size() - sent, 0);
+            if (count > 0)
+                sent += static_cast<size_t>(count);
+            else if (count < 0 && errno == EINTR)
+                continue;
+            else if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                break;
+            else
+                broken = true;
+        }
+        if (broken)
+            output.clear();
+        else
+            output.erase(0, sent);
+        return output.empty();
+    }
+};
+
+// One parsed request line
+struct ServerRequest
+{
+    std::shared_ptr<ServerConnection> connection;
+    Scenario scenario;
+    const char *error = nullptr; // Answered with this message instead of a result
+    size_t idLength = 0;
+    char id[SERVER_ID_LIMIT]; // JSON text of the id, echoed in the response
+    std::chrono::steady_clock::time_point arrival;
+};
+
+// Function to skip JSON whitespace
+inline const char *skipJsonSpace(const char *p)
+{
+    while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')
+        p++;
+    return p;
+}
+
+// Function to decode a JSON string, p just after the opening quote, into buffer as UTF-8
+// Returns the position after the closing quote, or nullptr if the string is malformed or too long
+inline const char *parseJsonString(const char *p, char *buffer, size_t size)
+{
+    size_t length = 0;
+    while (*p != '"')
+    {
+        if (static_cast<unsigned char>(*p) < 0x20 || length + 4 > size)
+            return nullptr; // Control character, end of line or too long
+        if (*p != '\\')
+        {
+            buffer[length++] = *p++;
+            continue;
+        }
+        p++;
+        char escape = *p++;
+        switch (escape)
+        {
+        case '"':
+        case '\\':
+        case '/':
+            buffer[length++] = escape;
+            break;
+        case 'b':
+            buffer[length++] = '\b';
+            break;
+        case 'f':
+            buffer[length++] = '\f';
+            break;
+        case 'n':
+            buffer[length++] = '\n';
+            break;
+        case 'r':
+            buffer[length++] = '\r';
+            break;
+        case 't':
+            buffer[length++] = '\t';
+            break;
+        case 'u':
+        {
+            unsigned code = 0;
+            for (int k = 0; k < 4; k++, p++)
+            {
+                char c = *p;
+                int digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+                if (digit < 0)
+                    return nullptr;
+                code = code * 16 + static_cast<unsigned>(digit);
+            }
+            if (code >= 0xD800 && code <= 0xDFFF)
+                return nullptr; // Surrogate pairs never occur in catalog names
+            if (code < 0x80)
+            {
+                buffer[length++] = static_cast<char>(code);
+            }
+            else if (code < 0x800)
+            {
+                buffer[length++] = static_cast<char>(0xC0 | (code >> 6));
+                buffer[length++] = static_cast<char>(0x80 | (code & 0x3F));
+            }
+            else
+            {
+                buffer[length++] = static_cast<char>(0xE0 | (code >> 12));
+                buffer[length++] = static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                buffer[length++] = static_cast<char>(0x80 | (code & 0x3F));
+            }
+            break;
+        }
+        default:
+            return nullptr;
+        }
+    }
+    buffer[length] = '\0';
+    return p + 1;
+}
+
+// Function to parse a JSON request object, p at the opening brace; returns an error message or nullptr
+inline const char *parseScenarioJson(const char *p, ServerRequest &request)
+{
+    const char *MALFORMED = "malformed request";
+    Scenario &scenario = request.scenario;
+    scenario.windSpeed = 0;
+    bool hasYield = false, hasHeight = false, hasBurst = false, hasCity = false;
+
+    p = skipJsonSpace(p + 1);
+    while (*p != '}')
+    {
+        char key[32];
+        if (*p != '"' || !(p = parseJsonString(p + 1, key, sizeof(key))))
+            return MALFORMED;
+        p = skipJsonSpace(p);
+        if (*p != ':')
+            return MALFORMED;
+        p = skipJsonSpace(p + 1);
+
+        // Scalar value: a string, a number, true, false or null
+        const char *value = p;
+        char text[4 * CATALOG_NAME_LIMIT + 4];
+        bool isString = false, isNumber = false, isBool = false, flag = false;
+        double number = 0;
+        if (*p == '"')
+        {
+            if (!(p = parseJsonString(p + 1, text, sizeof(text))))
+                return MALFORMED;
+            isString = true;
+        }
+        else if (!strncmp(p, "true", 4) || !strncmp(p, "false", 5))
+        {
+            flag = *p == 't';
+            p += flag ? 4 : 5;
+            isBool = true;
+        }
+        else if (!strncmp(p, "null", 4))
+        {
+            p += 4;
+        }
+        else
+        {
+            char *end;
+            number = strtod(p, &end);
+            if (end == p || !std::isfinite(number))
+                return MALFORMED;
+            p = end;
+            isNumber = true;
+        }
+
+        if (!strcmp(key, "id"))
+        {
+            size_t length = static_cast<size_t>(p - value);
+            if (!(isString || isNumber) || length > SERVER_ID_LIMIT)
+                return MALFORMED;
+            memcpy(request.id, value, length);
+            request.idLength = length;
+        }
+        else if (!strcmp(key, "yield_mt") && isNumber)
+        {
+            scenario.yield = number;
+            hasYield = true;
+        }
+        else if (!strcmp(key, "height_m") && isNumber)
+        {
+            scenario.height = number;
+            hasHeight = true;
+        }
+        else if (!strcmp(key, "wind_kmh") && isNumber)
+        {
+            scenario.windSpeed = number;
+        }
+        else if (!strcmp(key, "airburst") && isBool)
+        {
+            scenario.isAirburst = flag;
+            hasBurst = true;
+        }
+        else if (!strcmp(key, "city") && (isString || isNumber))
+        {
+            if (isNumber)
+            {
+                if (!(number >= 1 && number <= static_cast<double>(catalog().cities().size())) || number != std::floor(number))
+                    return "unknown city";
+                scenario.cityIndex = static_cast<size_t>(number) - 1;
+            }
+            else
+            {
+                scenario.cityIndex = catalog().findCity(text);
+                if (scenario.cityIndex >= catalog().cities().size())
+                    return "unknown city";
+            }
+            hasCity = true;
+        }
+        else if (!strcmp(key, "yield_mt") || !strcmp(key, "height_m") || !strcmp(key, "wind_kmh") ||
+                 !strcmp(key, "airburst") || !strcmp(key, "city"))
+        {
+            return MALFORMED; // Known field of the wrong type; unknown fields are ignored
+        }
+
+        p = skipJsonSpace(p);
+        if (*p == ',')
+            p = skipJsonSpace(p + 1);
+        else if (*p != '}')
+            return MALFORMED;
+    }
+    if (*skipJsonSpace(p + 1) != '\0')
+        return MALFORMED;
+
+    if (!hasYield || !hasHeight || !hasCity)
+        return "missing yield_mt, height_m or city";
+    if (!hasBurst)
+        scenario.isAirburst = scenario.height > 0;
+    if (!(scenario.yield > 0) || scenario.height < 0 || scenario.windSpeed < 0)
+        return "invalid scenario";
+    return nullptr;
+}
+
+// Function to parse one request line in place; returns false for a blank or comment line
+inline bool parseServerRequest(char *line, size_t lineNumber, ServerRequest &request)
+{
+    while (*line == ' ' || *line == '\t' || *line == '\r')
+        line++;
+    if (*line == '\0' || *line == '#')
+        return false;
+
+    request.idLength = 0;
+    if (*line == '{')
+        request.error = parseScenarioJson(line, request);
+    else
+        request.error = parseScenarioLine(line, request.scenario) ? nullptr : "malformed request";
+    if (request.idLength == 0)
+        request.idLength = static_cast<size_t>(snprintf(request.id, sizeof(request.id), "%zu", lineNumber));
+    return true;
+}
+
+class ScenarioServer
+{
+private:
+    const EvaluationOptions &options;
+    ServerOptions settings;
+    int listener = -1;
+    int wakeup[2] = {-1, -1}; // Compute threads and stop() wake the I/O thread through this pipe
+    std::string unixPath;     // Socket file removed at destruction
+    std::string boundAddress;
+
+    std::mutex lock; // Guards queue and stopping
+    std::condition_variable ready;
+    std::deque<ServerRequest> queue;
+    bool stopping = false;
+
+    std::unordered_map<int, std::shared_ptr<ServerConnection>> connections; // I/O thread only
+    std::atomic<size_t> served{0};
+    std::atomic<size_t> rejected{0};
+
+    // Function to wake the I/O thread with a command byte: 'w' to poll again, 's' to stop
+    void wake(char command)
+    {
+        ssize_t written = write(wakeup[1], &command, 1); // A full pipe already has a wake-up pending
+        (void)written;
+    }
+
+    // Function to take the next micro-batch; false once stopping with nothing queued
+    bool takeBatch(std::vector<ServerRequest> &batch)
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        for (;;)
+        {
+            ready.wait(guard, [&] { return stopping || !queue.empty(); });
+            if (queue.empty())
+                return false;
+            if (settings.batchWindow.count() > 0 && queue.size() < settings.maxBatch && !stopping)
+            {
+                auto deadline = queue.front().arrival + settings.batchWindow;
+                ready.wait_until(guard, deadline, [&] { return stopping || queue.size() >= settings.maxBatch; });
+                if (queue.empty())
+                    continue; // Taken by another thread meanwhile
+            }
+
+            size_t count = std::min(queue.size(), settings.maxBatch);
+            for (size_t i = 0; i < count; i++)
+            {
+                batch.push_back(std::move(queue.front()));
+                queue.pop_front();
+            }
+            if (!queue.empty())
+                ready.notify_one(); // More than one batch is queued
+            return true;
+        }
+    }
+
+    // Function to format the response line of a request into record, returns its length
+    template <typename Real>
+    size_t formatResponse(char *record, size_t size, const ServerRequest &request, EffectsCache<Real> *cache)
+    {
+        size_t length = static_cast<size_t>(snprintf(record, size, "{\"id\":%.*s", static_cast<int>(request.idLength),
+                                                     request.id));
+        if (request.error)
+        {
+            rejected++;
+            return length + static_cast<size_t>(snprintf(record + length, size - length, ",\"error\":\"%s\"}\n",
+                                                         request.error));
+        }
+
+        ScenarioResultT<Real> result =
+            cache ? cache->computeEffects(request.scenario) : computeEffects<Real>(request.scenario, options.model);
+        NUCCALC_STAGE(Output);
+        size_t resultLength = formatResultJson(record + length, size - length, makeResultRow(request.scenario, result));
+        record[length] = ','; // The result object continues the one holding the id
+        return length + resultLength;
+    }
+
+    // Function of the compute threads: answer micro-batches until the server stops
+    template <typename Real>
+    void serveRequests(EffectsCache<Real> *cache)
+    {
+        struct Reply
+        {
+            ServerConnection *connection;
+            std::string text;
+        };
+        std::vector<ServerRequest> batch;
+        std::vector<Reply> replies; // Responses of the batch per connection, strings keep their capacity
+        char record[RESULT_JSON_SIZE + SERVER_ID_LIMIT + 16];
+
+        while (takeBatch(batch))
+        {
+            size_t used = 0;
+            for (const ServerRequest &request : batch)
+            {
+                size_t length = formatResponse<Real>(record, sizeof(record), request, cache);
+                size_t r = 0;
+                while (r < used && replies[r].connection != request.connection.get())
+                    r++;
+                if (r == used)
+                {
+                    if (used == replies.size())
+                        replies.push_back(Reply());
+                    replies[r].connection = request.connection.get();
+                    replies[r].text.clear();
+                    used++;
+                }
+                replies[r].text.append(record, length);
+            }
+
+            bool pollAgain = false;
+            for (size_t r = 0; r < used; r++)
+            {
+                ServerConnection &connection = *replies[r].connection;
+                std::lock_guard<std::mutex> guard(connection.lock);
+                if (connection.broken)
+                    continue;
+                connection.output.append(replies[r].text);
+                if (!connection.flush())
+                    pollAgain = true; // Socket is full, the I/O thread sends the rest
+            }
+            for (const ServerRequest &request : batch)
+            {
+                if (--request.connection->inFlight == 0 && request.connection->readClosed)
+                    pollAgain = true; // Connection can be dropped now
+            }
+            served += batch.size();
+            batch.clear();
+            if (pollAgain)
+                wake('w');
+        }
+    }
+
+    // Function to accept every pending connection
+    void acceptConnections()
+    {
+        for (;;)
+        {
+            int fd = accept(listener, nullptr, nullptr);
+            if (fd < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return; // EAGAIN, or out of descriptors until a connection closes
+            }
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+            int on = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on)); // Fails harmlessly on Unix sockets
+            connections.emplace(fd, std::make_shared<ServerConnection>(fd));
+        }
+    }
+
+    // Function to queue the requests parsed from one read together
+    void enqueue(std::vector<ServerRequest> &parsed)
+    {
+        if (parsed.empty())
+            return;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            for (ServerRequest &request : parsed)
+            {
+                queue.push_back(std::move(request));
+            }
+        }
+        ready.notify_one();
+        parsed.clear();
+    }
+
+    // Function to read from a connection and queue its complete request lines
+    void readRequests(const std::shared_ptr<ServerConnection> &connection, std::vector<ServerRequest> &parsed)
+    {
+        ServerConnection &client = *connection;
+        char buffer[65536];
+        ssize_t count = recv(client.fd, buffer, sizeof(buffer), 0);
+        if (count < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            {
+                std::lock_guard<std::mutex> guard(client.lock);
+                client.broken = true;
+            }
+            return;
+        }
+        if (count == 0)
+        {
+            if (!client.input.empty())
+                client.input.push_back('\n'); // Last line without a newline
+            client.readClosed = true;
+        }
+        client.input.append(buffer, static_cast<size_t>(count));
+
+        auto now = std::chrono::steady_clock::now();
+        char line[SERVER_LINE_LIMIT + 1];
+        size_t start = 0;
+        for (size_t newline; (newline = client.input.find('\n', start)) != std::string::npos; start = newline + 1)
+        {
+            size_t length = newline - start;
+            client.lineNumber++;
+            ServerRequest request;
+            if (length > SERVER_LINE_LIMIT)
+            {
+                request.error = "request line too long";
+                request.idLength = static_cast<size_t>(snprintf(request.id, sizeof(request.id), "%zu", client.lineNumber));
+            }
+            else
+            {
+                memcpy(line, client.input.data() + start, length);
+                line[length] = '\0';
+                if (!parseServerRequest(line, client.lineNumber, request))
+                    continue;
+            }
+            request.connection = connection;
+            request.arrival = now;
+            client.inFlight++;
+            parsed.push_back(std::move(request));
+        }
+        client.input.erase(0, start);
+
+        if (client.input.size() > SERVER_LINE_LIMIT)
+        {
+            // No newline in sight: answer once and stop reading, the rest of the stream cannot be framed
+            ServerRequest request;
+            request.connection = connection;
+            request.error = "request line too long";
+            request.idLength = static_cast<size_t>(snprintf(request.id, sizeof(request.id), "%zu", ++client.lineNumber));
+            request.arrival = now;
+            client.inFlight++;
+            parsed.push_back(std::move(request));
+            client.input.clear();
+            client.readClosed = true;
+        }
+    }
+
+    // Function of the I/O thread: poll the sockets until stop()
+    void pollSockets()
+    {
+        std::vector<pollfd> polled;
+        std::vector<std::shared_ptr<ServerConnection>> polledConnections;
+        std::vector<ServerRequest> parsed;
+        for (;;)
+        {
+            polled.clear();
+            polledConnections.clear();
+            polled.push_back({wakeup[0], POLLIN, 0});
+            polled.push_back({listener, POLLIN, 0});
+            for (auto entry = connections.begin(); entry != connections.end();)
+            {
+                ServerConnection &client = *entry->second;
+                short events = client.readClosed ? 0 : POLLIN;
+                bool drop;
+                {
+                    std::lock_guard<std::mutex> guard(client.lock);
+                    if (!client.output.empty())
+                        events |= POLLOUT;
+                    drop = client.broken || (client.readClosed && client.inFlight == 0 && client.output.empty());
+                }
+                if (drop)
+                {
+                    entry = connections.erase(entry); // Closed once the last queued request lets go
+                    continue;
+                }
+                polled.push_back({client.fd, events, 0});
+                polledConnections.push_back(entry->second);
+                ++entry;
+            }
+
+            if (poll(polled.data(), polled.size(), -1) < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return;
+            }
+
+            if (polled[0].revents & POLLIN)
+            {
+                char commands[64];
+                ssize_t count = read(wakeup[0], commands, sizeof(commands));
+                if (count > 0 && memchr(commands, 's', static_cast<size_t>(count)))
+                    return;
+            }
+            if (polled[1].revents & POLLIN)
+                acceptConnections();
+
+            for (size_t i = 2; i < polled.size(); i++)
+            {
+                const std::shared_ptr<ServerConnection> &connection = polledConnections[i - 2];
+                short revents = polled[i].revents;
+                if (revents & POLLOUT)
+                {
+                    std::lock_guard<std::mutex> guard(connection->lock);
+                    connection->flush();
+                }
+                if (revents & POLLIN)
+                {
+                    readRequests(connection, parsed);
+                }
+                else if (revents & (POLLERR | POLLHUP | POLLNVAL))
+                {
+                    std::lock_guard<std::mutex> guard(connection->lock);
+                    connection->broken = true;
+                }
+            }
+            enqueue(parsed);
+        }
+    }
+
+    template <typename Real>
+    void runWith()
+    {
+        std::unique_ptr<EffectsCache<Real>> cache;
+        if (options.cache.capacity > 0)
+            cache.reset(new EffectsCache<Real>(options.cache, options.model));
+
+        unsigned threads = settings.threads ? settings.threads : std::max(1u, std::thread::hardware_concurrency());
+        std::vector<std::thread> computers;
+        for (unsigned t = 0; t < threads; t++)
+        {
+            computers.emplace_back([&] { serveRequests<Real>(cache.get()); });
+        }
+
+        pollSockets();
+
+        // Answer what is queued, then send what the sockets take without blocking
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+        }
+        ready.notify_all();
+        for (std::thread &computer : computers)
+        {
+            computer.join();
+        }
+        for (auto &entry : connections)
+        {
+            std::lock_guard<std::mutex> guard(entry.second->lock);
+            entry.second->flush();
+        }
+        connections.clear();
+
+        if (cache)
+            printCacheStatistics(std::cerr, cache->statistics());
+    }
+
+public:
+    ScenarioServer(const EvaluationOptions &options, const ServerOptions &settings)
+        : options(options), settings(settings)
+    {
+        this->settings.maxBatch = std::max<size_t>(1, settings.maxBatch);
+    }
+
+    ScenarioServer(const ScenarioServer &) = delete;
+    ScenarioServer &operator=(const ScenarioServer &) = delete;
+
+    ~ScenarioServer()
+    {
+        if (listener >= 0)
+            ::close(listener);
+        if (!unixPath.empty())
+            unlink(unixPath.c_str());
+        for (int fd : wakeup)
+        {
+            if (fd >= 0)
+                ::close(fd);
+        }
+    }
+
+    // Function to open the listening socket: unix:PATH or tcp:[HOST:]PORT (HOST defaults to 127.0.0.1)
+    // Returns false with a message in error on failure
+    bool listen(const char *address, std::string &error)
+    {
+        if (pipe(wakeup) != 0)
+        {
+            error = "cannot create wake-up pipe";
+            return false;
+        }
+        fcntl(wakeup[0], F_SETFL, fcntl(wakeup[0], F_GETFL) | O_NONBLOCK);
+        fcntl(wakeup[1], F_SETFL, fcntl(wakeup[1], F_GETFL) | O_NONBLOCK);
+
+        if (!strncmp(address, "unix:", 5))
+        {
+            sockaddr_un socketAddress = {};
+            socketAddress.sun_family = AF_UNIX;
+            const char *path = address + 5;
+            if (*path == '\0' || strlen(path) >= sizeof(socketAddress.sun_path))
+            {
+                error = std::string("invalid socket path ") + path;
+                return false;
+            }
+            strcpy(socketAddress.sun_path, path);
+
+            struct stat status;
+            if (lstat(path, &status) == 0 && S_ISSOCK(status.st_mode))
+                unlink(path); // Left behind by a previous server
+            listener = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (listener < 0 || bind(listener, reinterpret_cast<sockaddr *>(&socketAddress), sizeof(socketAddress)) != 0)
+            {
+                error = std::string("cannot bind ") + address + ": " + strerror(errno);
+                return false;
+            }
+            unixPath = path;
+            boundAddress = address;
+        }
+        else if (!strncmp(address, "tcp:", 4))
+        {
+            std::string host = "127.0.0.1";
+            std::string port = address + 4;
+            size_t colon = port.rfind(':');
+            if (colon != std::string::npos)
+            {
+                host = port.substr(0, colon);
+                port.erase(0, colon + 1);
+                if (host.size() >= 2 && host.front() == '[' && host.back() == ']')
+                    host = host.substr(1, host.size() - 2); // [IPv6]:port
+            }
+
+            addrinfo hints = {};
+            hints.ai_family = AF_UNSPEC;
+            hints.ai_socktype = SOCK_STREAM;
+            hints.ai_flags = AI_PASSIVE;
+            addrinfo *found = nullptr;
+            if (port.empty() || getaddrinfo(host.c_str(), port.c_str(), &hints, &found) != 0)
+            {
+                error = std::string("cannot resolve ") + address;
+                return false;
+            }
+            for (addrinfo *candidate = found; candidate && listener < 0; candidate = candidate->ai_next)
+            {
+                listener = socket(candidate->ai_family, candidate->ai_socktype, candidate->ai_protocol);
+                if (listener < 0)
+                    continue;
+                int on = 1;
+                setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+                if (bind(listener, candidate->ai_addr, candidate->ai_addrlen) != 0)
+                {
+                    ::close(listener);
+                    listener = -1;
+                }
+            }
+            freeaddrinfo(found);
+            if (listener < 0)
+            {
+                error = std::string("cannot bind ") + address + ": " + strerror(errno);
+                return false;
+            }
+
+            // Report the port the system picked for port 0
+            sockaddr_storage bound = {};
+            socklen_t boundSize = sizeof(bound);
+            getsockname(listener, reinterpret_cast<sockaddr *>(&bound), &boundSize);
+            char service[16] = "";
+            getnameinfo(reinterpret_cast<sockaddr *>(&bound), boundSize, nullptr, 0, service, sizeof(service),
+                        NI_NUMERICSERV);
+            boundAddress = "tcp:" + host + ":" + service;
+        }
+        else
+        {
+            error = std::string("invalid address ") + address + ", expected unix:PATH or tcp:[HOST:]PORT";
+            return false;
+        }
+
+        if (::listen(listener, SOMAXCONN) != 0)
+        {
+            error = std::string("cannot listen on ") + address + ": " + strerror(errno);
+            return false;
+        }
+        fcntl(listener, F_SETFL, fcntl(listener, F_GETFL) | O_NONBLOCK);
+        return true;
+    }
+
+    // Function to get the address listened on, with the actual port for tcp port 0
+    const std::string &address() const { return boundAddress; }
+
+    // Function to get the write end of the wake-up pipe; writing an 's' stops run()
+    int stopFd() const { return wakeup[1]; }
+
+    // Function to ask run() to return; safe from any thread
+    void stop() { wake('s'); }
+
+    // Function to serve requests until stop(), at the selected precision
+    void run()
+    {
+        switch (options.precision)
+        {
+        case Precision::Float:
+            runWith<float>();
+            break;
+        case Precision::LongDouble:
+            runWith<long double>();
+            break;
+        case Precision::Double:
+        default:
+            runWith<double>();
+            break;
+        }
+    }
+
+    // Function to get the number of requests answered, and of those answered with an error
+    size_t requestsServed() const { return served; }
+    size_t requestsRejected() const { return rejected; }
+};
+
+#endif // _WIN32
+
+// Main calculator class implementation
+class NuclearEffectsCalculator
+{
+private:
+    double yield;        // Nuclear weapon yield in megatons
+    double height;       // Height of burst in meters
+    bool isAirburst;     // Flag for air burst vs surface burst
+    double windSpeed;    // Wind speed for fallout calculations (km/h)
+    size_t selectedCity; // Target city, index into catalog().cities()
+
+    // Function to clear the screen
+    void clearScreen()
+    {
+#ifdef _WIN32
+        system("cls"); // Clear screen for Windows
+#else
+        std::cout << "\033[2J\033[H"; // ANSI clear + cursor home, avoids forking a shell
+#endif
+    }
+
+    // Function to print menu header
+    void printMenuHeader(const std::string &title)
+    {
+        std::cout << std::string(78, '-') << "\n"; // Print a line of dashes
+        std::cout << title << "\n";                // Print the title
+        std::cout << std::string(78, '-') << "\n"; // Print another line of dashes
+    }
+
+    // Function to print menu divider
+    void printMenuDivider()
+    {
+        std::cout << std::string(78, '-') << "\n"; // Print a line of dashes
+    }
+
+    // Modified weapon option printing function to show name and type
+    void printWeaponOption(size_t index, size_t maxItems)
+    {
+        const WeaponPreset &preset = catalog().presets()[index];
+        char mt[64];
+        snprintf(mt, sizeof(mt), "%f", preset.yield);
+        if (char *point = strchr(mt, '.'))
+            point[4] = '\0'; // Limit to 3 decimal places, "%f" always prints six
+
+        char entry[160]; // Formatted on the stack, the menu allocates nothing per entry
+        snprintf(entry, sizeof(entry), "%zu. %.*s/%.*s (%s MT)", index + 1, static_cast<int>(preset.name.size()),
+                 preset.name.data(), static_cast<int>(preset.type.size()), preset.type.data(), mt);
+
+        if (index % 2 == 0)
+        {
+            std::cout << std::setw(52) << std::left << entry; // Increased width to accommodate type
+        }
+        else
+        {
+            std::cout << entry << "\n";
+        }
+
+        // Add newline for odd-numbered sections
+        if (index % 2 == 0 && index == maxItems - 1)
+        {
+            std::cout << "\n";
+        }
+    }
+
+    // Function to print effect header in table format
+    void printEffectHeader()
+    {
+        std::cout << std::setw(12) << "Severity"     // Print header for effect levels
+                  << std::setw(15) << "Radius (m)"   // Print header for effect radii
+                  << std::setw(20) << "Area (km²)\n" // Print header for effect areas
+                  << std::string(47, '-') << "\n";   // Print a line of dashes
+    }
+
+    // Function to display effect levels
+    void displayEffectLevel(const std::string &name, const WeaponEffects::EffectLevels &effect)
+    {
+        std::cout << std::left << std::setw(15) << name << "| ";
+
+        auto formatDistance = [](long double dist) -> std::string
+        {
+            if (dist < 1.0)
+                return "< 1 m";
+            if (dist >= 1000.0)
+            {
+                return std::to_string(static_cast<int>(dist / 1000.0)) + "." +
+                       std::to_string(static_cast<int>(fmod(dist, 1000.0) / 100.0)) + " km";
+            }
+            return std::to_string(static_cast<int>(dist)) + " m";
+        };
+
+        std::cout << "Severe: " << std::setw(10) << formatDistance(effect.severe)
+                  << " (" << std::fixed << std::setprecision(2) << effect.severeArea << " km²) | ";
+        std::cout << "Moderate: " << std::setw(10) << formatDistance(effect.moderate)
+                  << " (" << effect.moderateArea << " km²) | ";
+        std::cout << "Light: " << std::setw(10) << formatDistance(effect.light)
+                  << " (" << effect.lightArea << " km²)\n";
+    }
+
+    // Function to display weapon presets
+    void displayPresets()
+    {
+        clearScreen();                               // Clear the screen
+        printMenuHeader("Nuclear Weapon Selection"); // Print menu header
+
+        if (!catalog().hasBuiltinPresets())
+        {
+            // Catalog presets have no groups
+            for (size_t i = 0; i < catalog().presets().size(); i++)
+            {
+                printWeaponOption(i, catalog().presets().size());
+            }
+            printMenuDivider();
+            printCustomOption();
+            return;
+        }
+
+        size_t i = 0;
+
+        // Display Historic Weapons
+        std::cout << "Historic Weapons:\n";
+        for (; i < 5; i++)
+        {
+            printWeaponOption(i, 5); // Print weapon options
+        }
+
+        printMenuDivider(); // Print menu divider
+
+        // Display US Weapons
+        std::cout << "United States:\n";
+        for (; i < 12; i++)
+        {
+            printWeaponOption(i, 12); // Print weapon options
+        }
+
+        printMenuDivider(); // Print menu divider
+
+        // Display Russian Weapons
+        std::cout << "Russian Weapons:\n";
+        for (; i < 18; i++)
+        {
+            printWeaponOption(i, 18); // Print weapon options
+        }
+
+        printMenuDivider(); // Print menu divider
+
+        // Display Chinese Weapons
+        std::cout << "Chinese Weapons:\n";
+        for (; i < 24; i++)
+        {
+            printWeaponOption(i, 24); // Print weapon options
+        }
+
+        printMenuDivider(); // Print menu divider
+
+        // Display Other Nuclear Powers
+        std::cout << "Other Nuclear Powers:\n";
+        for (; i < catalog().presets().size(); i++)
+        {
+            printWeaponOption(i, catalog().presets().size()); // Print weapon options
+        }
+
+        printMenuDivider(); // Print menu divider
+        printCustomOption();
+    }
+
+    // Function to end the weapon menu with the custom input option
+    void printCustomOption()
+    {
+        std::cout << catalog().presets().size() + 1 << ". Custom Input\n"; // Print custom input option
+        printMenuDivider();                                               // Print menu divider
+    }
+
+    // Function to set burst parameters
+    void setBurstParameters()
+    {
+        clearScreen();                           // Clear the screen
+        printMenuHeader("Burst Type Selection"); // Print menu header
+
+        OptimalHeight oh = calculateOptimalHeight(yield); // Calculate optimal heights
+
+        std::cout << "Optimal Heights Analysis:\n";                          // Print optimal heights
+        std::cout << "Thermal effects:     " << (int)oh.thermal << "m\n";    // Print thermal effects
+        std::cout << "Blast effects:       " << (int)oh.blast << "m\n";      // Print blast effects
+        std::cout << "Combined optimum:    " << (int)oh.combined << "m\n\n"; // Print combined effects
+
+        std::cout << "Select burst type:\n";
+        std::cout << std::string(78, '-') << "\n";
+        std::cout << "1. Surface Burst     | Height: 0m              | Maximum fallout, reduced blast radius\n";
+        std::cout << std::string(78, '-') << "\n";
+        std::cout << "2. Optimal Air Burst | Height: " << std::setw(5) << (int)oh.combined << "m          | Best combined blast/thermal effects\n";
+        std::cout << std::string(78, '-') << "\n";
+        std::cout << "3. Low Air Burst     | Height: " << std::setw(5) << (int)(oh.combined * 0.7) << "m          | Balanced effects, moderate fallout\n";
+        std::cout << std::string(78, '-') << "\n";
+        std::cout << "4. High Air Burst    | Height: " << std::setw(5) << (int)(oh.combined * 1.5) << "m          | Minimum fallout, reduced effects\n";
+        std::cout << std::string(78, '-') << "\n";
+        std::cout << "5. Thermal Optimized | Height: " << std::setw(5) << (int)oh.thermal << "m          | Maximum thermal radiation effects\n";
+        std::cout << std::string(78, '-') << "\n";
+        std::cout << "6. Blast Optimized   | Height: " << std::setw(5) << (int)oh.blast << "m          | Maximum blast wave effects\n";
+        std::cout << std::string(78, '-') << "\n";
         std::cout << "7. Custom Height     | User defined height     | Manual height input\n";
         std::cout << std::string(78, '-') << "\n";
 
-        std::cout << "Enter selection (1-7): ";
-        int choice;
-        std::cin >> choice; // Get user input
-        isAirburst = (choice > 1);
-        switch (choice)
+        std::cout << "Enter selection (1-7): ";
+        int choice;
+        std::cin >> choice; // Get user input
+        isAirburst = (choice > 1);
+        switch (choice)
+        {
+        case 1:
+            height = 0;
+            break;
+        case 2:
+            height = oh.combined;
+            break;
+        case 3:
+            height = oh.combined * 0.7;
+            break;
+        case 4:
+            height = oh.combined * 1.5;
+            break;
+        case 5:
+            height = oh.thermal;
+            break;
+        case 6:
+            height = oh.blast;
+            break;
+        case 7:
+            std::cout << "Enter burst height (meters): ";
+            std::cin >> height;
+            // Validate height input
+            if (height < 0)
+                height = 0;
+            if (height > oh.combined * 3)
+            {
+                std::cout << "Warning: Height might be too high for effective weapon use\n";
+            }
+            break;
+        default:
+            height = oh.combined; // Default to optimal height
+            break;
+        }
+    }
+
+
+    // Function to display casualty estimates
+    void displayCasualties(const CasualtyEstimate &casualties)
+    {
+        std::cout << "\nEstimated Casualties in " << catalog().cities()[selectedCity].name << ":\n";
+        std::cout << "=====================================\n";
+        std::cout << "Fatalities: " << std::fixed << std::setprecision(0)
+                  << casualties.deaths << "\n";
+        std::cout << "Severe Injuries: " << casualties.severeInjuries << "\n";
+        std::cout << "Light Injuries: " << casualties.lightInjuries << "\n";
+        std::cout << "Total Casualties: "
+                  << (casualties.deaths + casualties.severeInjuries +
+                      casualties.lightInjuries)
+                  << "\n";
+        std::cout << "Long-Term Deaths (1 Year): " << casualties.longTermDeaths1Year << "\n";
+        std::cout << "Long-Term Deaths (5 Years): " << casualties.longTermDeaths5Year << "\n";
+        std::cout << "Long-Term Deaths (10 Years): " << casualties.longTermDeaths10Year << "\n";
+        std::cout << "Long-Term Deaths (20 Years): " << casualties.longTermDeaths20Year << "\n";
+    }
+
+    // Function to select target city by number or by name
+    void selectCity()
+    {
+        clearScreen();
+        printMenuHeader("Target City Selection");
+
+        const std::vector<CityData> &cities = catalog().cities();
+        const size_t MENU_LIMIT = 50; // Larger catalogs are not listed
+        if (cities.size() <= MENU_LIMIT)
+        {
+            for (size_t i = 0; i < cities.size(); i++)
+            {
+                std::cout << std::setw(2) << i + 1 << ". "
+                          << std::setw(15) << cities[i].name
+                          << "  " << std::setw(12) << cities[i].country
+                          << "  Pop: " << cities[i].population << "M\n";
+            }
+        }
+        else
+        {
+            std::cout << cities.size() << " cities in the catalog\n";
+        }
+
+        printMenuDivider();
+        std::cout << "Enter city number or name: ";
+        std::string entry;
+        std::cin >> std::ws;
+        std::getline(std::cin, entry);
+        while (!entry.empty() && (entry.back() == ' ' || entry.back() == '\t' || entry.back() == '\r'))
+            entry.pop_back();
+
+        if (!findCity(entry.c_str(), selectedCity))
+        {
+            selectedCity = 0; // Default to London
+        }
+    }
+
+    // Function to set wind parameters
+    void setWindParameters()
+    {
+        clearScreen();
+        printMenuHeader("Wind Parameters");
+
+        std::cout << "Enter wind speed (km/h): ";
+        std::cin >> windSpeed;
+
+        printMenuDivider();
+    }
+
+public:
+    NuclearEffectsCalculator()
+        : yield(0), height(0), isAirburst(false),
+          windSpeed(0), selectedCity(0) {}
+
+    // Function to set parameters for the calculation
+    void setParameters()
+    {
+        displayPresets();
+        std::cout << "\nSelect weapon (1-" << catalog().presets().size() + 1 << "): ";
+        int choice;
+        std::cin >> choice;
+
+        if (choice >= 1 && static_cast<size_t>(choice) <= catalog().presets().size())
+        {
+            const auto &preset = catalog().presets()[choice - 1];
+            yield = preset.yield;
+            isAirburst = preset.isAirburst;
+            height = preset.typicalHeight;
+            std::cout << "\nSelected: " << preset.name << " (" << preset.type << ")\n";
+        }
+        else
+        {
+            std::cout << "Enter yield (MT): ";
+            std::cin >> yield;
+
+            std::cout << "Select detonation type:\n";
+            std::cout << "1. Ground burst\n2. Air burst\n";
+            std::cin >> choice;
+            isAirburst = (choice == 2);
+
+            if (isAirburst)
+            {
+                std::cout << "Enter height of burst (meters): ";
+                std::cin >> height;
+            }
+        }
+
+        setBurstParameters(); // Add burst parameter selection
+
+        selectCity(); // Add city selection
+
+        setWindParameters(); // Add wind parameters
+    }
+
+    // Function to describe the current parameters as a scenario
+    Scenario currentScenario() const
+    {
+        return {yield, height, isAirburst, windSpeed, selectedCity};
+    }
+
+    // Function to calculate weapon effects
+    WeaponEffects calculateEffects()
+    {
+        return ::calculateEffects(currentScenario());
+    }
+
+    // Function to display results
+    void displayResults(const WeaponEffects &effects)
+    {
+        // Clear screen before displaying results
+        clearScreen();
+
+        std::cout << "\nCalculated Effects:\n";
+        std::cout << std::string(78, '=') << "\n";
+
+        // Weapon Info
+        std::cout << "Weapon Data | ";
+        std::cout << "Yield: " << std::setw(6) << yield << " MT | ";
+        std::cout << "Type: " << (isAirburst ? "Air burst" : "Ground burst");
+        if (isAirburst)
+        {
+            std::cout << " | Height: " << height << "m";
+        }
+        std::cout << "\n"
+                  << std::string(78, '-') << "\n";
+
+        // Effects Data
+        displayEffectLevel("Thermal", effects.thermal);
+        std::cout << std::string(78, '-') << "\n";
+        displayEffectLevel("Blast", effects.blast);
+        std::cout << std::string(78, '-') << "\n";
+        displayEffectLevel("Radiation", effects.radiation);
+        std::cout << std::string(78, '-') << "\n";
+
+        // Fallout Information
+        std::cout << "Fallout Data | ";
+        std::cout << "Wind Speed: " << std::setw(3) << windSpeed << " km/h | ";
+        std::cout << "Max Distance: " << std::setw(5) << effects.fallout.maxDownwindDistance << " km\n";
+        std::cout << "Width: " << effects.fallout.maxWidth << " km | ";
+        std::cout << "Fallout Zone: " << effects.fallout.dangerousZoneArea << " km²\n";
+        std::cout << std::string(78, '-') << "\n";
+
+        // Casualties
+        CasualtyEstimate casualties = calculateCasualties(effects, catalog().cities()[selectedCity]);
+        displayCasualties(casualties);
+        std::cout << std::string(78, '=') << "\n";
+    }
+
+    // Function to evaluate a scenario file without prompts or screen clears
+    // Each non-empty line holds: yield (MT), height (m), burst (air/surface), wind (km/h), city (name or number)
+    // Returns the number of malformed lines, which are reported on std::cerr and skipped; writer is left open
+    size_t runBatch(std::istream &in, ResultWriter &writer, const EvaluationOptions &options = EvaluationOptions())
+    {
+        switch (options.precision)
         {
-        case 1:
-            height = 0;
-            break;
-        case 2:
-            height = oh.combined;
-            break;
-        case 3:
-            height = oh.combined * 0.7;
-            break;
-        case 4:
-            height = oh.combined * 1.5;
-            break;
-        case 5:
-            height = oh.thermal;
-            break;
-        case 6:
-            height = oh.blast;
-            break;
-        case 7:
-            std::cout << "Enter burst height (meters): ";
-            std::cin >> height;
-            // Validate height input
-            if (height < 0)
-                height = 0;
-            if (height > oh.combined * 3)
+        case Precision::Float:
+            return runBatchWith<float>(in, writer, options);
+        case Precision::LongDouble:
+            return runBatchWith<long double>(in, writer, options);
+        default:
+            return runBatchWith<double>(in, writer, options);
+        }
+    }
+
+    // Function to evaluate a scenario file into CSV records
+    size_t runBatch(std::istream &in, std::ostream &out, const EvaluationOptions &options = EvaluationOptions())
+    {
+        CsvResultWriter writer(out);
+        size_t errors = runBatch(in, writer, options);
+        writer.close();
+        return errors;
+    }
+
+private:
+    template <typename Real>
+    size_t runBatchWith(std::istream &in, ResultWriter &writer, const EvaluationOptions &options)
+    {
+        std::unique_ptr<EffectsCache<Real>> cache;
+        if (options.cache.capacity > 0)
+            cache.reset(new EffectsCache<Real>(options.cache, options.model));
+
+        std::string line;
+        size_t lineNumber = 0;
+        size_t errors = 0;
+        Scenario scenario;
+        int status;
+        while ((status = readScenarioLine(in, line, lineNumber, scenario)) != 0)
+        {
+            if (status < 0)
             {
-                std::cout << "Warning: Height might be too high for effective weapon use\n";
+                std::cerr << "batch: skipping malformed line " << lineNumber << "\n";
+                errors++;
+                continue;
             }
-            break;
-        default:
-            height = oh.combined; // Default to optimal height
-            break;
+            ScenarioResultT<Real> result =
+                cache ? cache->computeEffects(scenario) : computeEffects<Real>(scenario, options.model);
+            ResultRow row = makeResultRow(scenario, result);
+            writer.write(&row, 1);
         }
+
+        if (cache)
+            printCacheStatistics(std::cerr, cache->statistics());
+        return errors;
     }
+};
+
+// Define NUCCALC_NO_MAIN to embed the physics core and calculator in another program
+#ifndef NUCCALC_NO_MAIN
+
+// Function to print command line usage
+void printUsage(const char *program)
+{
+    std::cout << "Usage: " << program << " [--catalog FILE] [--batch <file|-> [options] | --sweep [options] | --profile ... | --raster ...]\n"
+              << "  (no arguments)    interactive mode\n"
+              << "  --catalog FILE    cities and weapon presets from a text catalog or a snapshot, before any mode\n"
+              << "  --batch <file>    evaluate every scenario line in <file> ('-' reads stdin)\n"
+              << "                    line format: yield_mt height_m air|surface wind_kmh city\n"
+              << "                    streamed through a reader, compute threads and an ordered writer\n"
+              << "  --sweep           evaluate cities x yields x heights x winds in parallel\n"
+              << "    --yield   min:max:steps[:log]  (default 0.01:50:100:log)\n"
+              << "    --height  min:max:steps[:log]  (default 0:2000:21, 0 = surface burst)\n"
+              << "    --wind    min:max:steps[:log]  (default 0:50:6)\n"
+              << "    --shard K/N                    only part K (from 0) of N, for one node of a distributed sweep\n"
+              << "    --resume                       continue the binary --output of an interrupted run\n"
+              << "  options of --batch and --sweep:\n"
+              << "    --threads N                           compute threads (default: all hardware threads)\n"
+              << "    --format csv|jsonl|binary             output format (default csv)\n"
+              << "    --output FILE                         write results to FILE (required for binary)\n"
+              << "    --precision float|double|long-double  arithmetic (default double)\n"
+              << "    --casualties rings|adaptive|analytic  casualty integration (default rings)\n"
+              << "    --rings N                             ring count of rings (default 20)\n"
+              << "    --tolerance T                         relative tolerance of adaptive (default 1e-6)\n"
+              << "    --scaling exact|tabulated             yield powers from pow() or from tables (default exact)\n"
+              << "    --cache N[:Y:H:W]                     LRU cache of N results keyed on the yield rounded\n"
+              << "                                          to a relative step Y, height to H m, wind to W km/h\n"
+              << "    --population FILE                     casualties from a population raster, ground zero at\n"
+              << "                                          its origin, instead of the city density model\n"
+              << "  --serve unix:PATH|tcp:[HOST:]PORT [options]\n"
+              << "                    answer JSON or batch line requests over a socket with JSON lines\n"
+              << "    --threads N, --precision, --casualties, --rings, --tolerance, --scaling, --cache,\n"
+              << "    --population                          as for --batch\n"
+              << "    --max-batch N                         requests a compute thread takes at a time (default 64)\n"
+              << "    --batch-window US                     wait up to US microseconds for a fuller batch (default 0)\n"
+              << "  --profile <yield_mt> <height_m> <max_distance_m> <points> [--atmosphere ...] [--elevation M]\n"
+              << "                    overpressure and thermal fluence vs. range as CSV\n"
+              << "    --atmosphere legacy|standard          sea level constants or US Standard Atmosphere 1976\n"
+              << "                                          (default legacy)\n"
+              << "    --elevation M                         ground elevation above sea level for standard\n"
+              << "  --series <yield_mt> <height_m> <step_s> <samples> [--atmosphere ...] [--elevation M]\n"
+              << "                    shock front and thermal pulse vs. time as CSV, computed as it is written\n"
+              << "  --sensitivity <yield_mt> <height_m> <wind_kmh> <distance_m> [--airburst] [--atmosphere ...]\n"
+              << "                [--elevation M]\n"
+              << "                    blast, thermal and fallout outputs with their derivatives against every input\n"
+              << "  --ranges [options]\n"
+              << "                    ranges at which the blast and thermal curves fall to thresholds, yields x heights\n"
+              << "    --yield, --height                     as for --sweep\n"
+              << "    --psi P1,P2,...                       overpressures above the ambient term (default 20,10,5)\n"
+              << "    --cal C1,C2,...                       thermal fluences in cal/cm² (default 8,5,3)\n"
+              << "    --atmosphere, --elevation             as for --profile\n"
+              << "    --threads N                           compute threads (default: all hardware threads)\n"
+              << "  --raster overpressure|thermal|fallout <yield_mt> <height_m> <cells>[x<rows>] <cell_m> --output FILE\n"
+              << "                    effect field on a grid around ground zero as a float raster file\n"
+              << "    --threads N, --precision float|double|long-double  as for --batch\n"
+              << "    --wind KMH, --wind-from DEG           fallout wind speed and the direction it blows from\n"
+              << "    --atmosphere, --elevation             as for --profile, overpressure and thermal only\n"
+#ifdef NUCCALC_OFFLOAD
+              << "    --device                              render on the OpenMP offload device, in double\n"
+#endif
+              << "  --ensemble <yield_mt> <height_m> <members>\n"
+              << "                    percentiles of fallout and thermal fluence under uncertain inputs as CSV\n"
+              << "    --wind MEAN[:SD]          wind speed in km/h, normal clamped at 0 (default 10:3)\n"
+              << "    --attenuation MEAN[:SD]   thermal extinction per km, lognormal (default 0.17:0.04)\n"
+              << "    --scale-height MEAN[:SD]  thermal scale height in m, lognormal (default 7400:500)\n"
+              << "    --distances D1,D2,...     thermal fluence ranges in m (default 1000,2000,5000,10000,20000)\n"
+              << "    --seed N                  random stream; each member draws the same inputs on any --threads (default 1)\n"
+              << "    --threads N, --precision float|double|long-double  as for --batch\n"
+              << "  --index-population <in> <out>\n"
+              << "                    copy a population raster with row prefix sums, so loading it only maps the file\n"
+              << "  --compile-catalog <in> <out>\n"
+              << "                    write a catalog as a snapshot with its hash index, so loading it only maps the file\n";
+}
+
+// Function to parse a sweep range argument of the form min:max:steps[:log]
+bool parseSweepRange(const char *text, SweepRange &range)
+{
+    char *end;
+    range.min = strtod(text, &end);
+    if (*end != ':')
+        return false;
+    range.max = strtod(end + 1, &end);
+    if (*end != ':')
+        return false;
+    long steps = strtol(end + 1, &end, 10);
+    if (steps < 1)
+        return false;
+    range.steps = static_cast<size_t>(steps);
+    range.logarithmic = false;
+    if (!strcmp(end, ":log"))
+        range.logarithmic = true;
+    else if (*end != '\0')
+        return false;
+    if (range.max < range.min || (range.logarithmic && range.min <= 0))
+        return false;
+    return true;
+}
+
+// Function to parse a --precision argument
+bool parsePrecision(const char *text, Precision &precision)
+{
+    if (!strcmp(text, "float"))
+        precision = Precision::Float;
+    else if (!strcmp(text, "double"))
+        precision = Precision::Double;
+    else if (!strcmp(text, "long-double"))
+        precision = Precision::LongDouble;
+    else
+        return false;
+    return true;
+}
 
-    // Core calculation function for blast overpressure effects
-    long double calculateBlastOverpressure(long double distance, long double yield)
+// Function to parse a --cache argument: capacity[:yield_quantum:height_quantum_m:wind_quantum_kmh]
+bool parseCacheOptions(const char *text, CacheOptions &cache)
+{
+    char *end;
+    long capacity = strtol(text, &end, 10);
+    if (capacity < 1)
+        return false;
+    cache.capacity = static_cast<size_t>(capacity);
+    if (*end == '\0')
+        return true;
+
+    double *quanta[3] = {&cache.yieldQuantum, &cache.heightQuantum, &cache.windQuantum};
+    for (double *quantum : quanta)
     {
-        // Convert nuclear yield from megatons to joules (1 MT = 4.184e15 J)
-        long double E = yield * 4.184e15; // Total energy release in joules
+        if (*end != ':')
+            return false;
+        *quantum = strtod(end + 1, &end);
+        if (!(*quantum >= 0))
+            return false;
+    }
+    return *end == '\0';
+}
 
-        // Calculate scaled distance using Sachs scaling law for nuclear explosions
-        // This accounts for atmospheric pressure effects on blast wave propagation
-        long double scaled_distance = distance / pow(E / PhysicalConstants::ATMOSPHERIC_PRESSURE, 1.0L / 3.0L);
+// Function to parse an evaluation option shared by --batch and --sweep at argv[i], advancing i past its value
+// Returns 1 if the option was consumed, 0 if it is not an evaluation option and -1 if its value is invalid
+int parseEvaluationOption(int argc, char *argv[], int &i, EvaluationOptions &options)
+{
+    if (i + 1 >= argc)
+        return 0;
 
-        // Calculate Mach stem enhancement factor for airburst detonations
-        // Mach stem forms when incident and reflected shock waves merge
-        long double mach_stem_factor = 1.0; // Initialize to no enhancement
-        if (height > 0)
+    const char *option = argv[i];
+    const char *value = argv[i + 1];
+    bool valid;
+    if (!strcmp(option, "--precision"))
+    {
+        valid = parsePrecision(value, options.precision);
+    }
+    else if (!strcmp(option, "--casualties"))
+    {
+        valid = true;
+        if (!strcmp(value, "rings"))
+            options.model.casualtyMethod = CasualtyMethod::Rings;
+        else if (!strcmp(value, "adaptive"))
+            options.model.casualtyMethod = CasualtyMethod::Adaptive;
+        else if (!strcmp(value, "analytic"))
+            options.model.casualtyMethod = CasualtyMethod::Analytic;
+        else
+            valid = false;
+    }
+    else if (!strcmp(option, "--rings"))
+    {
+        options.model.casualtyRings = atoi(value);
+        valid = options.model.casualtyRings > 0;
+    }
+    else if (!strcmp(option, "--tolerance"))
+    {
+        options.model.casualtyTolerance = strtod(value, nullptr);
+        valid = options.model.casualtyTolerance > 0;
+    }
+    else if (!strcmp(option, "--scaling"))
+    {
+        valid = true;
+        if (!strcmp(value, "exact"))
+            options.model.yieldScaling = YieldScaling::Exact;
+        else if (!strcmp(value, "tabulated"))
+            options.model.yieldScaling = YieldScaling::Tabulated;
+        else
+            valid = false;
+    }
+    else if (!strcmp(option, "--cache"))
+    {
+        valid = parseCacheOptions(value, options.cache);
+    }
+    else if (!strcmp(option, "--population"))
+    {
+        auto population = std::make_shared<PopulationRaster>();
+        std::string error;
+        valid = population->open(value, error);
+        if (!valid)
+            std::cerr << error << "\n";
+        options.population = population;
+        options.model.population = population.get();
+    }
+    else
+    {
+        return 0;
+    }
+
+    i++;
+    return valid ? 1 : -1;
+}
+
+// Output destination of the --batch and --sweep modes
+struct OutputOptions
+{
+    OutputFormat format = OutputFormat::Csv;
+    const char *path = nullptr; // nullptr writes to stdout
+};
+
+// Function to parse an output option at argv[i], with the same return values as parseEvaluationOption
+int parseOutputOption(int argc, char *argv[], int &i, OutputOptions &output)
+{
+    if (i + 1 >= argc)
+        return 0;
+
+    const char *option = argv[i];
+    const char *value = argv[i + 1];
+    bool valid = true;
+    if (!strcmp(option, "--format"))
+    {
+        if (!strcmp(value, "csv"))
+            output.format = OutputFormat::Csv;
+        else if (!strcmp(value, "jsonl"))
+            output.format = OutputFormat::JsonLines;
+        else if (!strcmp(value, "binary"))
+            output.format = OutputFormat::Columnar;
+        else
+            valid = false;
+    }
+    else if (!strcmp(option, "--output"))
+    {
+        output.path = strcmp(value, "-") ? value : nullptr;
+    }
+    else
+    {
+        return 0;
+    }
+
+    i++;
+    return valid ? 1 : -1;
+}
+
+// Function to parse an atmosphere option of the --profile and --raster modes
+// Returns 1 if one was consumed (advancing i past its value), 0 if argv[i] is not one, -1 if invalid
+int parseAtmosphereOption(int argc, char *argv[], int &i, AtmosphereOptions &atmosphere)
+{
+    if (i + 1 >= argc)
+        return 0;
+
+    const char *option = argv[i];
+    const char *value = argv[i + 1];
+    bool valid = true;
+    if (!strcmp(option, "--atmosphere"))
+    {
+        if (!strcmp(value, "legacy"))
+            atmosphere.model = AtmosphereModel::Legacy;
+        else if (!strcmp(value, "standard"))
+            atmosphere.model = AtmosphereModel::Standard;
+        else
+            valid = false;
+    }
+    else if (!strcmp(option, "--elevation"))
+    {
+        char *end;
+        atmosphere.groundElevation = strtod(value, &end);
+        valid = *end == '\0' && atmosphere.groundElevation >= StandardAtmosphereTable::MIN_ALTITUDE &&
+                atmosphere.groundElevation <= 9000;
+    }
+    else
+    {
+        return 0;
+    }
+
+    i++;
+    return valid ? 1 : -1;
+}
+
+// Function to run body(writer) with a result writer on the selected output, returns the process exit code
+// body returns its own exit code, which is kept unless the output fails
+template <typename Body>
+int withResultWriter(const OutputOptions &output, const char *mode, Body &&body)
+{
+    std::ofstream file;
+    if (output.path)
+    {
+        file.open(output.path, std::ios::binary | std::ios::trunc);
+        if (!file)
         {
-            // Scale height relative to yield using cube root scaling
-            long double mach_height = height / pow(yield, 1.0L / 3.0L);
-            // Enhancement decreases exponentially with scaled height
-            mach_stem_factor = 1.0 + 0.1 * exp(-mach_height / 100.0);
+            std::cerr << mode << ": cannot create " << output.path << "\n";
+            return 1;
         }
+    }
+    else if (output.format == OutputFormat::Columnar)
+    {
+        std::cerr << mode << ": binary output needs --output <file>\n";
+        return 1;
+    }
 
-        // Calculate triple-point effects where Mach stem begins to form
-        // This occurs at a specific height-dependent distance from ground zero
-        long double triple_point_height = 83 * pow(yield, 0.4); // Empirical relationship
-        if (height > 0 && height < triple_point_height)
+    std::unique_ptr<ResultWriter> writer = makeResultWriter(output.format, output.path ? file : std::cout);
+    int status = body(*writer);
+    if (!writer->close())
+    {
+        std::cerr << mode << ": error writing results\n";
+        return 1;
+    }
+    return status;
+}
+
+// Function to run body(writer, rows) on a binary output file that continues the checkpoint of job jobKey in
+// it, returns the process exit code; rows is the number of the totalRows results the file already holds
+template <typename Body>
+int withCheckpointWriter(const OutputOptions &output, const char *mode, uint64_t jobKey, uint64_t totalRows,
+                         Body &&body)
+{
+    if (output.format != OutputFormat::Columnar || !output.path)
+    {
+        std::cerr << mode << ": --resume needs --format binary --output <file>\n";
+        return 1;
+    }
+    ColumnarCheckpoint checkpoint;
+    std::string error;
+    if (!readColumnarCheckpoint(output.path, jobKey, totalRows, checkpoint, error))
+    {
+        std::cerr << mode << ": " << error << "\n";
+        return 1;
+    }
+
+    std::fstream file;
+    if (checkpoint.size > 0)
+        file.open(output.path, std::ios::binary | std::ios::in | std::ios::out | std::ios::ate);
+    else if (checkpoint.rowCount == 0)
+        file.open(output.path, std::ios::binary | std::ios::out | std::ios::trunc);
+    else
+        return 0; // Complete, the file stays as it is
+    if (!file)
+    {
+        std::cerr << mode << ": cannot open " << output.path << "\n";
+        return 1;
+    }
+
+    std::unique_ptr<ResultWriter> writer(checkpoint.size > 0 ? new ColumnarResultWriter(file, checkpoint)
+                                                              : new ColumnarResultWriter(file, jobKey));
+    int status = body(*writer, checkpoint.rowCount);
+    if (!writer->close())
+    {
+        std::cerr << mode << ": error writing results\n";
+        return 1;
+    }
+    return status;
+}
+
+// Function to parse a sweep shard argument of the form K/N
+bool parseSweepShard(const char *text, SweepShard &shard)
+{
+    char *end;
+    long index = strtol(text, &end, 10);
+    if (*end != '/')
+        return false;
+    long count = strtol(end + 1, &end, 10);
+    if (*end != '\0' || index < 0 || count < 1 || index >= count)
+        return false;
+    shard.index = static_cast<size_t>(index);
+    shard.count = static_cast<size_t>(count);
+    return true;
+}
+
+// Function to run the --sweep mode
+int runSweepMode(int argc, char *argv[])
+{
+    SweepSpec spec = {{0.01, 50.0, 100, true}, {0.0, 2000.0, 21, false}, {0.0, 50.0, 6, false}};
+    unsigned threads = 0;
+    EvaluationOptions options;
+    OutputOptions output;
+    SweepShard shard;
+    bool resume = false;
+
+    for (int i = 2; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+        bool valid = hasValue;
+        if (hasValue && !strcmp(argv[i], "--yield"))
+            valid = parseSweepRange(argv[++i], spec.yield) && spec.yield.min > 0;
+        else if (hasValue && !strcmp(argv[i], "--height"))
+            valid = parseSweepRange(argv[++i], spec.height) && spec.height.min >= 0;
+        else if (hasValue && !strcmp(argv[i], "--wind"))
+            valid = parseSweepRange(argv[++i], spec.wind) && spec.wind.min >= 0;
+        else if (hasValue && !strcmp(argv[i], "--threads"))
+            threads = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+        else if (hasValue && !strcmp(argv[i], "--shard"))
+            valid = parseSweepShard(argv[++i], shard);
+        else if (!strcmp(argv[i], "--resume"))
+            valid = resume = true;
+        else if (int parsed = parseEvaluationOption(argc, argv, i, options))
+            valid = parsed > 0;
+        else if (int parsed = parseOutputOption(argc, argv, i, output))
+            valid = parsed > 0;
+        else
+            valid = false;
+
+        if (!valid)
         {
-            // Enhance blast effects in Mach stem region
-            mach_stem_factor *= 1.25; // 25% enhancement in Mach region
+            std::cerr << "sweep: invalid option " << argv[i] << "\n";
+            return 1;
         }
+    }
+
+    size_t begin, end;
+    shardRange(sweepSize(spec), shard, begin, end);
+    WorkStealingPool pool(threads);
+    if (!resume)
+    {
+        return withResultWriter(output, "sweep", [&](ResultWriter &writer)
+                                {
+            runSweep(spec, pool, writer, options, begin, end);
+            return 0; });
+    }
+
+    return withCheckpointWriter(output, "sweep", sweepJobKey(spec, shard, options), end - begin,
+                                [&](ResultWriter &writer, uint64_t done)
+                                {
+        if (done > 0)
+            std::cerr << "sweep: resuming after " << done << " of " << end - begin << " results\n";
+        runSweep(spec, pool, writer, options, begin + done, end);
+        return 0; });
+}
+
+// Function to run the --raster mode: an effect field around ground zero written as a raster file
+int runRasterMode(int argc, char *argv[])
+{
+    if (argc < 7)
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
 
-        // Calculate final overpressure using modified Brode equation
-        // Terms represent different components of blast wave behavior:
-        // - 1.0: ambient pressure term
-        // - 0.076/scaled_distance: initial shock wave
-        // - 0.255/scaled_distance^2: positive phase duration
-        // - 0.536/scaled_distance^3: negative phase effects
-        return PhysicalConstants::ATMOSPHERIC_PRESSURE *
-               (1.0 + 0.076 / scaled_distance + 0.255 / pow(scaled_distance, 2.0) +
-                0.536 / pow(scaled_distance, 3.0)) *
-               mach_stem_factor;
+    RasterField field;
+    if (!strcmp(argv[2], "overpressure"))
+        field = RasterField::Overpressure;
+    else if (!strcmp(argv[2], "thermal"))
+        field = RasterField::ThermalFluence;
+    else if (!strcmp(argv[2], "fallout"))
+        field = RasterField::FalloutDeposition;
+    else
+    {
+        std::cerr << "raster: unknown field " << argv[2] << "\n";
+        return 1;
     }
 
-    // Thermal radiation calculation with atmospheric effects
-    long double calculateThermalRadiation(long double distance, long double yield, long double height)
+    double yield = strtod(argv[3], nullptr);
+    double height = strtod(argv[4], nullptr);
+    char *end;
+    long width = strtol(argv[5], &end, 10); // <cells> or <width>x<height>
+    long rows = width;
+    if (*end == 'x')
+        rows = strtol(end + 1, &end, 10);
+    RasterSpec spec = {static_cast<size_t>(std::max(width, 0L)), static_cast<size_t>(std::max(rows, 0L)),
+                       strtod(argv[6], nullptr)};
+    if (!(yield > 0) || height < 0 || *end != '\0' || width < 1 || rows < 1 || !(spec.cellSize > 0))
     {
-        // Fix thermal calculation
-        const long double THERMAL_CONSTANT = 10000.0; // Calibration constant
-        long double E = yield * 4.184e15 * 0.35;
-        long double fireball_temperature = 6000.0 + 1000.0 * log10(yield);
+        std::cerr << "raster: invalid arguments\n";
+        return 1;
+    }
 
-        // Simplified thermal radiation formula
-        long double thermal_energy = THERMAL_CONSTANT * (E / (4.0 * M_PI * pow(distance, 2.0)));
+    unsigned threads = 0;
+    Precision precision = Precision::Double;
+    const char *path = nullptr;
+    double windSpeed = 0;     // Fallout only (km/h)
+    double windDirection = 0; // Fallout only, direction the wind blows from (degrees from north)
+    AtmosphereOptions atmosphereOptions;
+    bool onDevice = false; // Render with the offload backend
+    for (int i = 7; i < argc; i++)
+    {
+#ifdef NUCCALC_OFFLOAD
+        if (!strcmp(argv[i], "--device"))
+        {
+            onDevice = true;
+            continue;
+        }
+#endif
+        int parsed = parseAtmosphereOption(argc, argv, i, atmosphereOptions);
+        if (parsed != 0)
+        {
+            if (parsed < 0)
+            {
+                std::cerr << "raster: invalid option " << argv[i - 1] << "\n";
+                return 1;
+            }
+            continue;
+        }
 
-        // Apply atmospheric attenuation
-        long double transmission = exp(-0.17 * distance / 1000.0);
+        bool valid = i + 1 < argc;
+        if (valid && !strcmp(argv[i], "--threads"))
+            threads = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+        else if (valid && !strcmp(argv[i], "--precision"))
+            valid = parsePrecision(argv[++i], precision);
+        else if (valid && !strcmp(argv[i], "--output"))
+            path = argv[++i];
+        else if (valid && !strcmp(argv[i], "--wind"))
+            valid = (windSpeed = strtod(argv[++i], nullptr)) >= 0;
+        else if (valid && !strcmp(argv[i], "--wind-from"))
+            windDirection = strtod(argv[++i], nullptr);
+        else
+            valid = false;
 
-        if (height > 0)
+        if (!valid)
+        {
+            std::cerr << "raster: invalid option " << argv[i] << "\n";
+            return 1;
+        }
+    }
+    if (atmosphereOptions.groundElevation != 0 && atmosphereOptions.model != AtmosphereModel::Standard)
+    {
+        std::cerr << "raster: --elevation requires --atmosphere standard\n";
+        return 1;
+    }
+    if (!path)
+    {
+        std::cerr << "raster: raster output needs --output <file>\n";
+        return 1;
+    }
+    if (onDevice && precision != Precision::Double)
+    {
+        std::cerr << "raster: --device renders in double precision\n";
+        return 1;
+    }
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        std::cerr << "raster: cannot create " << path << "\n";
+        return 1;
+    }
+
+    WorkStealingPool pool(threads);
+    EffectRaster raster;
+#ifdef NUCCALC_OFFLOAD
+    if (onDevice)
+    {
+        DeviceRaster device(spec);
+        if (field == RasterField::FalloutDeposition)
+            device.renderFallout(yield, height, height > 0, windSpeed, windDirection);
+        else
+            device.render(field, yield, height, makeAtmosphereConditions(atmosphereOptions, height));
+        device.download(raster);
+    }
+    else
+#endif
+    if (field == RasterField::FalloutDeposition)
+    {
+        // Air burst whenever the burst is above ground, as in the sweep mode
+        bool isAirburst = height > 0;
+        switch (precision)
         {
-            long double angle_factor = sqrt(1.0 - pow(height / (distance + height), 2.0));
-            thermal_energy *= angle_factor * exp(-height / 7400.0);
+        case Precision::Float:
+            raster = FalloutRasterizer<float>(yield, height, isAirburst, spec).render(windSpeed, windDirection, &pool);
+            break;
+        case Precision::LongDouble:
+            raster = FalloutRasterizer<long double>(yield, height, isAirburst, spec).render(windSpeed, windDirection, &pool);
+            break;
+        case Precision::Double:
+        default:
+            raster = FalloutRasterizer<double>(yield, height, isAirburst, spec).render(windSpeed, windDirection, &pool);
+            break;
         }
+    }
+    else
+    {
+        raster = rasterizeEffectField(field, yield, height, spec, pool, precision,
+                                      makeAtmosphereConditions(atmosphereOptions, height));
+    }
+    if (!writeRaster(file, field, raster))
+    {
+        std::cerr << "raster: error writing " << path << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+// Function to parse an ensemble input of the form mean[:stddev]
+bool parseEnsembleInput(const char *text, EnsembleInput &input)
+{
+    char *end;
+    input.mean = strtod(text, &end);
+    input.deviation = 0;
+    if (*end == ':')
+        input.deviation = strtod(end + 1, &end);
+    return end != text && *end == '\0' && input.mean >= 0 && input.deviation >= 0;
+}
+
+// Function to parse a comma separated list of positive values
+bool parsePositiveList(const char *text, std::vector<double> &values)
+{
+    values.clear();
+    for (;;)
+    {
+        char *end;
+        double value = strtod(text, &end);
+        if (end == text || !(value > 0))
+            return false;
+        values.push_back(value);
+        if (*end == '\0')
+            return true;
+        if (*end != ',')
+            return false;
+        text = end + 1;
+    }
+}
 
-        return thermal_energy * transmission;
+// Function to run the --ensemble mode: percentile summary of a scenario under uncertain inputs
+int runEnsembleMode(int argc, char *argv[])
+{
+    if (argc < 5)
+    {
+        printUsage(argv[0]);
+        return 1;
     }
 
-    // Function to calculate fallout pattern
-    FalloutData calculateFallout()
+    EnsembleSpec spec;
+    spec.yield = strtod(argv[2], nullptr);
+    spec.height = strtod(argv[3], nullptr);
+    long members = strtol(argv[4], nullptr, 10);
+    if (!(spec.yield > 0) || spec.height < 0 || members < 1)
     {
-        FalloutData fallout;
-
-        // Calculate stabilized cloud height
-        double stabilizedHeight = (height == 0) ? 212.0 * pow(yield, 0.375) : // Ground burst
-                                      188.0 * pow(yield, 0.375);              // Air burst
-
-        // Calculate particle fraction and activity
-        double particleFraction = isAirburst ? 0.3 * exp(-height / (stabilizedHeight * 0.7)) : 1.0;
-        double activityFraction = 0.6 + 0.2 * log10(yield);
-        double effectiveYield = yield * particleFraction * activityFraction;
-
-        // Base fallout radius due to mushroom cloud spread
-        double baseRadius = 1000.0 * pow(effectiveYield, 0.4);
+        std::cerr << "ensemble: invalid arguments\n";
+        return 1;
+    }
+    spec.members = static_cast<size_t>(members);
 
-        if (windSpeed < 0.1)
-        { // Near-zero wind conditions
-            // Create circular pattern
-            fallout.maxDownwindDistance = baseRadius / 1000.0; // Convert to km
-            fallout.maxWidth = baseRadius / 1000.0;            // Equal in all directions
-            fallout.falloutAngle = 360.0;                      // Full circle
-        }
+    unsigned threads = 0;
+    Precision precision = Precision::Double;
+    for (int i = 5; i < argc; i++)
+    {
+        bool valid = i + 1 < argc;
+        if (valid && !strcmp(argv[i], "--threads"))
+            threads = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+        else if (valid && !strcmp(argv[i], "--precision"))
+            valid = parsePrecision(argv[++i], precision);
+        else if (valid && !strcmp(argv[i], "--seed"))
+            spec.seed = strtoull(argv[++i], nullptr, 10);
+        else if (valid && !strcmp(argv[i], "--wind"))
+            valid = parseEnsembleInput(argv[++i], spec.wind);
+        else if (valid && !strcmp(argv[i], "--attenuation"))
+            valid = parseEnsembleInput(argv[++i], spec.attenuation) && spec.attenuation.mean > 0;
+        else if (valid && !strcmp(argv[i], "--scale-height"))
+            valid = parseEnsembleInput(argv[++i], spec.scaleHeight) && spec.scaleHeight.mean > 0;
+        else if (valid && !strcmp(argv[i], "--distances"))
+            valid = parsePositiveList(argv[++i], spec.distances);
         else
-        {
-            // Calculate wind-driven pattern
-            fallout.maxDownwindDistance = std::max(
-                baseRadius / 1000.0, // Minimum distance
-                windSpeed * 3600.0 * (pow(effectiveYield, 0.4) / PhysicalConstants::GRAVITY) *
-                    (1.0 + 0.15 * log10(yield)));
-
-            // Width calculation with turbulent diffusion
-            fallout.maxWidth = fallout.maxDownwindDistance *
-                               (0.14 + 0.02 * log10(yield)) *
-                               pow(stabilizedHeight / 1000.0, 0.5);
-
-            // Fallout angle for wind conditions
-            fallout.falloutAngle = 40.0 * exp(-height / (stabilizedHeight * 2.0)) *
-                                   (1.0 - 0.1 * log10(std::max(1.0, windSpeed)));
-        }
+            valid = false;
 
-        // Calculate danger zone area
-        if (windSpeed < 0.1)
+        if (!valid)
         {
-            fallout.dangerousZoneArea = M_PI * pow(fallout.maxDownwindDistance, 2);
+            std::cerr << "ensemble: invalid option " << argv[i] << "\n";
+            return 1;
         }
-        else
+    }
+
+    WorkStealingPool pool(threads);
+    writeEnsembleSummary(std::cout, runEnsemble(spec, pool, precision));
+    return 0;
+}
+
+// Function to run the --ranges mode: threshold ranges of the blast and thermal curves over yields x heights
+int runRangesMode(int argc, char *argv[])
+{
+    ThresholdSweepSpec spec = {{0.01, 50.0, 100, true}, {0.0, 2000.0, 21, false}, {20, 10, 5}, {8, 5, 3}, {}};
+    unsigned threads = 0;
+    for (int i = 2; i < argc; i++)
+    {
+        int parsed = parseAtmosphereOption(argc, argv, i, spec.atmosphere);
+        if (parsed != 0)
         {
-            fallout.dangerousZoneArea = 0.5 * fallout.maxDownwindDistance *
-                                        fallout.maxWidth * particleFraction *
-                                        (1.0 - 0.2 * isAirburst);
-        }
-
-        // Scale all values based on burst type
-        double falloutScale = (height == 0) ? 1.0 : 0.3; // Ground burst produces more fallout
-        fallout.dangerousZoneArea *= falloutScale;
-
-        return fallout;
-    }
-
-    // Add city selection
-    const std::vector<CityData> CITIES = {
-        {"Amsterdam", "Netherlands", 1.1, 219, 5023, 9.2, 2100},
-        {"Athens", "Greece", 3.2, 412, 7767, 15.2, 2200},
-        {"Barcelona", "Spain", 1.6, 101, 15842, 5.8, 3500},
-        {"Belgrade", "Serbia", 1.7, 360, 4722, 10.7, 1200},
-        {"Berlin", "Germany", 3.7, 892, 4147, 16.8, 1800},
-        {"Brussels", "Belgium", 2.1, 161, 13043, 7.2, 3200},
-        {"Bucharest", "Romania", 2.1, 228, 9210, 8.5, 1500},
-        {"Budapest", "Hungary", 1.8, 525, 3428, 12.9, 1100},
-        {"Copenhagen", "Denmark", 0.8, 180, 4444, 7.5, 1800},
-        {"Dublin", "Ireland", 1.4, 115, 12174, 6.1, 2500},
-        {"Graz", "Austria", 0.29, 127, 2283, 6.4, 800},
-        {"Hamburg", "Germany", 1.9, 755, 2517, 15.5, 1200},
-        {"Helsinki", "Finland", 0.66, 215, 3070, 8.2, 1400},
-        {"Kiev", "Ukraine", 3.0, 839, 3575, 16.3, 900},
-        {"Linz", "Austria", 0.21, 96, 2187, 5.5, 700},
-        {"Lisbon", "Portugal", 2.9, 100, 29000, 5.6, 4200},
-        {"London", "UK", 9.0, 1572, 5724, 22.5, 3500},
-        {"Madrid", "Spain", 3.3, 604, 5464, 13.8, 2200},
-        {"Milan", "Italy", 1.4, 182, 7692, 7.6, 2800},
-        {"Moscow", "Russia", 12.5, 2511, 4978, 28.1, 2000},
-        {"Munich", "Germany", 1.5, 310, 4839, 9.9, 1900},
-        {"Oslo", "Norway", 0.7, 454, 1542, 12.0, 800},
-        {"Paris", "France", 2.2, 105, 20952, 5.8, 5500},
-        {"Prague", "Czech Rep.", 1.3, 496, 2621, 12.5, 1100},
-        {"Rome", "Italy", 4.3, 1285, 3345, 20.2, 1600},
-        {"Sofia", "Bulgaria", 1.3, 492, 2642, 12.5, 900},
-        {"Stockholm", "Sweden", 1.0, 188, 5319, 7.7, 1700},
-        {"Vienna", "Austria", 1.9, 415, 4579, 11.5, 1600},
-        {"Warsaw", "Poland", 1.8, 517, 3483, 12.8, 1400},
-        {"Zagreb", "Croatia", 0.8, 641, 1248, 14.2, 600},
-        {"Zurich", "Switzerland", 0.43, 88, 4886, 5.3, 2200}};
-
-    CityData selectedCity;
-
-    // Add density calculation based on distance from center
-    double calculateDensityAtDistance(double distance)
-    {
-        double cityRadius = selectedCity.radius;
-        double cityDensity = selectedCity.density;
-        double suburbanDensity = selectedCity.suburban_density;
-
-        if (distance <= cityRadius)
-        {
-            // Exponential density decrease within city
-            return cityDensity * exp(-distance / cityRadius);
+            if (parsed < 0)
+            {
+                std::cerr << "ranges: invalid option " << argv[i - 1] << "\n";
+                return 1;
+            }
+            continue;
         }
+
+        bool valid = i + 1 < argc;
+        if (valid && !strcmp(argv[i], "--yield"))
+            valid = parseSweepRange(argv[++i], spec.yield) && spec.yield.min > 0;
+        else if (valid && !strcmp(argv[i], "--height"))
+            valid = parseSweepRange(argv[++i], spec.height) && spec.height.min >= 0;
+        else if (valid && !strcmp(argv[i], "--psi"))
+            valid = parsePositiveList(argv[++i], spec.overpressures);
+        else if (valid && !strcmp(argv[i], "--cal"))
+            valid = parsePositiveList(argv[++i], spec.fluences);
+        else if (valid && !strcmp(argv[i], "--threads"))
+            threads = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
         else
+            valid = false;
+
+        if (!valid)
         {
-            // Suburban density with exponential falloff
-            return suburbanDensity * exp(-(distance - cityRadius) / (cityRadius * 0.5));
+            std::cerr << "ranges: invalid option " << argv[i] << "\n";
+            return 1;
         }
     }
-
-    // Add long-term effects to CasualtyEstimate
-    struct CasualtyEstimate
+    if (spec.atmosphere.groundElevation != 0 && spec.atmosphere.model != AtmosphereModel::Standard)
     {
-        double deaths;
-        double severeInjuries;
-        double lightInjuries;
-        double longTermDeaths1Year;
-        double longTermDeaths5Year;
-        double longTermDeaths10Year;
-        double longTermDeaths20Year;
-    };
+        std::cerr << "ranges: --elevation requires --atmosphere standard\n";
+        return 1;
+    }
+
+    WorkStealingPool pool(threads);
+    runThresholdSweep(spec, pool, std::cout);
+    return 0;
+}
 
-    // Update casualty calculation with long-term effects
-    CasualtyEstimate calculateCasualties(const WeaponEffects &effects)
+// Function to run the --index-population mode: copy a population raster with its row prefix sums
+int runIndexPopulationMode(int argc, char *argv[])
+{
+    if (argc != 4)
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+    PopulationRaster population;
+    std::string error;
+    if (!population.open(argv[2], error))
+    {
+        std::cerr << "index-population: " << error << "\n";
+        return 1;
+    }
+    std::ofstream file(argv[3], std::ios::binary | std::ios::trunc);
+    if (!file || !writePopulationIndex(file, population))
     {
-        CasualtyEstimate casualties = {0, 0, 0, 0, 0, 0, 0};
+        std::cerr << "index-population: error writing " << argv[3] << "\n";
+        return 1;
+    }
+    return 0;
+}
 
-        // Calculate casualties in concentric rings
-        const int RINGS = 20; // Number of calculation rings
-        double maxRadius = std::max({sqrt(effects.blast.lightArea / M_PI),
-                                     sqrt(effects.thermal.lightArea / M_PI),
-                                     sqrt(effects.radiation.lightArea / M_PI)});
+// Function to run the --compile-catalog mode: convert a catalog into a snapshot
+int runCompileCatalogMode(int argc, char *argv[])
+{
+    if (argc != 4)
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+    Catalog compiled;
+    std::string error;
+    if (!compiled.load(argv[2], error))
+    {
+        std::cerr << "compile-catalog: " << error << "\n";
+        return 1;
+    }
+    std::ofstream file(argv[3], std::ios::binary | std::ios::trunc);
+    if (!file || !compiled.writeSnapshot(file))
+    {
+        std::cerr << "compile-catalog: error writing " << argv[3] << "\n";
+        return 1;
+    }
+    return 0;
+}
 
-        for (int i = 0; i < RINGS; i++)
+// Function to run the --profile mode: overpressure and thermal curves over evenly spaced distances
+int runProfileMode(int argc, char *argv[])
+{
+    if (argc < 6)
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+    double yield = strtod(argv[2], nullptr);
+    double height = strtod(argv[3], nullptr);
+    double maxDistance = strtod(argv[4], nullptr);
+    long points = strtol(argv[5], nullptr, 10);
+    if (!(yield > 0) || height < 0 || !(maxDistance > 0) || points < 1)
+    {
+        std::cerr << "profile: invalid arguments\n";
+        return 1;
+    }
+    AtmosphereOptions atmosphereOptions;
+    for (int i = 6; i < argc; i++)
+    {
+        int parsed = parseAtmosphereOption(argc, argv, i, atmosphereOptions);
+        if (parsed <= 0)
         {
-            double innerRadius = (i * maxRadius) / RINGS;                                     // Calculate inner ring radius
-            double outerRadius = ((i + 1) * maxRadius) / RINGS;                               // Calculate outer ring radius
-            double ringArea = M_PI * (outerRadius * outerRadius - innerRadius * innerRadius); // Calculate ring area
-            double avgRadius = (innerRadius + outerRadius) / 2;                               // Calculate average radius
-            double density = calculateDensityAtDistance(avgRadius);                           // Calculate density at average radius
-
-            // Calculate effects for this ring
-            if (avgRadius <= sqrt(effects.blast.severeArea / M_PI))
-            {
-                casualties.deaths += ringArea * density * 0.9; // 90% mortality
-            }
-            else if (avgRadius <= sqrt(effects.blast.moderateArea / M_PI))
-            {
-                casualties.severeInjuries += ringArea * density * 0.5; // 50% severe injuries
-            }
-            else if (avgRadius <= sqrt(effects.blast.lightArea / M_PI))
-            {
-                casualties.lightInjuries += ringArea * density * 0.3; // 30% light injuries
-            }
-
-            // Add thermal effects
-            if (avgRadius <= sqrt(effects.thermal.severeArea / M_PI))
-            {
-                casualties.deaths += ringArea * density * 0.7; // 70% mortality
-            }
-            // ...similar calculations for moderate and light thermal effects...
-
-            // Add radiation effects
-            if (avgRadius <= sqrt(effects.radiation.severeArea / M_PI))
-            {
-                casualties.severeInjuries += ringArea * density * 0.8; // 80% severe injuries
-            }
-            // ...similar calculations for moderate radiation effects...
+            std::cerr << "profile: invalid option " << argv[parsed < 0 ? i - 1 : i] << "\n";
+            return 1;
         }
-
-        // Estimate long-term deaths based on radiation exposure - guesswork
-        double totalExposed = casualties.severeInjuries + casualties.lightInjuries; // Total exposed population
-        casualties.longTermDeaths1Year = totalExposed * 0.1;                        // 10% mortality in 1 year
-        casualties.longTermDeaths5Year = totalExposed * 0.2;                        // 20% mortality in 5 years
-        casualties.longTermDeaths10Year = totalExposed * 0.3;                       // 30% mortality in 10 years
-        casualties.longTermDeaths20Year = totalExposed * 0.4;                       // 40% mortality in 20 years
-
-        return casualties;
     }
+    if (atmosphereOptions.groundElevation != 0 && atmosphereOptions.model != AtmosphereModel::Standard)
+    {
+        std::cerr << "profile: --elevation requires --atmosphere standard\n";
+        return 1;
+    }
+    AtmosphereConditions atmosphere = makeAtmosphereConditions(atmosphereOptions, height);
 
-    // Function to display casualty estimates
-    void displayCasualties(const CasualtyEstimate &casualties)
+    std::vector<double> distances(points);
+    for (long i = 0; i < points; i++)
     {
-        std::cout << "\nEstimated Casualties in " << selectedCity.name << ":\n";
-        std::cout << "=====================================\n";
-        std::cout << "Fatalities: " << std::fixed << std::setprecision(0)
-                  << casualties.deaths << "\n";
-        std::cout << "Severe Injuries: " << casualties.severeInjuries << "\n";
-        std::cout << "Light Injuries: " << casualties.lightInjuries << "\n";
-        std::cout << "Total Casualties: "
-                  << (casualties.deaths + casualties.severeInjuries +
-                      casualties.lightInjuries)
-                  << "\n";
-        std::cout << "Long-Term Deaths (1 Year): " << casualties.longTermDeaths1Year << "\n";
-        std::cout << "Long-Term Deaths (5 Years): " << casualties.longTermDeaths5Year << "\n";
-        std::cout << "Long-Term Deaths (10 Years): " << casualties.longTermDeaths10Year << "\n";
-        std::cout << "Long-Term Deaths (20 Years): " << casualties.longTermDeaths20Year << "\n";
+        distances[i] = maxDistance * (i + 1) / points; // Skip ground zero itself
     }
+    std::vector<double> pressures = blastOverpressureProfile(yield, height, distances, atmosphere);
+    std::vector<double> fluence = thermalRadiationProfile(yield, height, distances, atmosphere);
 
-    // Function to select target city
-    void selectCity()
+    std::cout << "distance_m,overpressure_pa,thermal_j_m2\n";
+    char record[96];
+    for (long i = 0; i < points; i++)
     {
-        clearScreen();
-        printMenuHeader("Target City Selection");
+        int length = snprintf(record, sizeof(record), "%.3f,%.6g,%.6g\n", distances[i], pressures[i], fluence[i]);
+        std::cout.write(record, length);
+    }
+    return 0;
+}
 
-        for (size_t i = 0; i < CITIES.size(); i++)
+// Function to run the --series mode: shock front and thermal pulse at multiples of a time step
+int runSeriesMode(int argc, char *argv[])
+{
+    if (argc < 6)
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+    double yield = strtod(argv[2], nullptr);
+    double height = strtod(argv[3], nullptr);
+    double timeStep = strtod(argv[4], nullptr);
+    long samples = strtol(argv[5], nullptr, 10);
+    if (!(yield > 0) || height < 0 || !(timeStep > 0) || samples < 1)
+    {
+        std::cerr << "series: invalid arguments\n";
+        return 1;
+    }
+    AtmosphereOptions atmosphereOptions;
+    for (int i = 6; i < argc; i++)
+    {
+        int parsed = parseAtmosphereOption(argc, argv, i, atmosphereOptions);
+        if (parsed <= 0)
         {
-            std::cout << std::setw(2) << i + 1 << ". "
-                      << std::setw(15) << CITIES[i].name
-                      << "  " << std::setw(12) << CITIES[i].country
-                      << "  Pop: " << CITIES[i].population << "M\n";
+            std::cerr << "series: invalid option " << argv[parsed < 0 ? i - 1 : i] << "\n";
+            return 1;
         }
+    }
+    if (atmosphereOptions.groundElevation != 0 && atmosphereOptions.model != AtmosphereModel::Standard)
+    {
+        std::cerr << "series: --elevation requires --atmosphere standard\n";
+        return 1;
+    }
+    AtmosphereConditions atmosphere = makeAtmosphereConditions(atmosphereOptions, height);
 
-        printMenuDivider();
-        std::cout << "Enter city number: ";
-        int choice;
-        std::cin >> choice;
+    // Both series advance in lockstep, one sample per record; a reader that hangs up stops the computation
+    TimeSeries<BlastFrontModel> blast = blastFrontSeries(yield, height, timeStep, samples, atmosphere);
+    TimeSeries<ThermalPulseModel> thermal = thermalPulseSeries(yield, timeStep, samples);
+    auto front = blast.begin();
+    auto pulse = thermal.begin();
+    std::cout << "time_s,front_radius_m,overpressure_pa,front_speed_m_s,thermal_power_w,thermal_emitted\n";
+    char record[160];
+    for (; front != blast.end() && std::cout; ++front, ++pulse)
+    {
+        int length = snprintf(record, sizeof(record), "%.6g,%.3f,%.6g,%.6g,%.6g,%.6f\n", front->time, front->radius,
+                              front->overpressure, front->speed, pulse->power, pulse->emitted);
+        std::cout.write(record, length);
+    }
+    return 0;
+}
 
-        if (choice > 0 && choice <= CITIES.size())
+// Function to run the --sensitivity mode: blast, thermal and fallout outputs with their gradients
+int runSensitivityMode(int argc, char *argv[])
+{
+    if (argc < 6)
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+    SensitivityQuery query;
+    query.yield = strtod(argv[2], nullptr);
+    query.height = strtod(argv[3], nullptr);
+    query.windSpeed = strtod(argv[4], nullptr);
+    query.distance = strtod(argv[5], nullptr);
+    query.isAirburst = false;
+    if (!(query.yield > 0) || query.height < 0 || query.windSpeed < 0 || !(query.distance > 0))
+    {
+        std::cerr << "sensitivity: invalid arguments\n";
+        return 1;
+    }
+    AtmosphereOptions atmosphereOptions;
+    for (int i = 6; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--airburst"))
         {
-            selectedCity = CITIES[choice - 1];
+            query.isAirburst = true;
+            continue;
         }
-        else
+        int parsed = parseAtmosphereOption(argc, argv, i, atmosphereOptions);
+        if (parsed <= 0)
         {
-            selectedCity = CITIES[0]; // Default to London
+            std::cerr << "sensitivity: invalid option " << argv[parsed < 0 ? i - 1 : i] << "\n";
+            return 1;
         }
     }
-
-    // Function to set wind parameters
-    void setWindParameters()
+    if (atmosphereOptions.groundElevation != 0 && atmosphereOptions.model != AtmosphereModel::Standard)
     {
-        clearScreen();
-        printMenuHeader("Wind Parameters");
-
-        std::cout << "Enter wind speed (km/h): ";
-        std::cin >> windSpeed;
-
-        printMenuDivider();
+        std::cerr << "sensitivity: --elevation requires --atmosphere standard\n";
+        return 1;
     }
+    query.atmosphere = makeAtmosphereConditions(atmosphereOptions, query.height);
 
-public:
-    NuclearEffectsCalculator()
-        : yield(0), height(0), isAirburst(false),
-          windSpeed(0) {}
+    typedef SensitivityResultT<double>::Number Number;
+    SensitivityResultT<double> result = calculateSensitivity<double>(query);
+    const std::pair<const char *, const Number *> outputs[] = {
+        {"overpressure_pa", &result.overpressure},
+        {"thermal_j_m2", &result.thermalFluence},
+        {"fallout_distance_km", &result.fallout.maxDownwindDistance},
+        {"fallout_width_km", &result.fallout.maxWidth},
+        {"fallout_area_km2", &result.fallout.dangerousZoneArea},
+        {"fallout_angle_deg", &result.fallout.falloutAngle}};
 
-    // Function to set parameters for the calculation
-    void setParameters()
+    std::cout << "output,value";
+    for (const char *name : SENSITIVITY_INPUT_NAMES)
     {
-        displayPresets();
-        std::cout << "\nSelect weapon (1-" << PRESETS.size() + 1 << "): ";
-        int choice;
-        std::cin >> choice;
+        std::cout << ",d_" << name;
+    }
+    std::cout << "\n";
+    char field[32];
+    for (const auto &output : outputs)
+    {
+        std::cout << output.first;
+        snprintf(field, sizeof(field), ",%.9g", output.second->value);
+        std::cout << field;
+        for (double derivative : output.second->gradient)
+        {
+            snprintf(field, sizeof(field), ",%.9g", derivative);
+            std::cout << field;
+        }
+        std::cout << "\n";
+    }
+    return 0;
+}
 
-        if (choice <= PRESETS.size())
+// Function to run the --serve mode: answer requests over a socket until SIGINT or SIGTERM
+int runServeMode(int argc, char *argv[])
+{
+#ifdef _WIN32
+    (void)argc;
+    std::cerr << "serve: not supported on this platform\n";
+    return 1;
+#else
+    EvaluationOptions options;
+    ServerOptions settings;
+    for (int i = 3; i < argc; i++)
+    {
+        const char *option = argv[i];
+        int parsed = parseEvaluationOption(argc, argv, i, options);
+        if (parsed == 0 && i + 1 < argc)
         {
-            const auto &preset = PRESETS[choice - 1];
-            yield = preset.yield;
-            isAirburst = preset.isAirburst;
-            height = preset.typicalHeight;
-            std::cout << "\nSelected: " << preset.name << " (" << preset.type << ")\n";
+            parsed = 1;
+            if (!strcmp(option, "--threads"))
+                settings.threads = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+            else if (!strcmp(option, "--max-batch"))
+                settings.maxBatch = strtoul(argv[++i], nullptr, 10);
+            else if (!strcmp(option, "--batch-window"))
+                settings.batchWindow = std::chrono::microseconds(strtol(argv[++i], nullptr, 10));
+            else
+                parsed = 0;
         }
-        else
+        if (parsed <= 0 || settings.maxBatch < 1 || settings.batchWindow.count() < 0)
         {
-            std::cout << "Enter yield (MT): ";
-            std::cin >> yield;
-
-            std::cout << "Select detonation type:\n";
-            std::cout << "1. Ground burst\n2. Air burst\n";
-            std::cin >> choice;
-            isAirburst = (choice == 2);
-
-            if (isAirburst)
-            {
-                std::cout << "Enter height of burst (meters): ";
-                std::cin >> height;
-            }
+            std::cerr << "serve: invalid option " << option << "\n";
+            return 1;
         }
-
-        setBurstParameters(); // Add burst parameter selection
-
-        selectCity(); // Add city selection
-
-        setWindParameters(); // Add wind parameters
     }
 
-    // Function to calculate weapon effects
-    WeaponEffects calculateEffects()
+    ScenarioServer server(options, settings);
+    std::string error;
+    if (!server.listen(argv[2], error))
     {
-        WeaponEffects effects;
-        long double E = yield * 4.184e15;
+        std::cerr << "serve: " << error << "\n";
+        return 1;
+    }
 
-        // Updated scaling factors
-        long double blastScaling = pow(yield, 1.0L / 3.0L); // Cube root scaling
-        long double thermalScaling = pow(yield, 0.4L);      // Thermal scaling
-        long double radiationScaling = pow(yield, 0.19L);   // Radiation scaling
+    std::signal(SIGPIPE, SIG_IGN); // Closed clients show up as failed sends
+    serverSignalFd = server.stopFd();
+    std::signal(SIGINT, stopServerOnSignal);
+    std::signal(SIGTERM, stopServerOnSignal);
+    std::cerr << "serve: listening on " << server.address() << std::endl;
 
-        // Calculate blast effects (in meters)
-        effects.blast = {
-            2000.0 * blastScaling, // Severe damage radius (20 psi)
-            3000.0 * blastScaling, // Moderate damage radius (10 psi)
-            4500.0 * blastScaling, // Light damage radius (5 psi)
-            calculateArea(2000.0 * blastScaling),
-            calculateArea(3000.0 * blastScaling),
-            calculateArea(4500.0 * blastScaling)};
+    server.run();
 
-        // Calculate thermal effects (in meters)
-        effects.thermal = {
-            1200.0 * thermalScaling, // Severe burns radius
-            1800.0 * thermalScaling, // Moderate burns radius
-            2400.0 * thermalScaling, // Light burns radius
-            calculateArea(1200.0 * thermalScaling),
-            calculateArea(1800.0 * thermalScaling),
-            calculateArea(2400.0 * thermalScaling)};
+    serverSignalFd = -1;
+    std::cerr << "serve: " << server.requestsServed() << " requests, " << server.requestsRejected() << " rejected\n";
+    return 0;
+#endif
+}
 
-        // Calculate radiation effects (in meters)
-        effects.radiation = {
-            800.0 * radiationScaling,  // Lethal dose radius
-            1200.0 * radiationScaling, // Severe effects radius
-            1600.0 * radiationScaling, // Light effects radius
-            calculateArea(800.0 * radiationScaling),
-            calculateArea(1200.0 * radiationScaling),
-            calculateArea(1600.0 * radiationScaling)};
-
-        // Apply height of burst effects
-        if (height > 0)
+// Function to run the --batch mode
+int runBatchMode(int argc, char *argv[])
+{
+    EvaluationOptions options;
+    OutputOptions output;
+    unsigned threads = 0;
+    for (int i = 3; i < argc; i++)
+    {
+        const char *option = argv[i];
+        int parsed = parseEvaluationOption(argc, argv, i, options);
+        if (parsed == 0)
+            parsed = parseOutputOption(argc, argv, i, output);
+        if (parsed == 0 && i + 1 < argc && !strcmp(option, "--threads"))
         {
-            applyHeightEffects(effects, height);
+            threads = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+            parsed = 1;
+        }
+        if (parsed <= 0)
+        {
+            std::cerr << "batch: invalid option " << option << "\n";
+            return 1;
         }
-
-        effects.fallout = calculateFallout();
-        return effects;
     }
 
-    // Function to display results
-    void displayResults(const WeaponEffects &effects)
+    const char *path = argv[2];
+    std::ifstream file;
+    if (strcmp(path, "-"))
     {
-        // Clear screen before displaying results
-        clearScreen();
-
-        std::cout << "\nCalculated Effects:\n";
-        std::cout << std::string(78, '=') << "\n";
-
-        // Weapon Info
-        std::cout << "Weapon Data | ";
-        std::cout << "Yield: " << std::setw(6) << yield << " MT | ";
-        std::cout << "Type: " << (isAirburst ? "Air burst" : "Ground burst");
-        if (isAirburst)
+        file.open(path);
+        if (!file)
         {
-            std::cout << " | Height: " << height << "m";
+            std::cerr << "batch: cannot open " << path << "\n";
+            return 1;
         }
-        std::cout << "\n"
-                  << std::string(78, '-') << "\n";
+    }
+    std::istream &in = strcmp(path, "-") ? file : std::cin;
 
-        // Effects Data
-        displayEffectLevel("Thermal", effects.thermal);
-        std::cout << std::string(78, '-') << "\n";
-        displayEffectLevel("Blast", effects.blast);
-        std::cout << std::string(78, '-') << "\n";
-        displayEffectLevel("Radiation", effects.radiation);
-        std::cout << std::string(78, '-') << "\n";
+    return withResultWriter(output, "batch", [&](ResultWriter &writer)
+                            { return runBatchStream(in, writer, options, threads) == 0 ? 0 : 2; });
+}
 
-        // Fallout Information
-        std::cout << "Fallout Data | ";
-        std::cout << "Wind Speed: " << std::setw(3) << windSpeed << " km/h | ";
-        std::cout << "Max Distance: " << std::setw(5) << effects.fallout.maxDownwindDistance << " km\n";
-        std::cout << "Width: " << effects.fallout.maxWidth << " km | ";
-        std::cout << "Fallout Zone: " << effects.fallout.dangerousZoneArea << " km²\n";
-        std::cout << std::string(78, '-') << "\n";
+int main(int argc, char *argv[])
+{
+    std::ios::sync_with_stdio(false); // Batch output goes through std::cout only
 
-        // Casualties
-        CasualtyEstimate casualties = calculateCasualties(effects);
-        displayCasualties(casualties);
-        std::cout << std::string(78, '=') << "\n";
+#ifdef NUCCALC_INSTRUMENT
+    InstrumentationRegistry::instance(); // Constructed before the handler is registered, so it outlives it
+    std::atexit([] { printInstrumentation(std::cerr, instrumentationSnapshot()); });
+#endif
+
+    Catalog loaded; // Replaces the built-in tables with --catalog
+    if (argc >= 3 && !strcmp(argv[1], "--catalog"))
+    {
+        std::string error;
+        if (!loaded.load(argv[2], error))
+        {
+            std::cerr << "catalog: " << error << "\n";
+            return 1;
+        }
+        useCatalog(loaded);
+        argv[2] = argv[0]; // Drop the option, the modes parse from argv[1]
+        argv += 2;
+        argc -= 2;
     }
-};
 
-int main()
-{
     NuclearEffectsCalculator calculator;
+
+    if (argc >= 3 && !strcmp(argv[1], "--batch"))
+    {
+        return runBatchMode(argc, argv);
+    }
+    if (argc >= 2 && !strcmp(argv[1], "--sweep"))
+    {
+        return runSweepMode(argc, argv);
+    }
+    if (argc >= 2 && !strcmp(argv[1], "--profile"))
+    {
+        return runProfileMode(argc, argv);
+    }
+    if (argc >= 2 && !strcmp(argv[1], "--series"))
+    {
+        return runSeriesMode(argc, argv);
+    }
+    if (argc >= 2 && !strcmp(argv[1], "--sensitivity"))
+    {
+        return runSensitivityMode(argc, argv);
+    }
+    if (argc >= 2 && !strcmp(argv[1], "--raster"))
+    {
+        return runRasterMode(argc, argv);
+    }
+    if (argc >= 2 && !strcmp(argv[1], "--ranges"))
+    {
+        return runRangesMode(argc, argv);
+    }
+    if (argc >= 2 && !strcmp(argv[1], "--index-population"))
+    {
+        return runIndexPopulationMode(argc, argv);
+    }
+    if (argc >= 2 && !strcmp(argv[1], "--ensemble"))
+    {
+        return runEnsembleMode(argc, argv);
+    }
+    if (argc >= 3 && !strcmp(argv[1], "--serve"))
+    {
+        return runServeMode(argc, argv);
+    }
+    if (argc >= 2 && !strcmp(argv[1], "--compile-catalog"))
+    {
+        return runCompileCatalogMode(argc, argv);
+    }
+    if (argc != 1)
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
     calculator.setParameters();
     WeaponEffects effects = calculator.calculateEffects();
     calculator.displayResults(effects);
     return 0;
 }
+
+#endif // NUCCALC_NO_MAIN
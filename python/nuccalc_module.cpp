@@ -0,0 +1,680 @@
+/*******************************************************************************
+ * Nuclear Weapons Effects Calculator - Python bindings
+ *
+ * CPython extension module over evaluateScenariosWith(). evaluate() reads its
+ * inputs in place through the buffer protocol (NumPy arrays, array.array,
+ * memoryviews, or scalars broadcast to every scenario) and returns a Results
+ * object that exports the ResultRow array itself as a buffer of structured
+ * records, so np.asarray() views it without a copy. The GIL is released while
+ * the scenarios are read and evaluated on all cores.
+ *
+ * Build (from the repository root):
+ *   g++ -std=c++17 -O2 -march=native -pthread -shared -fPIC $(python3-config --includes) \
+ *       python/nuccalc_module.cpp -o nuccalc$(python3-config --extension-suffix)
+ *
+ * Usage:
+ *   import numpy as np, nuccalc
+ *   rows = np.asarray(nuccalc.evaluate(np.geomspace(0.01, 10, 1000), 500.0, 10.0, "London"))
+ *   rows["blast_severe_m"], rows["deaths"]
+ ******************************************************************************/
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h> // Must come first
+
+#define NUCCALC_NO_MAIN
+#include "../nuccalc.cpp"
+
+/*******************************************************************************
+ * Results
+ ******************************************************************************/
+
+// Function to build the PEP 3118 format of ResultRow: named fields in memory order, padding as 'x'
+static const std::string &resultFormat()
+{
+    static const std::string format = []
+    {
+        std::array<ResultColumn, RESULT_COLUMNS.size()> columns = RESULT_COLUMNS;
+        std::sort(columns.begin(), columns.end(),
+                  [](const ResultColumn &a, const ResultColumn &b) { return a.offset < b.offset; });
+
+        std::string text = "T{";
+        size_t offset = 0;
+        auto pad = [&](size_t to)
+        {
+            if (to > offset)
+                text += std::to_string(to - offset) + "x";
+            offset = to;
+        };
+        for (const ResultColumn &column : columns)
+        {
+            pad(column.offset);
+            text += column.type == ColumnType::Float64 ? "=d" : column.type == ColumnType::City ? "=I" : "?";
+            text.append(":").append(column.name).append(":");
+            offset += columnWidth(column.type);
+        }
+        pad(sizeof(ResultRow));
+        return text + "}";
+    }();
+    return format;
+}
+
+// Python object owning the rows of one evaluate() call
+struct ResultsObject
+{
+    PyObject_HEAD
+    std::vector<ResultRow> *rows;
+    Py_ssize_t shape[1];
+    Py_ssize_t strides[1];
+};
+
+static void resultsDealloc(ResultsObject *self)
+{
+    delete self->rows;
+    Py_TYPE(self)->tp_free(reinterpret_cast<PyObject *>(self));
+}
+
+static Py_ssize_t resultsLength(ResultsObject *self)
+{
+    return static_cast<Py_ssize_t>(self->rows->size());
+}
+
+// Function to export the rows as a read-only one-dimensional buffer of records
+static int resultsGetBuffer(ResultsObject *self, Py_buffer *view, int flags)
+{
+    if (flags & PyBUF_WRITABLE)
+    {
+        PyErr_SetString(PyExc_BufferError, "nuccalc results are read-only");
+        view->obj = nullptr;
+        return -1;
+    }
+    self->shape[0] = static_cast<Py_ssize_t>(self->rows->size());
+    self->strides[0] = sizeof(ResultRow);
+
+    view->buf = self->rows->data();
+    view->obj = reinterpret_cast<PyObject *>(self);
+    Py_INCREF(self);
+    view->len = self->shape[0] * static_cast<Py_ssize_t>(sizeof(ResultRow));
+    view->readonly = 1;
+    view->itemsize = sizeof(ResultRow);
+    view->format = (flags & PyBUF_FORMAT) ? const_cast<char *>(resultFormat().c_str()) : nullptr;
+    view->ndim = 1;
+    view->shape = (flags & PyBUF_ND) ? self->shape : nullptr;
+    view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? self->strides : nullptr;
+    view->suboffsets = nullptr;
+    view->internal = nullptr;
+    return 0;
+}
+
+// Type slots, filled in by PyInit_nuccalc()
+static PySequenceMethods resultsSequence = {};
+static PyBufferProcs resultsBuffer = {};
+static PyTypeObject ResultsType = {};
+
+/*******************************************************************************
+ * Inputs
+ ******************************************************************************/
+
+// One evaluate() argument: a one-dimensional buffer read in place, or a scalar for every scenario
+class InputColumn
+{
+private:
+    Py_buffer view = {};
+    bool isBuffer = false;
+    char type = 'd';      // struct format character of the buffer
+    double scalar = 0;    // Scalar numbers
+    size_t cityIndex = 0; // Scalar cities
+
+public:
+    InputColumn() = default;
+    InputColumn(const InputColumn &) = delete;
+    InputColumn &operator=(const InputColumn &) = delete;
+
+    ~InputColumn()
+    {
+        if (isBuffer)
+            PyBuffer_Release(&view);
+    }
+
+    // Function to take a number or a buffer of numbers, returns false with a Python error set on failure
+    bool open(PyObject *object, const char *name)
+    {
+        if (PyFloat_Check(object) || PyLong_Check(object))
+        {
+            scalar = PyFloat_AsDouble(object);
+            return !PyErr_Occurred();
+        }
+        return openBuffer(object, name, "dfbBhHiIlLqQ?");
+    }
+
+    // Function to take a city (name or 0-based index) or a buffer of indices
+    bool openCity(PyObject *object)
+    {
+        if (PyUnicode_Check(object))
+        {
+            const char *text = PyUnicode_AsUTF8(object);
+            if (!text)
+                return false;
+            cityIndex = catalog().findCity(text);
+            if (cityIndex >= catalog().cities().size())
+            {
+                PyErr_Format(PyExc_ValueError, "unknown city %s", text);
+                return false;
+            }
+            return true;
+        }
+        if (PyLong_Check(object))
+        {
+            long long index = PyLong_AsLongLong(object);
+            if (PyErr_Occurred())
+                return false;
+            if (index < 0 || static_cast<unsigned long long>(index) >= catalog().cities().size())
+            {
+                PyErr_Format(PyExc_ValueError, "city index %lld out of range", index);
+                return false;
+            }
+            cityIndex = static_cast<size_t>(index);
+            return true;
+        }
+        return openBuffer(object, "cities", "bBhHiIlLqQ");
+    }
+
+    // Function to open a buffer whose element format is one of types
+    bool openBuffer(PyObject *object, const char *name, const char *types)
+    {
+        if (PyObject_GetBuffer(object, &view, PyBUF_STRIDES | PyBUF_FORMAT) != 0)
+        {
+            PyErr_Format(PyExc_TypeError, "%s must be a number or a one-dimensional array of numbers", name);
+            return false;
+        }
+        isBuffer = true;
+
+        const char *format = view.format ? view.format : "B";
+        if (*format == '@' || *format == '=' || (*format == '<' && PY_LITTLE_ENDIAN) || (*format == '>' && PY_BIG_ENDIAN))
+            format++;
+        if (view.ndim > 1 || format[0] == '\0' || format[1] != '\0' || !strchr(types, format[0]))
+        {
+            PyErr_Format(PyExc_TypeError, "%s must be a number or a one-dimensional array of numbers", name);
+            return false;
+        }
+        type = format[0];
+
+        if (view.ndim == 0) // NumPy scalars: read the one value
+        {
+            Py_ssize_t zero = 0;
+            view.strides = &zero;
+            scalar = (*this)[0];
+            cityIndex = scalar >= 0 ? static_cast<size_t>(scalar) : SIZE_MAX;
+            PyBuffer_Release(&view);
+            isBuffer = false;
+        }
+        return true;
+    }
+
+    bool array() const { return isBuffer; }
+    size_t size() const { return static_cast<size_t>(view.shape[0]); }
+
+    // Function to read element i as a double; scalars ignore i
+    double operator[](size_t i) const
+    {
+        if (!isBuffer)
+            return scalar;
+        const char *item = static_cast<const char *>(view.buf) + static_cast<Py_ssize_t>(i) * view.strides[0];
+        switch (type)
+        {
+        case 'd': return load<double>(item);
+        case 'f': return load<float>(item);
+        case 'b': return load<signed char>(item);
+        case 'B': return load<unsigned char>(item);
+        case '?': return load<bool>(item);
+        case 'h': return load<short>(item);
+        case 'H': return load<unsigned short>(item);
+        case 'i': return load<int>(item);
+        case 'I': return load<unsigned int>(item);
+        case 'l': return double(load<long>(item));
+        case 'L': return double(load<unsigned long>(item));
+        case 'q': return double(load<long long>(item));
+        default: return double(load<unsigned long long>(item));
+        }
+    }
+
+    // Function to read element i as a city index; scalars ignore i
+    size_t city(size_t i) const
+    {
+        if (!isBuffer)
+            return cityIndex;
+        double value = (*this)[i];
+        return value >= 0 ? static_cast<size_t>(value) : SIZE_MAX;
+    }
+
+private:
+    template <typename T>
+    static T load(const char *item)
+    {
+        T value;
+        memcpy(&value, item, sizeof(T)); // Strided buffers need not be aligned
+        return value;
+    }
+};
+
+/*******************************************************************************
+ * Evaluation state
+ *
+ * The result cache of the cache= option and the raster of population= outlive
+ * an evaluate() call. The next call reuses them while its options are the same
+ * and the raster file has not changed, so queries repeated over several calls
+ * hit the cache; a call with other options replaces them. Calls running at the
+ * same time share a state through shared_ptr, and EffectsCache is safe to use
+ * from several threads.
+ ******************************************************************************/
+
+// Options, population raster and result cache of evaluate() calls
+struct EvaluationState
+{
+    EvaluationOptions options;                      // Owns the raster of options.model.population
+    std::string populationPath;                     // Empty without a raster
+    std::filesystem::file_time_type populationTime; // Of the raster file when it was opened
+    uintmax_t populationSize = 0;
+    std::unique_ptr<EffectsCache<float>> floatCache; // Only the cache of options.precision is made
+    std::unique_ptr<EffectsCache<double>> doubleCache;
+    std::unique_ptr<EffectsCache<long double>> longDoubleCache;
+
+    // Function to get the result cache of precision Real, null without one
+    template <typename Real>
+    EffectsCache<Real> *cache() const
+    {
+        if constexpr (std::is_same<Real, float>::value)
+            return floatCache.get();
+        else if constexpr (std::is_same<Real, double>::value)
+            return doubleCache.get();
+        else
+            return longDoubleCache.get();
+    }
+};
+
+static std::shared_ptr<EvaluationState> lastState; // Only accessed with the GIL held
+
+// Function to compare the options the results of a state depend on, apart from the raster
+static bool sameOptions(const EvaluationOptions &a, const EvaluationOptions &b)
+{
+    return a.precision == b.precision && a.model.casualtyMethod == b.model.casualtyMethod &&
+           a.model.casualtyRings == b.model.casualtyRings && a.model.casualtyTolerance == b.model.casualtyTolerance &&
+           a.model.yieldScaling == b.model.yieldScaling && a.cache.capacity == b.cache.capacity &&
+           a.cache.yieldQuantum == b.cache.yieldQuantum && a.cache.heightQuantum == b.cache.heightQuantum &&
+           a.cache.windQuantum == b.cache.windQuantum;
+}
+
+// Function to get the state of options and a raster path (empty for none), the last one while it matches
+// Returns null with a Python exception set if the raster cannot be opened
+static std::shared_ptr<EvaluationState> acquireState(const EvaluationOptions &options, const std::string &populationPath)
+{
+    std::error_code failure;
+    std::filesystem::file_time_type populationTime;
+    uintmax_t populationSize = 0;
+    if (!populationPath.empty())
+    {
+        populationTime = std::filesystem::last_write_time(populationPath, failure);
+        if (!failure)
+            populationSize = std::filesystem::file_size(populationPath, failure);
+    }
+    if (lastState && sameOptions(lastState->options, options) && lastState->populationPath == populationPath &&
+        !failure && lastState->populationTime == populationTime && lastState->populationSize == populationSize)
+        return lastState;
+
+    std::shared_ptr<EvaluationState> state = std::make_shared<EvaluationState>();
+    state->options = options;
+    state->populationPath = populationPath;
+    state->populationTime = populationTime;
+    state->populationSize = populationSize;
+    if (!populationPath.empty())
+    {
+        std::shared_ptr<PopulationRaster> population = std::make_shared<PopulationRaster>();
+        std::string error;
+        if (!population->open(populationPath.c_str(), error))
+        {
+            PyErr_SetString(PyExc_OSError, error.c_str());
+            return nullptr;
+        }
+        state->options.population = population;
+        state->options.model.population = population.get();
+    }
+    if (options.cache.capacity > 0)
+    {
+        const ModelOptions &model = state->options.model;
+        switch (options.precision)
+        {
+        case Precision::Float:
+            state->floatCache.reset(new EffectsCache<float>(options.cache, model));
+            break;
+        case Precision::Double:
+            state->doubleCache.reset(new EffectsCache<double>(options.cache, model));
+            break;
+        case Precision::LongDouble:
+            state->longDoubleCache.reset(new EffectsCache<long double>(options.cache, model));
+            break;
+        }
+    }
+    lastState = state;
+    return state;
+}
+
+/*******************************************************************************
+ * Module functions
+ ******************************************************************************/
+
+// Function to find text in the names of an option's values, returns false with a Python error set if absent
+template <typename Value, size_t N>
+static bool parseChoice(const char *keyword, PyObject *object, const std::pair<const char *, Value> (&choices)[N],
+                        Value &value)
+{
+    const char *text = PyUnicode_Check(object) ? PyUnicode_AsUTF8(object) : nullptr;
+    for (size_t i = 0; text && i < N; i++)
+    {
+        if (!strcmp(text, choices[i].first))
+        {
+            value = choices[i].second;
+            return true;
+        }
+    }
+    if (!PyErr_Occurred())
+        PyErr_Format(PyExc_ValueError, "invalid %s", keyword);
+    return false;
+}
+
+// Function to apply one evaluation option keyword of evaluate(), with the values of the --batch options
+// cache is a capacity or a (capacity, yield_quantum, height_quantum_m, wind_quantum_kmh) tuple;
+// population sets populationPath, the raster is opened with the evaluation state
+static bool parseKeywordOption(const char *keyword, PyObject *value, EvaluationOptions &options,
+                               std::string &populationPath)
+{
+    static const std::pair<const char *, Precision> PRECISIONS[] = {
+        {"float", Precision::Float}, {"double", Precision::Double}, {"long-double", Precision::LongDouble}};
+    static const std::pair<const char *, CasualtyMethod> METHODS[] = {
+        {"rings", CasualtyMethod::Rings}, {"adaptive", CasualtyMethod::Adaptive}, {"analytic", CasualtyMethod::Analytic}};
+    static const std::pair<const char *, YieldScaling> SCALINGS[] = {
+        {"exact", YieldScaling::Exact}, {"tabulated", YieldScaling::Tabulated}};
+
+    if (!strcmp(keyword, "precision"))
+        return parseChoice(keyword, value, PRECISIONS, options.precision);
+    if (!strcmp(keyword, "casualties"))
+        return parseChoice(keyword, value, METHODS, options.model.casualtyMethod);
+    if (!strcmp(keyword, "scaling"))
+        return parseChoice(keyword, value, SCALINGS, options.model.yieldScaling);
+    if (!strcmp(keyword, "rings"))
+    {
+        long rings = PyLong_AsLong(value);
+        if (PyErr_Occurred())
+            return false;
+        options.model.casualtyRings = static_cast<int>(rings);
+        if (rings > 0 && rings <= INT_MAX)
+            return true;
+    }
+    else if (!strcmp(keyword, "tolerance"))
+    {
+        options.model.casualtyTolerance = PyFloat_AsDouble(value);
+        if (PyErr_Occurred())
+            return false;
+        if (options.model.casualtyTolerance > 0)
+            return true;
+    }
+    else if (!strcmp(keyword, "cache"))
+    {
+        long long capacity = 0;
+        CacheOptions &cache = options.cache;
+        if (PyTuple_Check(value))
+        {
+            if (!PyArg_ParseTuple(value, "Lddd", &capacity, &cache.yieldQuantum, &cache.heightQuantum, &cache.windQuantum))
+                return false;
+        }
+        else if ((capacity = PyLong_AsLongLong(value)) == -1 && PyErr_Occurred())
+            return false;
+        cache.capacity = capacity > 0 ? static_cast<size_t>(capacity) : 0;
+        if (capacity > 0 && cache.yieldQuantum >= 0 && cache.heightQuantum >= 0 && cache.windQuantum >= 0)
+            return true;
+    }
+    else if (!strcmp(keyword, "population"))
+    {
+        PyObject *path = PyOS_FSPath(value);
+        PyObject *bytes = path ? PyUnicode_EncodeFSDefault(path) : nullptr;
+        Py_XDECREF(path);
+        if (!bytes)
+            return false;
+        populationPath.assign(PyBytes_AS_STRING(bytes), static_cast<size_t>(PyBytes_GET_SIZE(bytes)));
+        Py_DECREF(bytes);
+        if (!populationPath.empty())
+            return true;
+    }
+    else
+    {
+        PyErr_Format(PyExc_TypeError, "evaluate() got an unexpected keyword argument '%s'", keyword);
+        return false;
+    }
+
+    PyErr_Format(PyExc_ValueError, "invalid %s", keyword);
+    return false;
+}
+
+// evaluate(yields, heights, winds, cities, airburst=None, threads=0, **options) -> Results
+static PyObject *evaluate(PyObject *, PyObject *args, PyObject *kwargs)
+{
+    PyObject *objects[4];
+    PyObject *airburstObject = Py_None;
+    unsigned threads = 0;
+    if (!PyArg_ParseTuple(args, "OOOO|O", &objects[0], &objects[1], &objects[2], &objects[3], &airburstObject))
+        return nullptr;
+
+    EvaluationOptions options;
+    std::string populationPath;
+    PyObject *key, *value;
+    Py_ssize_t position = 0;
+    while (kwargs && PyDict_Next(kwargs, &position, &key, &value))
+    {
+        const char *keyword = PyUnicode_AsUTF8(key);
+        if (!keyword)
+            return nullptr;
+        if (!strcmp(keyword, "airburst"))
+            airburstObject = value;
+        else if (!strcmp(keyword, "threads"))
+        {
+            long count = PyLong_AsLong(value);
+            if (count < 0 || PyErr_Occurred())
+                return PyErr_Occurred() ? nullptr : PyErr_Format(PyExc_ValueError, "threads must not be negative");
+            threads = static_cast<unsigned>(count);
+        }
+        else if (!parseKeywordOption(keyword, value, options, populationPath))
+            return nullptr;
+    }
+
+    InputColumn yields, heights, winds, cities, airburst;
+    if (!yields.open(objects[0], "yields") || !heights.open(objects[1], "heights") ||
+        !winds.open(objects[2], "winds") || !cities.openCity(objects[3]) ||
+        (airburstObject != Py_None && !airburst.open(airburstObject, "airburst")))
+        return nullptr;
+
+    // Arrays must agree in length, scalars stretch to it
+    size_t count = 1;
+    bool sized = false;
+    for (const InputColumn *column : {&yields, &heights, &winds, &cities, &airburst})
+    {
+        if (!column->array())
+            continue;
+        if (sized && column->size() != count)
+            return PyErr_Format(PyExc_ValueError, "input arrays differ in length (%zu and %zu)", count, column->size());
+        count = column->size();
+        sized = true;
+    }
+
+    std::shared_ptr<EvaluationState> state = acquireState(options, populationPath);
+    if (!state)
+        return nullptr;
+
+    std::unique_ptr<std::vector<ResultRow>> rows(new std::vector<ResultRow>());
+    size_t invalid = SIZE_MAX;
+    const char *problem = nullptr;
+
+    Py_BEGIN_ALLOW_THREADS
+    try
+    {
+        std::vector<Scenario> scenarios(count);
+        const size_t cityCount = catalog().cities().size();
+        for (size_t i = 0; i < count && !problem; i++)
+        {
+            Scenario &scenario = scenarios[i];
+            scenario.yield = yields[i];
+            scenario.height = heights[i];
+            scenario.windSpeed = winds[i];
+            scenario.cityIndex = cities.city(i);
+            scenario.isAirburst = airburstObject == Py_None ? scenario.height > 0 : airburst[i] != 0;
+            // Same checks as a batch line
+            if (!(scenario.yield > 0))
+                problem = "yield must be positive";
+            else if (!(scenario.height >= 0))
+                problem = "height must not be negative";
+            else if (!(scenario.windSpeed >= 0))
+                problem = "wind speed must not be negative";
+            else if (scenario.cityIndex >= cityCount)
+                problem = "city index out of range";
+            if (problem)
+                invalid = i;
+        }
+        if (!problem)
+        {
+            rows->resize(count);
+            WorkStealingPool pool(count > 256 ? threads : 1);
+            const EvaluationOptions &stateOptions = state->options;
+            switch (stateOptions.precision)
+            {
+            case Precision::Float:
+                evaluateScenariosWith<float>(scenarios.data(), count, rows->data(), stateOptions, pool,
+                                             state->cache<float>());
+                break;
+            case Precision::Double:
+                evaluateScenariosWith<double>(scenarios.data(), count, rows->data(), stateOptions, pool,
+                                              state->cache<double>());
+                break;
+            case Precision::LongDouble:
+                evaluateScenariosWith<long double>(scenarios.data(), count, rows->data(), stateOptions, pool,
+                                                   state->cache<long double>());
+                break;
+            }
+        }
+    }
+    catch (const std::bad_alloc &)
+    {
+        problem = "out of memory";
+    }
+    Py_END_ALLOW_THREADS
+
+    if (problem)
+    {
+        if (invalid == SIZE_MAX)
+            return PyErr_NoMemory();
+        return PyErr_Format(PyExc_ValueError, "scenario %zu: %s", invalid, problem);
+    }
+
+    ResultsObject *results = PyObject_New(ResultsObject, &ResultsType);
+    if (!results)
+        return nullptr;
+    results->rows = rows.release();
+    return reinterpret_cast<PyObject *>(results);
+}
+
+// cities() -> list of (name, country, population_millions, area_km2) in index order
+static PyObject *cities(PyObject *, PyObject *)
+{
+    const std::vector<CityData> &list = catalog().cities();
+    PyObject *result = PyList_New(static_cast<Py_ssize_t>(list.size()));
+    for (size_t i = 0; result && i < list.size(); i++)
+    {
+        const CityData &city = list[i];
+        PyObject *entry = Py_BuildValue("(s#s#dd)", city.name.data(), static_cast<Py_ssize_t>(city.name.size()),
+                                        city.country.data(), static_cast<Py_ssize_t>(city.country.size()),
+                                        city.population, city.area);
+        if (!entry)
+        {
+            Py_DECREF(result);
+            return nullptr;
+        }
+        PyList_SET_ITEM(result, static_cast<Py_ssize_t>(i), entry);
+    }
+    return result;
+}
+
+// presets() -> list of (name, type, yield_mt, airburst, height_m)
+static PyObject *presets(PyObject *, PyObject *)
+{
+    const std::vector<WeaponPreset> &list = catalog().presets();
+    PyObject *result = PyList_New(static_cast<Py_ssize_t>(list.size()));
+    for (size_t i = 0; result && i < list.size(); i++)
+    {
+        const WeaponPreset &preset = list[i];
+        PyObject *entry = Py_BuildValue("(s#s#dOd)", preset.name.data(), static_cast<Py_ssize_t>(preset.name.size()),
+                                        preset.type.data(), static_cast<Py_ssize_t>(preset.type.size()), preset.yield,
+                                        preset.isAirburst ? Py_True : Py_False, preset.typicalHeight);
+        if (!entry)
+        {
+            Py_DECREF(result);
+            return nullptr;
+        }
+        PyList_SET_ITEM(result, static_cast<Py_ssize_t>(i), entry);
+    }
+    return result;
+}
+
+static PyMethodDef methods[] = {
+    {"evaluate", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(evaluate)), METH_VARARGS | METH_KEYWORDS,
+     "evaluate(yields, heights, winds, cities, airburst=None, threads=0, **options) -> Results\n\n"
+     "Evaluate one scenario per element. Each input is a one-dimensional array or a scalar for every\n"
+     "scenario; cities are 0-based catalog indices or a city name. airburst defaults to height > 0.\n"
+     "options are the evaluation options of --batch: precision, casualties, rings, tolerance, scaling,\n"
+     "cache (a capacity or a (capacity, yield_quantum, height_quantum_m, wind_quantum_kmh) tuple) and\n"
+     "population (a raster path). The cache and the raster are kept for the next call with the same options,\n"
+     "so the cache also catches scenarios repeated across calls. The Results buffer holds one record per\n"
+     "scenario; np.asarray() views it."},
+    {"cities", cities, METH_NOARGS, "cities() -> list of (name, country, population_millions, area_km2)"},
+    {"presets", presets, METH_NOARGS, "presets() -> list of (name, type, yield_mt, airburst, height_m)"},
+    {nullptr, nullptr, 0, nullptr}};
+
+static PyModuleDef module = {}; // Filled in by PyInit_nuccalc()
+
+PyMODINIT_FUNC PyInit_nuccalc()
+{
+    resultsSequence.sq_length = reinterpret_cast<lenfunc>(resultsLength);
+    resultsBuffer.bf_getbuffer = reinterpret_cast<getbufferproc>(resultsGetBuffer);
+    ResultsType.ob_base = PyVarObject{PyObject_HEAD_INIT(nullptr) 0};
+    ResultsType.tp_name = "nuccalc.Results";
+    ResultsType.tp_basicsize = sizeof(ResultsObject);
+    ResultsType.tp_dealloc = reinterpret_cast<destructor>(resultsDealloc);
+    ResultsType.tp_as_sequence = &resultsSequence;
+    ResultsType.tp_as_buffer = &resultsBuffer;
+    ResultsType.tp_flags = Py_TPFLAGS_DEFAULT;
+    ResultsType.tp_doc = "Result records of nuccalc.evaluate(), exported through the buffer protocol";
+    if (PyType_Ready(&ResultsType) < 0)
+        return nullptr;
+
+    module.m_base = PyModuleDef_HEAD_INIT;
+    module.m_name = "nuccalc";
+    module.m_doc = "Nuclear weapons effects calculator";
+    module.m_size = -1;
+    module.m_methods = methods;
+    PyObject *object = PyModule_Create(&module);
+    if (!object)
+        return nullptr;
+
+    PyObject *columns = PyTuple_New(static_cast<Py_ssize_t>(RESULT_COLUMNS.size()));
+    for (size_t c = 0; columns && c < RESULT_COLUMNS.size(); c++)
+    {
+        PyTuple_SET_ITEM(columns, static_cast<Py_ssize_t>(c),
+                         PyUnicode_FromStringAndSize(RESULT_COLUMNS[c].name.data(),
+                                                     static_cast<Py_ssize_t>(RESULT_COLUMNS[c].name.size())));
+    }
+    Py_INCREF(&ResultsType);
+    if (!columns || PyModule_AddObject(object, "COLUMNS", columns) < 0 ||
+        PyModule_AddObject(object, "Results", reinterpret_cast<PyObject *>(&ResultsType)) < 0)
+    {
+        Py_XDECREF(columns);
+        Py_DECREF(&ResultsType);
+        Py_DECREF(object);
+        return nullptr;
+    }
+    return object;
+}